@@ -0,0 +1,292 @@
+#include "batchprocessor.h"
+#include "mappedwkv.h"
+#include "wkvview.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+
+namespace {
+
+// Input samples kept on each side of a chunk so the interpolation stencil is never clamped.
+constexpr size_t resample_halo_samples = 4;
+
+// Resampled samples the derivative and peak stencils reach past a sample.
+constexpr size_t stencil_halo_samples = 1;
+
+/**
+ * @brief A range of resampled samples of one recording, processed as one task.
+ */
+struct Chunk
+{
+    size_t recording;
+    size_t first; ///< First resampled sample owned by the chunk.
+    size_t last;  ///< One past the last resampled sample owned by the chunk.
+};
+
+/**
+ * @brief Resampling grid of a recording, from its first sample to its last.
+ */
+struct Grid
+{
+    uint64_t start_us = 0;
+    uint64_t step_us = 1;
+    size_t size = 0;
+};
+
+/**
+ * @brief Append the timestamps of the samples strictly greater than both neighbours, as
+ * SensorDataProcessor::findPeaks() selects them.
+ */
+void findLocalMaxima(std::span<const uint64_t> timestamps,
+                     std::span<const double> values,
+                     std::vector<uint64_t> &peaks)
+{
+    for (size_t i = 1; i + 1 < values.size(); ++i) {
+        if (values[i] > values[i - 1] && values[i] > values[i + 1])
+            peaks.push_back(timestamps[i]);
+    }
+}
+
+} // namespace
+
+double BatchReport::samplesPerSecond() const
+{
+    return wall_seconds > 0.0 ? input_samples / wall_seconds : 0.0;
+}
+
+BatchProcessor::BatchProcessor(const BatchPipeline &pipeline, size_t thread_count)
+    : pipeline_(pipeline)
+    , pool_(thread_count)
+    , arenas_(pool_.threadCount())
+{
+    for (auto &arena : arenas_)
+        arena = std::make_unique<PipelineArena>();
+    if (pipeline_.target_rate <= 0)
+        throw std::invalid_argument("BatchProcessor: target rate must be positive");
+    if (pipeline_.chunk_samples == 0)
+        throw std::invalid_argument("BatchProcessor: chunks must hold at least one sample");
+    if (pipeline_.smooth && (pipeline_.kernel_size <= 0 || pipeline_.kernel_size % 2 == 0))
+        throw std::invalid_argument("BatchProcessor: the kernel size must be odd and positive");
+    if (pipeline_.smooth && pipeline_.smoothing == SmoothingMode::Recursive)
+        throw std::invalid_argument("BatchProcessor: the recursive filter cannot be chunked, use a "
+                                    "kernel mode");
+    // The derivatives of a chunk are copied sample for sample, none may be skipped
+    if (pipeline_.derivatives
+        && std::llround(1e6 / pipeline_.target_rate)
+               <= static_cast<long long>(DerivativeEngine::min_interval_us))
+        throw std::invalid_argument("BatchProcessor: the resampling step must be longer than the "
+                                    "derivative minimum interval");
+    if (pipeline_.interpolation == InterpolationMode::CardinalSpline)
+        throw std::invalid_argument("BatchProcessor: the cardinal spline cannot be chunked, use a "
+                                    "local interpolation");
+    if (pipeline_.interpolation == InterpolationMode::Polyphase)
+        throw std::invalid_argument("BatchProcessor: the polyphase filter spans chunks, use a local "
+                                    "interpolation");
+}
+
+BatchReport BatchProcessor::process(const std::vector<const IWKV *> &recordings)
+{
+    const auto begin = std::chrono::steady_clock::now();
+
+    BatchReport report;
+    report.recordings.resize(recordings.size());
+    report.thread_count = pool_.threadCount();
+
+    const auto step_us = static_cast<uint64_t>(std::llround(1e6 / pipeline_.target_rate));
+    const size_t halo = (pipeline_.smooth ? static_cast<size_t>(pipeline_.kernel_size / 2) : 0)
+                        + stencil_halo_samples;
+
+    // Size every output up front: chunks write their slice in place, no stitching is needed
+    std::vector<Grid> grids(recordings.size());
+    std::vector<Chunk> chunks;
+    std::vector<std::vector<std::vector<uint64_t>>> chunk_peaks(recordings.size());
+    std::vector<std::vector<double>> chunk_seconds(recordings.size());
+    std::vector<std::vector<std::string>> chunk_errors(recordings.size());
+
+    for (size_t r = 0; r < recordings.size(); ++r) {
+        BatchRecordingResult &result = report.recordings[r];
+        if (!recordings[r]) {
+            result.error = "Invalid recording.";
+            continue;
+        }
+
+        const IWKV &recording = *recordings[r];
+        const std::span<const uint64_t> timestamps = recording.getTimestampsUs();
+        result.name = recording.getName();
+        result.input_samples = timestamps.size();
+        report.input_samples += timestamps.size();
+        if (timestamps.empty()) {
+            result.error = "Sensor data is empty.";
+            continue;
+        }
+
+        Grid &grid = grids[r];
+        grid.start_us = timestamps.front();
+        grid.step_us = step_us;
+        grid.size = LocalResampler::outputSize(timestamps, timestamps.front(), timestamps.back(), step_us);
+
+        result.timestamps_us.resize(grid.size);
+        result.values.resize(grid.size);
+        if (pipeline_.derivatives) {
+            const size_t interior = grid.size >= 3 ? grid.size - 2 : 0;
+            result.derivatives.timestamps_us.resize(interior);
+            result.derivatives.velocities.resize(interior);
+            result.derivatives.accelerations.resize(interior);
+        }
+
+        result.chunk_count = (grid.size + pipeline_.chunk_samples - 1) / pipeline_.chunk_samples;
+        chunk_peaks[r].resize(result.chunk_count);
+        chunk_seconds[r].resize(result.chunk_count);
+        chunk_errors[r].resize(result.chunk_count);
+        for (size_t first = 0; first < grid.size; first += pipeline_.chunk_samples) {
+            chunks.push_back({r, first, std::min(first + pipeline_.chunk_samples, grid.size)});
+        }
+    }
+
+    // Largest chunks first, so the small ones fill the gaps at the end of the batch
+    std::stable_sort(chunks.begin(), chunks.end(), [](const Chunk &a, const Chunk &b) {
+        return a.last - a.first > b.last - b.first;
+    });
+
+    // Arenas are not thread-safe: one smoother per worker, with its scratch on the arena of the
+    // worker
+    std::vector<std::unique_ptr<GaussianSmoother>> smoothers(pool_.threadCount());
+    std::vector<DerivativeSeries> worker_derivatives(pool_.threadCount());
+    AllocationStats arena_begin, upstream_begin;
+    for (size_t worker = 0; worker < smoothers.size(); ++worker) {
+        if (pipeline_.smooth) {
+            smoothers[worker] = std::make_unique<GaussianSmoother>(pipeline_.kernel_size,
+                                                                   pipeline_.sigma,
+                                                                   arenas_[worker].get());
+        }
+        arena_begin += arenas_[worker]->stats();
+        upstream_begin += arenas_[worker]->upstreamStats();
+    }
+    const LocalResampler resampler(pipeline_.interpolation);
+
+    std::vector<WorkStealingPool::Task> tasks;
+    tasks.reserve(chunks.size());
+    for (const Chunk &chunk : chunks) {
+        tasks.push_back([&, chunk](size_t worker) {
+            const auto chunk_begin = std::chrono::steady_clock::now();
+            const size_t index = chunk.first / pipeline_.chunk_samples;
+            const IWKV &recording = *recordings[chunk.recording];
+            const Grid &grid = grids[chunk.recording];
+            BatchRecordingResult &result = report.recordings[chunk.recording];
+            PipelineArena &arena = *arenas_[worker];
+            arena.reset();
+
+            try {
+                // Resample the owned range plus the overlap needed by the later stages
+                const size_t first = chunk.first > halo ? chunk.first - halo : 0;
+                const size_t last = std::min(chunk.last + halo, grid.size);
+                const uint64_t start_us = grid.start_us + first * grid.step_us;
+                const uint64_t end_us = grid.start_us + (last - 1) * grid.step_us;
+                const WKVView input = WKVView::windowUs(recording, start_us, end_us)
+                                          .widened(resample_halo_samples, resample_halo_samples);
+
+                std::pmr::vector<uint64_t> timestamps(last - first, &arena);
+                std::pmr::vector<double> values(last - first, &arena);
+                if (resampler.resample(input, start_us, end_us, grid.step_us, timestamps, values)
+                    != last - first) {
+                    throw std::runtime_error("chunk does not cover its resampling grid");
+                }
+
+                // The stages run on the arena columns directly, which are released by the next
+                // reset
+                if (pipeline_.smooth) {
+                    std::pmr::vector<double> smoothed(values.size(), &arena);
+                    smoothers[worker]->smooth(values, smoothed, pipeline_.smoothing);
+                    values = std::move(smoothed);
+                }
+
+                // Keep only the owned range of every stage
+                const size_t offset = chunk.first - first;
+                std::copy_n(timestamps.begin() + offset,
+                            chunk.last - chunk.first,
+                            result.timestamps_us.begin() + chunk.first);
+                std::copy_n(values.begin() + offset,
+                            chunk.last - chunk.first,
+                            result.values.begin() + chunk.first);
+
+                if (pipeline_.derivatives) {
+                    // Derivative k is taken at sample k + 1, both in the chunk and in the result
+                    DerivativeSeries &derivatives = worker_derivatives[worker];
+                    DerivativeEngine::compute(timestamps, values, derivatives);
+                    const size_t derivative_first = std::max(chunk.first, size_t(1));
+                    const size_t derivative_last = std::min(chunk.last, grid.size - 1);
+                    DerivativeSeries &output = result.derivatives;
+                    for (size_t i = derivative_first; i < derivative_last; ++i) {
+                        output.timestamps_us[i - 1] = derivatives.timestamps_us[i - first - 1];
+                        output.velocities[i - 1] = derivatives.velocities[i - first - 1];
+                        output.accelerations[i - 1] = derivatives.accelerations[i - first - 1];
+                    }
+                }
+
+                if (pipeline_.peaks) {
+                    // One neighbour on each side, so exactly the owned samples are tested
+                    const size_t peak_first = std::max(chunk.first, size_t(1)) - 1;
+                    const size_t peak_last = std::min(chunk.last + 1, grid.size);
+                    findLocalMaxima(std::span<const uint64_t>(timestamps)
+                                        .subspan(peak_first - first, peak_last - peak_first),
+                                    std::span<const double>(values)
+                                        .subspan(peak_first - first, peak_last - peak_first),
+                                    chunk_peaks[chunk.recording][index]);
+                }
+            } catch (const std::exception &e) {
+                chunk_errors[chunk.recording][index] = e.what();
+            }
+
+            chunk_seconds[chunk.recording][index]
+                = std::chrono::duration<double>(std::chrono::steady_clock::now() - chunk_begin).count();
+        });
+    }
+    pool_.run(std::move(tasks));
+    report.steal_count = pool_.stealCount();
+    for (const auto &arena : arenas_) {
+        report.arena_allocations += arena->stats();
+        report.arena_upstream += arena->upstreamStats();
+    }
+    report.arena_allocations = report.arena_allocations - arena_begin;
+    report.arena_upstream = report.arena_upstream - upstream_begin;
+
+    for (size_t r = 0; r < recordings.size(); ++r) {
+        BatchRecordingResult &result = report.recordings[r];
+        for (size_t c = 0; c < result.chunk_count; ++c) {
+            result.cpu_seconds += chunk_seconds[r][c];
+            result.peaks.insert(result.peaks.end(), chunk_peaks[r][c].begin(), chunk_peaks[r][c].end());
+            if (result.error.empty() && !chunk_errors[r][c].empty())
+                result.error = chunk_errors[r][c];
+        }
+    }
+
+    report.wall_seconds
+        = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return report;
+}
+
+BatchReport BatchProcessor::processFiles(const std::vector<std::string> &paths)
+{
+    std::vector<std::unique_ptr<MappedWKV>> mapped(paths.size());
+    std::vector<std::string> errors(paths.size());
+    std::vector<const IWKV *> recordings(paths.size(), nullptr);
+    for (size_t i = 0; i < paths.size(); ++i) {
+        try {
+            mapped[i] = std::make_unique<MappedWKV>(paths[i]);
+            recordings[i] = mapped[i].get();
+        } catch (const std::exception &e) {
+            errors[i] = e.what();
+        }
+    }
+
+    BatchReport report = process(recordings);
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (!errors[i].empty()) {
+            report.recordings[i].name = paths[i];
+            report.recordings[i].error = errors[i];
+        }
+    }
+    return report;
+}
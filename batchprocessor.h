@@ -0,0 +1,106 @@
+#ifndef BATCHPROCESSOR_H
+#define BATCHPROCESSOR_H
+
+#include "derivativeengine.h"
+#include "gaussiansmoother.h"
+#include "iwkv.h"
+#include "localresampler.h"
+#include "pipelinearena.h"
+#include "workstealingpool.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Stages applied to every recording of a batch, in order: resample, smooth, derivatives,
+ * peaks. Each recording is resampled over its whole duration.
+ */
+struct BatchPipeline
+{
+    int target_rate = 100;                                 ///< Resampling rate in Hertz.
+    InterpolationMode interpolation = InterpolationMode::Cubic;
+    bool smooth = true;                                    ///< Whether to smooth the resampled series.
+    int kernel_size = 19;
+    double sigma = 3.0;
+    SmoothingMode smoothing = SmoothingMode::Fir;
+    bool derivatives = true;                               ///< Whether to compute velocity and acceleration.
+    bool peaks = true;                                     ///< Whether to detect peaks.
+    size_t chunk_samples = size_t(1) << 18;                ///< Resampled samples per task.
+};
+
+/**
+ * @brief Output of the pipeline for one recording, identical to running the stages on the whole
+ * recording at once.
+ */
+struct BatchRecordingResult
+{
+    std::string name;                   ///< Name of the recording.
+    size_t input_samples = 0;           ///< Samples in the recording.
+    size_t chunk_count = 0;             ///< Tasks the recording was split into.
+    double cpu_seconds = 0.0;           ///< Processing time summed over the chunks.
+    std::string error;                  ///< Empty when the recording was processed.
+    std::vector<uint64_t> timestamps_us; ///< Resampled timestamps.
+    std::vector<double> values;          ///< Resampled, and smoothed if enabled, values.
+    DerivativeSeries derivatives;        ///< Velocity and acceleration of the resampled series.
+    std::vector<uint64_t> peaks;         ///< Timestamps of the peaks.
+};
+
+/**
+ * @brief Results and throughput of a batch.
+ */
+struct BatchReport
+{
+    std::vector<BatchRecordingResult> recordings; ///< One result per recording, in input order.
+    size_t input_samples = 0;                     ///< Samples over all recordings.
+    double wall_seconds = 0.0;                    ///< Elapsed time of the batch.
+    size_t thread_count = 0;                      ///< Workers used.
+    size_t steal_count = 0;                       ///< Tasks stolen by idle workers.
+    AllocationStats arena_allocations;            ///< Temporaries served by the worker arenas.
+    AllocationStats arena_upstream;               ///< Heap allocations of the worker arenas, 0 once they fit the chunks.
+
+    double samplesPerSecond() const;
+};
+
+/**
+ * @brief The BatchProcessor class runs a pipeline over many recordings on all cores.
+ *
+ * Every recording is cut into chunks of resampled samples, each processed as an independent task
+ * on a WorkStealingPool, so a single long session is spread over the cores instead of becoming
+ * the straggler. Chunks are computed with enough overlap (the smoothing kernel half-width plus
+ * the derivative and peak stencils) for the stitched result to match a single pass.
+ *
+ * The temporaries of a chunk come from a PipelineArena of its worker, reset before every chunk.
+ * The arenas are kept across calls to process(), so once they have grown to the largest chunk
+ * the stages no longer allocate from the heap.
+ */
+class BatchProcessor
+{
+private:
+    BatchPipeline pipeline_;                            ///< Stages applied to every recording.
+    WorkStealingPool pool_;                             ///< Workers running the chunks.
+    std::vector<std::unique_ptr<PipelineArena>> arenas_; ///< Temporaries of each worker.
+
+public:
+    /**
+     * @brief Construct a new BatchProcessor.
+     *
+     * @param pipeline The stages to apply.
+     * @param thread_count Number of workers, the number of hardware threads when 0.
+     * @throws std::invalid_argument if a stage cannot be chunked: a non-positive target rate or
+     * one so high that the derivatives skip samples (a step of DerivativeEngine::min_interval_us
+     * or less), an even kernel, the recursive smoothing filter, or a global interpolation.
+     */
+    explicit BatchProcessor(const BatchPipeline &pipeline, size_t thread_count = 0);
+
+    /**
+     * @brief Process recordings. A null or empty recording is reported as an error.
+     */
+    BatchReport process(const std::vector<const IWKV *> &recordings);
+
+    /**
+     * @brief Process recordings written with MappedWKV::write(), mapping each of them.
+     */
+    BatchReport processFiles(const std::vector<std::string> &paths);
+};
+
+#endif // BATCHPROCESSOR_H
@@ -1,6 +1,6 @@
-#ifndef BOOST_EXAMPLE_H
-#define BOOST_EXAMPLE_H
-
-int testBoostLib();
-
-#endif // BOOST_EXAMPLE_H
+#ifndef BOOST_EXAMPLE_H
+#define BOOST_EXAMPLE_H
+
+int testBoostLib();
+
+#endif // BOOST_EXAMPLE_H
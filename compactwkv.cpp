@@ -0,0 +1,291 @@
+#include "compactwkv.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+template<typename Value>
+CompactWKV<Value>::CompactWKV(const std::string &name,
+                              const std::string &unit,
+                              double scale,
+                              double offset)
+    : name_(name)
+    , unit_(unit)
+    , frequency_(0)
+    , start_time_us_(0)
+    , origin_us_(0)
+    , scale_(std::is_floating_point_v<Value> ? 1.0 : scale)
+    , offset_(std::is_floating_point_v<Value> ? 0.0 : offset)
+    , cache_valid_(true)
+{
+    if (!(scale_ > 0.0)) {
+        throw std::invalid_argument("CompactWKV: the quantisation scale must be positive.");
+    }
+}
+
+template<typename Value>
+Value CompactWKV<Value>::encode(double value) const
+{
+    if constexpr (std::is_floating_point_v<Value>) {
+        return static_cast<Value>(value);
+    } else {
+        const double sample = std::nearbyint((value - offset_) / scale_);
+        if (!(sample >= std::numeric_limits<Value>::min() && sample <= std::numeric_limits<Value>::max())) {
+            throw std::out_of_range("CompactWKV: value " + std::to_string(value)
+                                    + " is outside of the quantised range.");
+        }
+        return static_cast<Value>(sample);
+    }
+}
+
+/**
+ * @brief Encode a timestamp as an offset from origin_us, checking it is not before last_us.
+ */
+template<typename Value>
+uint32_t CompactWKV<Value>::encodeTimestamp(uint64_t epoch_us, uint64_t origin_us, uint64_t last_us) const
+{
+    if (epoch_us < last_us) {
+        throw std::invalid_argument("CompactWKV: data points must be added in chronological order.");
+    }
+    if (epoch_us - origin_us > std::numeric_limits<uint32_t>::max()) {
+        throw std::out_of_range("CompactWKV: timestamps are limited to 2^32 - 1 us after the "
+                                "first sample.");
+    }
+    return static_cast<uint32_t>(epoch_us - origin_us);
+}
+
+/**
+ * @brief Encode a block into temporaries and only append it once every sample is valid.
+ */
+template<typename Value>
+void CompactWKV<Value>::appendSamples(std::span<const uint64_t> epochs_us, std::span<const double> values)
+{
+    if (epochs_us.size() != values.size()) {
+        throw std::invalid_argument("CompactWKV::addDataPoints requires one value per timestamp.");
+    }
+    if (epochs_us.empty()) {
+        return;
+    }
+    const uint64_t origin_us = offsets_us_.empty() ? epochs_us.front() : origin_us_;
+    uint64_t last_us = offsets_us_.empty() ? origin_us : origin_us_ + offsets_us_.back();
+    std::vector<uint32_t> offsets(epochs_us.size());
+    std::vector<Value> encoded(values.size());
+    for (size_t i = 0; i < epochs_us.size(); ++i) {
+        offsets[i] = encodeTimestamp(epochs_us[i], origin_us, last_us);
+        encoded[i] = encode(values[i]);
+        last_us = epochs_us[i];
+    }
+
+    origin_us_ = origin_us;
+    offsets_us_.insert(offsets_us_.end(), offsets.begin(), offsets.end());
+    values_.insert(values_.end(), encoded.begin(), encoded.end());
+    cache_valid_ = false;
+}
+
+template<typename Value>
+void CompactWKV<Value>::clearSamples()
+{
+    offsets_us_.clear();
+    values_.clear();
+    origin_us_ = 0;
+    cache_valid_ = false;
+}
+
+template<typename Value>
+void CompactWKV<Value>::generateData(int, double, int, std::optional<IWKV *>)
+{
+    throw std::logic_error("CompactWKV stores data, store a sensor with copyFrom() instead.");
+}
+
+template<typename Value>
+std::string CompactWKV<Value>::getName() const
+{
+    return name_;
+}
+
+template<typename Value>
+int CompactWKV<Value>::getFrequency() const
+{
+    return frequency_;
+}
+
+template<typename Value>
+std::string CompactWKV<Value>::getUnit() const
+{
+    return unit_;
+}
+
+template<typename Value>
+uint64_t CompactWKV<Value>::getStartTimeUs() const
+{
+    return start_time_us_;
+}
+
+template<typename Value>
+void CompactWKV<Value>::setName(const std::string &name)
+{
+    name_ = name;
+}
+
+template<typename Value>
+void CompactWKV<Value>::setUnit(const std::string &unit)
+{
+    unit_ = unit;
+}
+
+template<typename Value>
+void CompactWKV<Value>::setStartTimeUs(uint64_t start_time_us)
+{
+    start_time_us_ = start_time_us;
+}
+
+template<typename Value>
+void CompactWKV<Value>::setFrequency(int frequency)
+{
+    frequency_ = frequency;
+}
+
+template<typename Value>
+size_t CompactWKV<Value>::size() const
+{
+    return offsets_us_.size();
+}
+
+template<typename Value>
+size_t CompactWKV<Value>::storageBytes() const
+{
+    return offsets_us_.capacity() * sizeof(uint32_t) + values_.capacity() * sizeof(Value);
+}
+
+template<typename Value>
+size_t CompactWKV<Value>::lowerBound(uint64_t time_us) const
+{
+    if (offsets_us_.empty() || time_us <= origin_us_) {
+        return 0;
+    }
+    const uint64_t offset_us = time_us - origin_us_;
+    if (offset_us > std::numeric_limits<uint32_t>::max()) {
+        return offsets_us_.size();
+    }
+    return std::lower_bound(offsets_us_.begin(), offsets_us_.end(), static_cast<uint32_t>(offset_us))
+           - offsets_us_.begin();
+}
+
+template<typename Value>
+TimestampColumn<uint32_t> CompactWKV<Value>::timestampColumn(size_t first, size_t count) const
+{
+    first = std::min(first, offsets_us_.size());
+    count = std::min(count, offsets_us_.size() - first);
+    return {std::span<const uint32_t>(offsets_us_).subspan(first, count), origin_us_};
+}
+
+template<typename Value>
+ValueColumn<Value> CompactWKV<Value>::valueColumn(size_t first, size_t count) const
+{
+    first = std::min(first, values_.size());
+    count = std::min(count, values_.size() - first);
+    return {std::span<const Value>(values_).subspan(first, count), scale_, offset_};
+}
+
+template<typename Value>
+void CompactWKV<Value>::addDataPoint(const uint64_t epoch_us, const double value)
+{
+    const uint64_t origin_us = offsets_us_.empty() ? epoch_us : origin_us_;
+    const uint64_t last_us = offsets_us_.empty() ? epoch_us : origin_us_ + offsets_us_.back();
+    const uint32_t offset_us = encodeTimestamp(epoch_us, origin_us, last_us);
+    const Value encoded = encode(value);
+    origin_us_ = origin_us;
+    offsets_us_.push_back(offset_us);
+    values_.push_back(encoded);
+    cache_valid_ = false;
+}
+
+template<typename Value>
+void CompactWKV<Value>::addDataPoints(std::span<const uint64_t> epochs_us,
+                                      std::span<const double> values)
+{
+    const size_t first_index = offsets_us_.size();
+    appendSamples(epochs_us, values);
+    emit sensorDataAppended(*this, first_index, epochs_us.size());
+}
+
+/**
+ * @brief Decode the whole series into the cache, once per modification.
+ *
+ * The flag is checked again under the lock, so concurrent readers decode the series only once
+ * and none of them reads the cache while another one fills it.
+ */
+template<typename Value>
+void CompactWKV<Value>::decode() const
+{
+    if (cache_valid_.load(std::memory_order_acquire)) {
+        return;
+    }
+    const std::lock_guard<std::mutex> lock(cache_mutex_);
+    if (cache_valid_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    const TimestampColumn<uint32_t> timestamps = timestampColumn();
+    const ValueColumn<Value> values = valueColumn();
+    timestamps_us_.resize(timestamps.size());
+    data_.resize(values.size());
+    for (size_t i = 0; i < timestamps.size(); ++i) {
+        timestamps_us_[i] = timestamps[i];
+        data_[i] = values[i];
+    }
+    cache_valid_.store(true, std::memory_order_release);
+}
+
+template<typename Value>
+std::span<const uint64_t> CompactWKV<Value>::getTimestampsUs() const
+{
+    decode();
+    return timestamps_us_;
+}
+
+template<typename Value>
+std::span<const double> CompactWKV<Value>::getData() const
+{
+    decode();
+    return data_;
+}
+
+template<typename Value>
+void CompactWKV<Value>::setData(const std::vector<double> &data)
+{
+    if (data.size() != values_.size()) {
+        throw std::invalid_argument("CompactWKV::setData requires one value per sample.");
+    }
+    std::vector<Value> encoded(data.size());
+    for (size_t i = 0; i < data.size(); ++i) {
+        encoded[i] = encode(data[i]);
+    }
+    values_ = std::move(encoded);
+    cache_valid_ = false;
+}
+
+template<typename Value>
+void CompactWKV<Value>::setData(std::vector<double> &&data)
+{
+    setData(static_cast<const std::vector<double> &>(data));
+}
+
+template<typename Value>
+void CompactWKV<Value>::copyFrom(const IWKV &other)
+{
+    // this->name_ = other.getName(); // do not copy the name as it is constructed with it.
+    this->unit_ = other.getUnit();
+    this->frequency_ = other.getFrequency();
+    this->start_time_us_ = other.getStartTimeUs();
+
+    clearSamples();
+    const std::span<const uint64_t> timestamps = other.getTimestampsUs();
+    const std::span<const double> data = other.getData();
+    const size_t count = std::min(timestamps.size(), data.size());
+    appendSamples(timestamps.first(count), data.first(count));
+    emit sensorDataReady(*this);
+}
+
+template class CompactWKV<float>;
+template class CompactWKV<double>;
+template class CompactWKV<int16_t>;
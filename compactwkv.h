@@ -0,0 +1,154 @@
+#ifndef COMPACTWKV_H
+#define COMPACTWKV_H
+
+#include "iwkv.h"
+#include "samplecolumns.h"
+#include <atomic>
+#include <mutex>
+#include <span>
+
+/**
+ * @brief The CompactWKV class stores a data series in narrow columns.
+ *
+ * Timestamps are kept as uint32_t microsecond offsets from the first sample, which covers a
+ * little over 71 minutes per series, and values as Value:
+ * - double keeps the values exactly (12 bytes per sample instead of 16),
+ * - float keeps about 7 significant digits (8 bytes per sample),
+ * - int16_t quantises the values as offset + scale * sample (6 bytes per sample), with an error
+ *   of at most scale / 2 inside [offset - 32768 * scale, offset + 32767 * scale].
+ *
+ * The processors read the columns in place through timestampColumn() and valueColumn(), whose
+ * kernels decode the samples on the fly. The IWKV column accessors decode the whole series into
+ * a cache that is kept until the next modification; they exist for compatibility and cost the
+ * full 16 bytes per sample again. The cache is filled under a lock, so concurrent readers are
+ * safe; writes need exclusive access, as for any IWKV.
+ *
+ * Instantiated for float, double and int16_t values.
+ */
+template<typename Value>
+class CompactWKV : public IWKV
+{
+private:
+    std::string name_;                 ///< Name of the sensor.
+    std::string unit_;                 ///< Unit of measurement for the data.
+    int frequency_;                    ///< Frequency in Hertz
+    uint64_t start_time_us_;           ///< Start time of the data series in microseconds.
+    uint64_t origin_us_;               ///< Timestamp of the first sample, origin of the offsets.
+    double scale_;                     ///< Quantisation step, integer values only.
+    double offset_;                    ///< Value of a zero sample, integer values only.
+    std::vector<uint32_t> offsets_us_; ///< Timestamps relative to origin_us_.
+    std::vector<Value> values_;        ///< Encoded data values.
+
+    mutable std::atomic<bool> cache_valid_;       ///< Whether the decoded columns are up to date.
+    mutable std::mutex cache_mutex_;              ///< Serialises the readers filling the cache.
+    mutable std::vector<uint64_t> timestamps_us_; ///< Decoded timestamps, see getTimestampsUs().
+    mutable std::vector<double> data_;            ///< Decoded data values, see getData().
+
+    Value encode(double value) const;
+    uint32_t encodeTimestamp(uint64_t epoch_us, uint64_t origin_us, uint64_t last_us) const;
+    void appendSamples(std::span<const uint64_t> epochs_us, std::span<const double> values);
+    void clearSamples();
+    void decode() const;
+
+public:
+    /**
+     * @brief Construct a new CompactWKV.
+     *
+     * @param name The name of the sensor.
+     * @param unit The measurement unit of the data.
+     * @param scale The quantisation step of int16_t values, ignored for floating-point values.
+     * @param offset The value stored as zero by int16_t values, ignored for floating-point values.
+     * @throws std::invalid_argument if an int16_t storage is given a scale that is not positive.
+     */
+    CompactWKV(const std::string &name,
+               const std::string &unit,
+               double scale = 1.0,
+               double offset = 0.0);
+
+    /**
+     * @brief Not supported: store the output of a sensor with copyFrom() instead.
+     *
+     * @throws std::logic_error Always.
+     */
+    void generateData(int frequency,
+                      double jitter,
+                      int duration_seconds,
+                      std::optional<IWKV *> other_sensor_ptr = std::nullopt) override;
+
+    std::string getName() const override;
+    int getFrequency() const override;
+    std::string getUnit() const override;
+    uint64_t getStartTimeUs() const override;
+    void setName(const std::string &name) override;
+    void setUnit(const std::string &unit) override;
+    void setStartTimeUs(uint64_t start_time_us) override;
+    void setFrequency(int frequency) override;
+
+    size_t size() const;
+
+    /**
+     * @brief Get the memory used by the two columns, in bytes.
+     */
+    size_t storageBytes() const;
+
+    /**
+     * @brief Index of the first sample with a timestamp at or after time_us.
+     */
+    size_t lowerBound(uint64_t time_us) const;
+
+    /**
+     * @brief Get the timestamps of the samples [first, first + count) without decoding them.
+     */
+    TimestampColumn<uint32_t> timestampColumn(size_t first = 0, size_t count = SIZE_MAX) const;
+
+    /**
+     * @brief Get the values of the samples [first, first + count) without decoding them.
+     */
+    ValueColumn<Value> valueColumn(size_t first = 0, size_t count = SIZE_MAX) const;
+
+    /**
+     * @brief Encode a data point at the end of the series.
+     *
+     * @throws std::out_of_range if the timestamp is more than 2^32 - 1 us after the first sample,
+     * or if an int16_t storage cannot represent the value.
+     * @throws std::invalid_argument if the timestamp is before the last one.
+     */
+    void addDataPoint(const uint64_t epoch_us, const double value) override;
+
+    /**
+     * @brief Encode a block of data points at the end of the series.
+     *
+     * The whole block is validated before anything is stored, so a block that throws leaves the
+     * series unchanged and sensorDataAppended() is emitted for every block stored.
+     *
+     * @throws std::invalid_argument if there is not one value per timestamp, or for the reasons
+     * of addDataPoint().
+     * @throws std::out_of_range for the reasons of addDataPoint().
+     */
+    void addDataPoints(std::span<const uint64_t> epochs_us, std::span<const double> values) override;
+
+    /**
+     * @brief Get the timestamps, decoding the whole series on first access.
+     */
+    std::span<const uint64_t> getTimestampsUs() const override;
+
+    /**
+     * @brief Get the data values, decoding the whole series on first access.
+     */
+    std::span<const double> getData() const override;
+
+    /**
+     * @brief Replace the data values, re-encoding them.
+     *
+     * @throws std::invalid_argument If there is not one value per sample.
+     */
+    void setData(const std::vector<double> &data) override;
+    void setData(std::vector<double> &&data) override;
+
+    /**
+     * @brief Store the data series of another sensor in compact form.
+     */
+    void copyFrom(const IWKV &other) override;
+};
+
+#endif // COMPACTWKV_H
@@ -0,0 +1,458 @@
+#include "compressedwkv.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+/**
+ * @brief Append the count low bits of value to a bit stream, most significant bit first.
+ */
+void appendBits(std::vector<uint64_t> &words, size_t &bit_count, uint64_t value, int count)
+{
+    if (count == 0) {
+        return;
+    }
+    if (count < 64) {
+        value &= (uint64_t(1) << count) - 1;
+    }
+    const size_t offset = bit_count % 64;
+    if (offset == 0) {
+        words.push_back(0);
+    }
+    const int free_bits = 64 - static_cast<int>(offset);
+    if (count <= free_bits) {
+        words.back() |= value << (free_bits - count);
+    } else {
+        words.back() |= value >> (count - free_bits);
+        words.push_back(value << (64 - (count - free_bits)));
+    }
+    bit_count += count;
+}
+
+/**
+ * @brief Sequential reader over a bit stream written by appendBits.
+ */
+class BitReader
+{
+private:
+    const uint64_t *words_;
+    size_t position_;
+
+public:
+    explicit BitReader(const std::vector<uint64_t> &words)
+        : words_(words.data())
+        , position_(0)
+    {}
+
+    uint64_t read(int count)
+    {
+        if (count == 0) {
+            return 0;
+        }
+        const size_t word = position_ / 64;
+        const int free_bits = 64 - static_cast<int>(position_ % 64);
+        uint64_t value;
+        if (count <= free_bits) {
+            value = words_[word] >> (free_bits - count);
+        } else {
+            value = (words_[word] << (count - free_bits))
+                    | (words_[word + 1] >> (64 - (count - free_bits)));
+        }
+        position_ += count;
+        return count < 64 ? value & ((uint64_t(1) << count) - 1) : value;
+    }
+
+    bool readBit() { return read(1) != 0; }
+};
+
+uint64_t toBits(double value)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double fromBits(uint64_t bits)
+{
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+constexpr int width_bits = 7;               ///< Bits of a residual width, 0 to 64.
+constexpr int escape_width = 127;           ///< Width announcing a raw value off the quantum grid.
+constexpr int width_slack = 6;              ///< Unused bits tolerated before narrowing the width.
+constexpr double max_quantum_steps = 0x1p53; ///< Largest code of a value on the quantum grid.
+
+/**
+ * @brief Map a signed residual to an unsigned code that is small for small magnitudes.
+ */
+uint64_t zigZag(uint64_t residual)
+{
+    return (residual << 1) ^ (0 - (residual >> 63));
+}
+
+uint64_t unZigZag(uint64_t code)
+{
+    return (code >> 1) ^ (0 - (code & 1));
+}
+
+/**
+ * @brief Append a zig-zag code with the width of the previous ones, or with a new width.
+ *
+ * '0' + the code in the current width if it fits without wasting more than width_slack bits,
+ * otherwise '1' + width_bits of new width + the code in that width.
+ */
+void appendPacked(std::vector<uint64_t> &words, size_t &bit_count, uint64_t code, int &width)
+{
+    const int needed = std::bit_width(code);
+    if (needed <= width && width - needed <= width_slack) {
+        appendBits(words, bit_count, 0b0, 1);
+    } else {
+        width = needed;
+        appendBits(words, bit_count, 0b1, 1);
+        appendBits(words, bit_count, width, width_bits);
+    }
+    appendBits(words, bit_count, code, width);
+}
+
+/**
+ * @brief Map the bits of a double to an integer in the order of the values, so that close values
+ * get close integers, across a change of exponent too.
+ */
+uint64_t orderedBits(double value)
+{
+    const uint64_t bits = toBits(value);
+    return bits & (uint64_t(1) << 63) ? bits ^ ~(uint64_t(1) << 63) : bits;
+}
+
+double fromOrderedBits(uint64_t code)
+{
+    return fromBits(code & (uint64_t(1) << 63) ? code ^ ~(uint64_t(1) << 63) : code);
+}
+
+/**
+ * @brief Get the code of a stored value: its ordered bits if lossless, otherwise its number of
+ * quanta, which the decoder turns back into the exact value.
+ *
+ * @return bool false if the value is not on the quantum grid, e.g. infinite or too large.
+ */
+bool valueCode(double value, double quantum, uint64_t &code)
+{
+    if (quantum == 0.0) {
+        code = orderedBits(value);
+        return true;
+    }
+    // Compared bitwise, so that -0 is kept
+    const double steps = value / quantum;
+    if (!(std::abs(steps) <= max_quantum_steps)
+        || toBits(static_cast<double>(std::llround(steps)) * quantum) != toBits(value)) {
+        return false;
+    }
+    code = static_cast<uint64_t>(std::llround(steps));
+    return true;
+}
+
+double valueOf(uint64_t code, double quantum)
+{
+    return quantum == 0.0 ? fromOrderedBits(code) : static_cast<double>(static_cast<int64_t>(code)) * quantum;
+}
+
+} // namespace
+
+CompressedWKV::CompressedWKV(const std::string &name,
+                             const std::string &unit,
+                             size_t block_size,
+                             double value_resolution)
+    : name_(name)
+    , unit_(unit)
+    , frequency_(0)
+    , start_time_us_(0)
+    , block_size_(std::max<size_t>(block_size, 1))
+    , quantum_(value_resolution > 0.0 ? std::exp2(std::floor(std::log2(value_resolution))) : 0.0)
+    , size_(0)
+    , previous_time_us_(0)
+    , previous_delta_us_(0)
+    , previous_value_code_(0)
+    , before_previous_value_code_(0)
+    , time_width_(0)
+    , value_width_(0)
+    , cache_valid_(true)
+{}
+
+void CompressedWKV::generateData(int frequency,
+                                 double jitter,
+                                 int duration_seconds,
+                                 std::optional<IWKV *> other_sensor_ptr)
+{
+    throw std::logic_error("CompressedWKV stores data, compress a sensor with copyFrom() instead.");
+}
+
+std::string CompressedWKV::getName() const
+{
+    return name_;
+}
+
+int CompressedWKV::getFrequency() const
+{
+    return frequency_;
+}
+
+std::string CompressedWKV::getUnit() const
+{
+    return unit_;
+}
+
+uint64_t CompressedWKV::getStartTimeUs() const
+{
+    return start_time_us_;
+}
+
+void CompressedWKV::setName(const std::string &name)
+{
+    name_ = name;
+}
+
+void CompressedWKV::setUnit(const std::string &unit)
+{
+    unit_ = unit;
+}
+
+void CompressedWKV::setStartTimeUs(uint64_t start_time_us)
+{
+    start_time_us_ = start_time_us;
+}
+
+void CompressedWKV::setFrequency(int frequency)
+{
+    frequency_ = frequency;
+}
+
+size_t CompressedWKV::size() const
+{
+    return size_;
+}
+
+size_t CompressedWKV::compressedBytes() const
+{
+    size_t bytes = blocks_.capacity() * sizeof(Block);
+    for (const Block &block : blocks_) {
+        bytes += block.words.capacity() * sizeof(uint64_t);
+    }
+    return bytes;
+}
+
+/**
+ * @brief Encode a data point at the end of the last block, or start a new block.
+ * 
+ * The first sample of a block stores its raw value (its timestamp is in the block header).
+ * The following ones store two residuals, zig-zag coded and packed with appendPacked():
+ *   - the delta-of-delta of the timestamp, 0 for a regular sampling;
+ *   - the difference between the code of the value (see valueCode()) and its linear
+ *     extrapolation from the two previous codes, small for a smoothly changing value. A value
+ *     off the quantum grid is stored raw after the escape width, and counts as code 0.
+ */
+void CompressedWKV::addDataPoint(const uint64_t epoch_us, const double value)
+{
+    // A power-of-two quantum makes the rounded values exact multiples of it
+    const double stored = quantum_ > 0.0 ? std::round(value / quantum_) * quantum_ : value;
+    uint64_t code = 0;
+    const bool coded = valueCode(stored, quantum_, code);
+    cache_valid_ = false;
+    ++size_;
+
+    if (blocks_.empty() || blocks_.back().count == block_size_) {
+        if (!blocks_.empty()) {
+            blocks_.back().words.shrink_to_fit(); // The block is complete
+        }
+        Block &block = blocks_.emplace_back(Block{epoch_us, epoch_us, 1, 0, {}});
+        appendBits(block.words, block.bit_count, toBits(stored), 64);
+        previous_time_us_ = epoch_us;
+        previous_delta_us_ = 0;
+        previous_value_code_ = code;
+        before_previous_value_code_ = code;
+        time_width_ = 0;
+        value_width_ = 0;
+        return;
+    }
+
+    Block &block = blocks_.back();
+    std::vector<uint64_t> &words = block.words;
+    size_t &bits = block.bit_count;
+
+    // Residuals in wrapping arithmetic, whatever the jumps of the timestamps or values
+    const uint64_t delta_us = epoch_us - previous_time_us_;
+    appendPacked(words, bits, zigZag(delta_us - previous_delta_us_), time_width_);
+
+    if (coded) {
+        const uint64_t predicted = 2 * previous_value_code_ - before_previous_value_code_;
+        appendPacked(words, bits, zigZag(code - predicted), value_width_);
+    } else {
+        appendBits(words, bits, 0b1, 1);
+        appendBits(words, bits, escape_width, width_bits);
+        appendBits(words, bits, toBits(stored), 64);
+    }
+
+    block.last_time_us = epoch_us;
+    ++block.count;
+    previous_time_us_ = epoch_us;
+    previous_delta_us_ = delta_us;
+    before_previous_value_code_ = previous_value_code_;
+    previous_value_code_ = code;
+}
+
+void CompressedWKV::addDataPoints(std::span<const uint64_t> epochs_us, std::span<const double> values)
+{
+    const size_t first_index = size_;
+    for (size_t i = 0; i < epochs_us.size(); ++i) {
+        addDataPoint(epochs_us[i], values[i]);
+    }
+    emit sensorDataAppended(*this, first_index, epochs_us.size());
+}
+
+void CompressedWKV::decodeBlock(const Block &block,
+                                std::vector<uint64_t> &timestamps_us,
+                                std::vector<double> &values) const
+{
+    BitReader reader(block.words);
+    uint64_t time_us = block.first_time_us;
+    uint64_t delta_us = 0;
+    double value = fromBits(reader.read(64));
+    uint64_t code = 0, previous_code = 0;
+    if (valueCode(value, quantum_, code)) {
+        previous_code = code;
+    }
+    int time_width = 0, value_width = 0;
+    timestamps_us.push_back(time_us);
+    values.push_back(value);
+
+    for (uint32_t i = 1; i < block.count; ++i) {
+        if (reader.readBit()) {
+            time_width = static_cast<int>(reader.read(width_bits));
+        }
+        delta_us += unZigZag(reader.read(time_width));
+        time_us += delta_us;
+
+        const uint64_t predicted = 2 * code - previous_code;
+        previous_code = code;
+        const int width = reader.readBit() ? static_cast<int>(reader.read(width_bits)) : value_width;
+        if (width == escape_width) {
+            value = fromBits(reader.read(64));
+            code = 0;
+        } else {
+            value_width = width;
+            code = predicted + unZigZag(reader.read(value_width));
+            value = valueOf(code, quantum_);
+        }
+
+        timestamps_us.push_back(time_us);
+        values.push_back(value);
+    }
+}
+
+void CompressedWKV::decodeWindow(uint64_t start_time_us,
+                                 uint64_t end_time_us,
+                                 std::vector<uint64_t> &timestamps_us,
+                                 std::vector<double> &values) const
+{
+    timestamps_us.clear();
+    values.clear();
+
+    // Blocks are in chronological order: skip the ones ending before the window
+    auto block = std::lower_bound(blocks_.begin(),
+                                  blocks_.end(),
+                                  start_time_us,
+                                  [](const Block &block, uint64_t time_us) {
+                                      return block.last_time_us < time_us;
+                                  });
+    auto last_block = block;
+    size_t count = 0;
+    for (; last_block != blocks_.end() && last_block->first_time_us <= end_time_us; ++last_block) {
+        count += last_block->count;
+    }
+    timestamps_us.reserve(count);
+    values.reserve(count);
+    for (; block != last_block; ++block) {
+        decodeBlock(*block, timestamps_us, values);
+    }
+
+    // Trim the samples of the first and last blocks that fall outside of the window
+    const auto first = std::lower_bound(timestamps_us.begin(), timestamps_us.end(), start_time_us);
+    const auto last = std::upper_bound(first, timestamps_us.end(), end_time_us);
+    values.erase(values.begin() + (last - timestamps_us.begin()), values.end());
+    values.erase(values.begin(), values.begin() + (first - timestamps_us.begin()));
+    timestamps_us.erase(last, timestamps_us.end());
+    timestamps_us.erase(timestamps_us.begin(), timestamps_us.begin() + (first - timestamps_us.begin()));
+}
+
+void CompressedWKV::decodeAll() const
+{
+    if (cache_valid_) {
+        return;
+    }
+    timestamps_us_.clear();
+    data_.clear();
+    timestamps_us_.reserve(size_);
+    data_.reserve(size_);
+    for (const Block &block : blocks_) {
+        decodeBlock(block, timestamps_us_, data_);
+    }
+    cache_valid_ = true;
+}
+
+std::span<const uint64_t> CompressedWKV::getTimestampsUs() const
+{
+    decodeAll();
+    return timestamps_us_;
+}
+
+std::span<const double> CompressedWKV::getData() const
+{
+    decodeAll();
+    return data_;
+}
+
+void CompressedWKV::clearSamples()
+{
+    blocks_.clear();
+    size_ = 0;
+    cache_valid_ = false;
+}
+
+void CompressedWKV::setData(const std::vector<double> &data)
+{
+    if (data.size() != size_) {
+        throw std::invalid_argument("CompressedWKV::setData requires one value per sample.");
+    }
+    decodeAll();
+    std::vector<uint64_t> timestamps = std::move(timestamps_us_);
+    clearSamples();
+    for (size_t i = 0; i < timestamps.size(); ++i) {
+        addDataPoint(timestamps[i], data[i]);
+    }
+}
+
+void CompressedWKV::setData(std::vector<double> &&data)
+{
+    // The values are re-encoded, there is nothing to take ownership of
+    setData(static_cast<const std::vector<double> &>(data));
+}
+
+void CompressedWKV::copyFrom(const IWKV &other)
+{
+    // this->name_ = other.getName(); // do not copy the name as it is constructed with it.
+    this->unit_ = other.getUnit();
+    this->frequency_ = other.getFrequency();
+    this->start_time_us_ = other.getStartTimeUs();
+
+    clearSamples();
+    const std::span<const uint64_t> timestamps = other.getTimestampsUs();
+    const std::span<const double> data = other.getData();
+    for (size_t i = 0; i < timestamps.size(); ++i) {
+        addDataPoint(timestamps[i], data[i]);
+    }
+    emit sensorDataReady(*this);
+}
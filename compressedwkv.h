@@ -0,0 +1,152 @@
+#ifndef COMPRESSEDWKV_H
+#define COMPRESSEDWKV_H
+
+#include "iwkv.h"
+#include <span>
+
+/**
+ * @brief The CompressedWKV class keeps a data series compressed in memory.
+ *
+ * Samples are grouped in blocks of a fixed number of samples. Inside a block, timestamps are
+ * stored as delta-of-deltas, as in Gorilla (Pelkonen et al., VLDB 2015), and values as the
+ * difference with their linear extrapolation from the two previous values, taken on the bits of
+ * the doubles in the order of the values. Both residuals are zig-zag coded and bit-packed with a
+ * width that only changes when needed, so nearly regular timestamps cost a bit or two and
+ * smoothly changing values only store the bits of their deviation from the trend.
+ *
+ * Losslessly, the ratio is bounded by the noise of the values, whose random low mantissa bits
+ * cannot be removed: about 2.3x against 16 bytes per sample for a 1 kHz hip angle with 0.001
+ * degree of noise. An optional value resolution rounds the values to a power-of-two quantum not
+ * larger than it, and the values are then coded as a number of quanta, which trades a bounded
+ * error (half the quantum) for a much better ratio. Values off the quantum grid, e.g. infinite
+ * ones, are stored raw.
+ *
+ * Every block carries its time range, so decodeWindow() only decodes the blocks overlapping the
+ * requested window. The IWKV column accessors decode the whole series into a cache that is kept
+ * until the next modification; they exist for compatibility and defeat the compression.
+ */
+class CompressedWKV : public IWKV
+{
+private:
+    struct Block
+    {
+        uint64_t first_time_us;    ///< Timestamp of the first sample of the block.
+        uint64_t last_time_us;     ///< Timestamp of the last sample of the block.
+        uint32_t count;            ///< Number of samples in the block.
+        size_t bit_count;          ///< Number of bits used in words.
+        std::vector<uint64_t> words; ///< Encoded samples, most significant bit first.
+    };
+
+    std::string name_;                            ///< Name of the sensor.
+    std::string unit_;                            ///< Unit of measurement for the data.
+    int frequency_;                               ///< Frequency in Hertz
+    uint64_t start_time_us_;                      ///< Start time of the data series in microseconds.
+    size_t block_size_;                           ///< Number of samples per block.
+    double quantum_;                              ///< Value quantum, 0 for lossless storage.
+    size_t size_;                                 ///< Total number of samples.
+    std::vector<Block> blocks_;                   ///< Encoded blocks, in chronological order.
+
+    // Encoder state of the last block
+    uint64_t previous_time_us_;
+    uint64_t previous_delta_us_;
+    uint64_t previous_value_code_;
+    uint64_t before_previous_value_code_;
+    int time_width_;                              ///< Bit width of the timestamp residuals.
+    int value_width_;                             ///< Bit width of the value residuals.
+
+    mutable bool cache_valid_;                    ///< Whether the decoded columns are up to date.
+    mutable std::vector<uint64_t> timestamps_us_; ///< Decoded timestamps, see getTimestampsUs().
+    mutable std::vector<double> data_;            ///< Decoded data values, see getData().
+
+    void decodeBlock(const Block &block,
+                     std::vector<uint64_t> &timestamps_us,
+                     std::vector<double> &values) const;
+    void clearSamples();
+    void decodeAll() const;
+
+public:
+    /**
+     * @brief Construct a new CompressedWKV.
+     *
+     * @param name The name of the sensor.
+     * @param unit The measurement unit of the data.
+     * @param block_size The number of samples per block. Smaller blocks make window queries
+     * more selective, larger ones compress slightly better.
+     * @param value_resolution The largest acceptable quantisation step of the values, 0 to store
+     * them losslessly.
+     */
+    CompressedWKV(const std::string &name,
+                  const std::string &unit,
+                  size_t block_size = 1024,
+                  double value_resolution = 0.0);
+
+    /**
+     * @brief Not supported: compress the output of a sensor with copyFrom() instead.
+     *
+     * @throws std::logic_error Always.
+     */
+    void generateData(int frequency,
+                      double jitter,
+                      int duration_seconds,
+                      std::optional<IWKV *> other_sensor_ptr = std::nullopt) override;
+
+    std::string getName() const override;
+    int getFrequency() const override;
+    std::string getUnit() const override;
+    uint64_t getStartTimeUs() const override;
+    void setName(const std::string &name) override;
+    void setUnit(const std::string &unit) override;
+    void setStartTimeUs(uint64_t start_time_us) override;
+    void setFrequency(int frequency) override;
+
+    size_t size() const;
+
+    /**
+     * @brief Get the memory used by the encoded blocks, in bytes.
+     */
+    size_t compressedBytes() const;
+
+    /**
+     * @brief Encode a data point at the end of the series.
+     */
+    void addDataPoint(const uint64_t epoch_us, const double value) override;
+    void addDataPoints(std::span<const uint64_t> epochs_us, std::span<const double> values) override;
+
+    /**
+     * @brief Decode the samples with start_time_us <= timestamp <= end_time_us.
+     *
+     * Only the blocks overlapping the window are decoded.
+     *
+     * @param timestamps_us Cleared, then filled with the timestamps of the window.
+     * @param values Cleared, then filled with the values of the window.
+     */
+    void decodeWindow(uint64_t start_time_us,
+                      uint64_t end_time_us,
+                      std::vector<uint64_t> &timestamps_us,
+                      std::vector<double> &values) const;
+
+    /**
+     * @brief Get the timestamps, decoding the whole series on first access.
+     */
+    std::span<const uint64_t> getTimestampsUs() const override;
+
+    /**
+     * @brief Get the data values, decoding the whole series on first access.
+     */
+    std::span<const double> getData() const override;
+
+    /**
+     * @brief Replace the data values, re-encoding the series.
+     *
+     * @throws std::invalid_argument If there is not one value per sample.
+     */
+    void setData(const std::vector<double> &data) override;
+    void setData(std::vector<double> &&data) override;
+
+    /**
+     * @brief Compress the data series of another sensor.
+     */
+    void copyFrom(const IWKV &other) override;
+};
+
+#endif // COMPRESSEDWKV_H
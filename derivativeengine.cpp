@@ -0,0 +1,198 @@
+#include "derivativeengine.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+/**
+ * @brief Check whether a sample is kept after the previous sample kept.
+ */
+template<typename Offset>
+bool keeps(Offset previous, Offset next)
+{
+    return next > previous && next - previous > DerivativeEngine::min_interval_us;
+}
+
+/**
+ * @brief Get the interval between the samples if they are evenly spaced and none of them is
+ * skipped, 0 otherwise.
+ */
+template<typename Offset>
+Offset uniformStep(const Offset *t, size_t size)
+{
+    const Offset step = t[1] - t[0];
+    bool uniform = keeps(t[0], t[1]);
+    for (size_t i = 2; i < size; ++i) {
+        uniform &= t[i] > t[i - 1] && t[i] - t[i - 1] == step;
+    }
+    return uniform ? step : 0;
+}
+
+} // namespace
+
+void DerivativeEngine::compute(std::span<const uint64_t> timestamps_us,
+                               std::span<const double> values,
+                               DerivativeSeries &derivatives)
+{
+    compute(TimestampColumn<uint64_t>{timestamps_us}, ValueColumn<double>{values}, derivatives);
+}
+
+template<typename Offset, typename Value>
+void DerivativeEngine::compute(const TimestampColumn<Offset> &timestamps,
+                               const ValueColumn<Value> &values,
+                               DerivativeSeries &derivatives)
+{
+    const size_t size = std::min(timestamps.size(), values.size());
+    const size_t count = size >= 3 ? size - 2 : 0;
+    derivatives.timestamps_us.resize(count);
+    derivatives.velocities.resize(count);
+    derivatives.accelerations.resize(count);
+    if (count == 0) {
+        return;
+    }
+
+    const Offset *t = timestamps.offsets.data();
+    const Value *x = values.samples.data();
+    double *velocities = derivatives.velocities.data();
+    double *accelerations = derivatives.accelerations.data();
+
+    // Resampled series: the spacing is checked once, then a branch-free loop with the same
+    // arithmetic as the non-uniform formulas below, so both paths give the same bits
+    if (const Offset step = uniformStep(t, size)) {
+        const double dt = step / 1e6;
+        const double span = dt + dt;
+        for (size_t i = 0; i < count; ++i) {
+            derivatives.timestamps_us[i] = timestamps[i + 1];
+        }
+        for (size_t i = 0; i < count; ++i) {
+            const double before = values.decode(x[i]), here = values.decode(x[i + 1]),
+                         after = values.decode(x[i + 2]);
+            const double slope_before = (here - before) / dt;
+            const double slope_after = (after - here) / dt;
+            velocities[i] = (slope_before * dt + slope_after * dt) / span;
+            accelerations[i] = 2.0 * (slope_after - slope_before) / span;
+        }
+        return;
+    }
+
+    // Jittered series
+    // previous and current are the last two samples kept, next the candidate
+    size_t written = 0, kept = 0, previous = 0, current = 0;
+    for (size_t next = 0; next < size; ++next) {
+        if (kept > 0 && !keeps(t[current], t[next])) {
+            continue;
+        }
+        if (kept >= 2) {
+            const double dt_before = (t[current] - t[previous]) / 1e6;
+            const double dt_after = (t[next] - t[current]) / 1e6;
+            const double before = values.decode(x[previous]), here = values.decode(x[current]),
+                         after = values.decode(x[next]);
+            const double slope_before = (here - before) / dt_before;
+            const double slope_after = (after - here) / dt_after;
+            const double span = dt_before + dt_after;
+            // Each one-sided slope is weighted by the other interval, which cancels the
+            // first-order error terms of the two slopes
+            derivatives.timestamps_us[written] = timestamps[current];
+            velocities[written] = (slope_before * dt_after + slope_after * dt_before) / span;
+            accelerations[written] = 2.0 * (slope_after - slope_before) / span;
+            ++written;
+        }
+        previous = current;
+        current = next;
+        ++kept;
+    }
+    derivatives.timestamps_us.resize(written);
+    derivatives.velocities.resize(written);
+    derivatives.accelerations.resize(written);
+}
+
+void DerivativeEngine::compute(std::span<const uint64_t> timestamps_us,
+                               std::span<const std::span<const double>> channels,
+                               MultiChannelDerivatives &derivatives)
+{
+    const size_t size = timestamps_us.size();
+    for (const std::span<const double> channel : channels) {
+        if (channel.size() != size) {
+            throw std::invalid_argument("DerivativeEngine: every channel needs one value per timestamp");
+        }
+    }
+    const size_t count = size >= 3 ? size - 2 : 0;
+    derivatives.timestamps_us.resize(count);
+    derivatives.velocities.resize(channels.size());
+    derivatives.accelerations.resize(channels.size());
+    for (size_t c = 0; c < channels.size(); ++c) {
+        derivatives.velocities[c].resize(count);
+        derivatives.accelerations[c].resize(count);
+    }
+    if (count == 0) {
+        return;
+    }
+
+    const uint64_t *t = timestamps_us.data();
+    if (const uint64_t step = uniformStep(t, size)) {
+        // One branch-free loop per channel, as in the single-channel kernel
+        const double dt = step / 1e6;
+        const double span = dt + dt;
+        std::copy(t + 1, t + 1 + count, derivatives.timestamps_us.begin());
+        for (size_t c = 0; c < channels.size(); ++c) {
+            const double *x = channels[c].data();
+            double *velocities = derivatives.velocities[c].data();
+            double *accelerations = derivatives.accelerations[c].data();
+            for (size_t i = 0; i < count; ++i) {
+                const double slope_before = (x[i + 1] - x[i]) / dt;
+                const double slope_after = (x[i + 2] - x[i + 1]) / dt;
+                velocities[i] = (slope_before * dt + slope_after * dt) / span;
+                accelerations[i] = 2.0 * (slope_after - slope_before) / span;
+            }
+        }
+        return;
+    }
+
+    size_t written = 0, kept = 0, previous = 0, current = 0;
+    for (size_t next = 0; next < size; ++next) {
+        if (kept > 0 && !keeps(t[current], t[next])) {
+            continue;
+        }
+        if (kept >= 2) {
+            // The intervals are shared by all channels
+            const double dt_before = (t[current] - t[previous]) / 1e6;
+            const double dt_after = (t[next] - t[current]) / 1e6;
+            const double span = dt_before + dt_after;
+            derivatives.timestamps_us[written] = t[current];
+            for (size_t c = 0; c < channels.size(); ++c) {
+                const double *x = channels[c].data();
+                const double slope_before = (x[current] - x[previous]) / dt_before;
+                const double slope_after = (x[next] - x[current]) / dt_after;
+                derivatives.velocities[c][written] = (slope_before * dt_after + slope_after * dt_before) / span;
+                derivatives.accelerations[c][written] = 2.0 * (slope_after - slope_before) / span;
+            }
+            ++written;
+        }
+        previous = current;
+        current = next;
+        ++kept;
+    }
+    derivatives.timestamps_us.resize(written);
+    for (size_t c = 0; c < channels.size(); ++c) {
+        derivatives.velocities[c].resize(written);
+        derivatives.accelerations[c].resize(written);
+    }
+}
+
+void DerivativeEngine::compute(const WKVView &window, DerivativeSeries &derivatives)
+{
+    compute(window.getTimestampsUs(), window.getData(), derivatives);
+}
+
+template void DerivativeEngine::compute(const TimestampColumn<uint64_t> &,
+                                        const ValueColumn<double> &,
+                                        DerivativeSeries &);
+template void DerivativeEngine::compute(const TimestampColumn<uint32_t> &,
+                                        const ValueColumn<double> &,
+                                        DerivativeSeries &);
+template void DerivativeEngine::compute(const TimestampColumn<uint32_t> &,
+                                        const ValueColumn<float> &,
+                                        DerivativeSeries &);
+template void DerivativeEngine::compute(const TimestampColumn<uint32_t> &,
+                                        const ValueColumn<int16_t> &,
+                                        DerivativeSeries &);
@@ -0,0 +1,106 @@
+#ifndef DERIVATIVEENGINE_H
+#define DERIVATIVEENGINE_H
+
+#include "samplecolumns.h"
+#include "wkvview.h"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @brief First and second derivatives of a series, with the timestamp each sample belongs to.
+ */
+struct DerivativeSeries
+{
+    std::vector<uint64_t> timestamps_us; ///< Timestamps of the samples the derivatives are taken at.
+    std::vector<double> velocities;      ///< First derivative, in units per second.
+    std::vector<double> accelerations;   ///< Second derivative, in units per second squared.
+
+    size_t size() const { return timestamps_us.size(); }
+    bool empty() const { return timestamps_us.empty(); }
+};
+
+/**
+ * @brief First and second derivatives of the channels of a MultiChannelWKV, sharing one
+ * timestamp column.
+ */
+struct MultiChannelDerivatives
+{
+    std::vector<uint64_t> timestamps_us;            ///< Timestamps of the samples the derivatives are taken at.
+    std::vector<std::vector<double>> velocities;    ///< First derivative of every channel.
+    std::vector<std::vector<double>> accelerations; ///< Second derivative of every channel.
+
+    size_t size() const { return timestamps_us.size(); }
+    bool empty() const { return timestamps_us.empty(); }
+};
+
+/**
+ * @brief The DerivativeEngine class computes velocity and acceleration in a single pass.
+ *
+ * Both derivatives are taken at every interior sample with second-order central differences
+ * over the sample and its two neighbours, so the velocity and acceleration of a sample are
+ * centred on its own timestamp. The outputs are sized once and filled by one fused loop:
+ * - on uniformly sampled series (e.g. resampled ones), checked once up front, the loop has no
+ *   branch and constant intervals, so the compiler vectorises it;
+ * - on jittered series the three-point formulas for non-uniform spacing are used, which are
+ *   exact for quadratics, and the samples less than min_interval_us after the previous one kept
+ *   (or going back in time) are skipped, as the original processor did to avoid near-zero
+ *   divisions.
+ * Both loops do the same arithmetic on equal intervals, so a series is differentiated to the same
+ * bits whether it is processed at once or block by block.
+ *
+ * The kernel is templated on the column types so compact storage is differentiated in place,
+ * decoding its samples on the fly. It is instantiated for the columns of IWKV (absolute uint64_t
+ * timestamps, double values) and of CompactWKV (uint32_t offsets, float, double or int16_t).
+ */
+class DerivativeEngine
+{
+public:
+    /// Samples this close to the previous one kept, 1e-5 s, are skipped.
+    static constexpr uint64_t min_interval_us = 10;
+
+    /**
+     * @brief Compute the derivatives at samples 1 to n - 2 of a series.
+     *
+     * @param timestamps_us Increasing timestamps in microseconds.
+     * @param values Values corresponding to the timestamps.
+     * @param derivatives Output, one sample per interior sample kept (at most n - 2, empty below
+     * three samples).
+     */
+    static void compute(std::span<const uint64_t> timestamps_us,
+                        std::span<const double> values,
+                        DerivativeSeries &derivatives);
+
+    /**
+     * @brief Compute the derivatives at samples 1 to n - 2 of a pair of columns.
+     *
+     * The output timestamps are absolute and the derivatives are in decoded units.
+     */
+    template<typename Offset, typename Value>
+    static void compute(const TimestampColumn<Offset> &timestamps,
+                        const ValueColumn<Value> &values,
+                        DerivativeSeries &derivatives);
+
+    /**
+     * @brief Compute the derivatives at samples 1 to n - 2 of channels sharing the same timestamps.
+     *
+     * The intervals of a sample are computed once and used for every channel.
+     *
+     * @param channels The values of every channel, as long as timestamps_us.
+     * @param derivatives Output, with one velocity and acceleration column per channel.
+     * @throws std::invalid_argument if a channel does not have one value per timestamp.
+     */
+    static void compute(std::span<const uint64_t> timestamps_us,
+                        std::span<const std::span<const double>> channels,
+                        MultiChannelDerivatives &derivatives);
+
+    /**
+     * @brief Compute the derivatives at the interior samples of a view.
+     *
+     * The first and last samples of the view are only used as neighbours, so callers that want
+     * derivatives on the edges of a window should widen the view by one sample on each side.
+     */
+    static void compute(const WKVView &window, DerivativeSeries &derivatives);
+};
+
+#endif // DERIVATIVEENGINE_H
@@ -0,0 +1,360 @@
+#include "gaussiansmoother.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// Number of outputs convolved per block in the FIR interior, sized so the block and its input
+// stay in L1 while every tap is applied to it.
+constexpr size_t fir_block_size = 1024;
+
+// Validated before the kernel is allocated. An even kernel has no centre tap: the convolutions
+// would read one sample past the halo.
+int checkedKernelSize(int kernel_size, double sigma)
+{
+    if (kernel_size <= 0 || kernel_size % 2 == 0) {
+        throw std::invalid_argument("GaussianSmoother: the kernel size must be odd and positive.");
+    }
+    if (!(sigma > 0.0)) {
+        throw std::invalid_argument("GaussianSmoother: sigma must be positive.");
+    }
+    return kernel_size;
+}
+
+} // namespace
+
+GaussianSmoother::GaussianSmoother(int kernel_size, double sigma, std::pmr::memory_resource *resource)
+    : kernel_size_(checkedKernelSize(kernel_size, sigma))
+    , sigma_(sigma)
+    , kernel_(kernel_size)
+    , resource_(resource)
+{
+    int half_size = kernel_size / 2;
+    double sum = 0.0;
+
+    for (int i = 0; i < kernel_size; ++i) {
+        int x = i - half_size;
+        kernel_[i] = exp(-0.5 * x * x / (sigma * sigma)) / (sqrt(2 * M_PI) * sigma);
+        sum += kernel_[i];
+    }
+
+    // Normalize the kernel
+    for (int i = 0; i < kernel_size; ++i) {
+        kernel_[i] /= sum;
+    }
+
+    // Young & van Vliet, "Recursive implementation of the Gaussian filter", Signal Processing 44
+    // (1995). The coefficients are normalised by b0 so the filter has a unit DC gain.
+    const double q = sigma >= 2.5 ? 0.98711 * sigma - 0.96330
+                                  : 3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+    const double q2 = q * q, q3 = q2 * q;
+    const double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+    b1_ = (2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0;
+    b2_ = -(1.4281 * q2 + 1.26661 * q3) / b0;
+    b3_ = 0.422205 * q3 / b0;
+    B_ = 1.0 - (b1_ + b2_ + b3_);
+}
+
+int GaussianSmoother::getKernelSize() const
+{
+    return kernel_size_;
+}
+
+double GaussianSmoother::getSigma() const
+{
+    return sigma_;
+}
+
+const std::vector<double> &GaussianSmoother::getKernel() const
+{
+    return kernel_;
+}
+
+void GaussianSmoother::smooth(std::span<const double> data,
+                              std::span<double> smoothed,
+                              SmoothingMode mode) const
+{
+    smooth(ValueColumn<double>{data}, smoothed, mode);
+}
+
+template<typename Value>
+void GaussianSmoother::smooth(const ValueColumn<Value> &data,
+                              std::span<double> smoothed,
+                              SmoothingMode mode) const
+{
+    switch (mode) {
+    case SmoothingMode::Direct:
+        smoothDirect(data, smoothed);
+        break;
+    case SmoothingMode::Fir:
+        smoothFir(data, smoothed);
+        break;
+    case SmoothingMode::Recursive:
+        if (sigma_ < 0.5) {
+            smoothFir(data, smoothed);
+        } else {
+            smoothRecursive(data, smoothed);
+        }
+        break;
+    }
+}
+
+template<typename Value>
+void GaussianSmoother::smoothDirect(const ValueColumn<Value> &data,
+                                   std::span<double> smoothed) const
+{
+    const int half_size = kernel_size_ / 2;
+    const long long size = static_cast<long long>(data.size());
+
+    for (long long i = 0; i < size; ++i) {
+        double sum = 0.0;
+        for (int j = -half_size; j <= half_size; ++j) {
+            long long idx = i + j;
+            if (idx >= 0 && idx < size) {
+                sum += data[idx] * kernel_[half_size + j];
+            }
+        }
+        smoothed[i] = sum;
+    }
+}
+
+template<typename Value>
+void GaussianSmoother::smoothFir(const ValueColumn<Value> &data,
+                                std::span<double> smoothed) const
+{
+    // Borders: the only outputs whose kernel reaches outside of the series.
+    const auto [head_end, tail_begin] = firInterior(data.size());
+    for (size_t i = 0; i < head_end; ++i) {
+        firBorder(data, smoothed, i);
+    }
+    for (size_t i = tail_begin; i < data.size(); ++i) {
+        firBorder(data, smoothed, i);
+    }
+
+    for (size_t block = head_end; block < tail_begin; block += fir_block_size) {
+        firBlock(data, smoothed, block, std::min(block + fir_block_size, tail_begin));
+    }
+}
+
+/**
+ * @brief Get the outputs [head_end, tail_begin) of a series whose kernel stays inside it.
+ */
+std::pair<size_t, size_t> GaussianSmoother::firInterior(size_t size) const
+{
+    const size_t half_size = kernel_size_ / 2;
+    const size_t head_end = std::min(half_size, size);
+    const size_t tail_begin = std::max(head_end, size > half_size ? size - half_size : 0);
+    return {head_end, tail_begin};
+}
+
+template<typename Value>
+void GaussianSmoother::firBorder(const ValueColumn<Value> &data, std::span<double> smoothed, size_t i) const
+{
+    const size_t half_size = kernel_size_ / 2;
+    const size_t size = data.size();
+    double sum = 0.0;
+    for (size_t j = 0; j < kernel_.size(); ++j) {
+        const long long idx = static_cast<long long>(i + j) - static_cast<long long>(half_size);
+        if (idx >= 0 && idx < static_cast<long long>(size)) {
+            sum += data[idx] * kernel_[j];
+        }
+    }
+    smoothed[i] = sum;
+}
+
+/**
+ * @brief Convolve the interior outputs [begin, end).
+ *
+ * Taps in the outer loop so the inner loop is a branch-free multiply-add over contiguous samples
+ * that the compiler vectorises. Adding the taps in order keeps the summation order, and
+ * therefore the result, identical to the direct convolution.
+ */
+template<typename Value>
+void GaussianSmoother::firBlock(const ValueColumn<Value> &data,
+                                std::span<double> smoothed,
+                                size_t begin,
+                                size_t end) const
+{
+    const size_t half_size = kernel_size_ / 2;
+    const double *kernel = kernel_.data();
+    double *out = smoothed.data();
+    std::fill(out + begin, out + end, 0.0);
+    for (size_t j = 0; j < kernel_.size(); ++j) {
+        const double k = kernel[j];
+        const Value *in = data.samples.data() + j;
+        for (size_t i = begin; i < end; ++i) {
+            out[i] += k * data.decode(in[i - half_size]);
+        }
+    }
+}
+
+template<typename Value>
+void GaussianSmoother::smoothRecursive(const ValueColumn<Value> &data,
+                                      std::span<double> smoothed) const
+{
+    const size_t size = data.size();
+    if (size == 0) {
+        return;
+    }
+
+    // The causal pass starts from a zero state, which is exactly zero padding on the left. The
+    // anti-causal pass needs the causal response to the zeros past the end, so the causal pass
+    // runs over a tail of zeros long enough for the filter response to have decayed.
+    const size_t tail = static_cast<size_t>(std::ceil(6.0 * sigma_)) + 3;
+    std::pmr::vector<double> forward(size + tail, resource_);
+
+    double w1 = 0.0, w2 = 0.0, w3 = 0.0;
+    for (size_t i = 0; i < size + tail; ++i) {
+        const double x = i < size ? data[i] : 0.0;
+        const double w = B_ * x + b1_ * w1 + b2_ * w2 + b3_ * w3;
+        forward[i] = w;
+        w3 = w2;
+        w2 = w1;
+        w1 = w;
+    }
+
+    double y1 = 0.0, y2 = 0.0, y3 = 0.0;
+    for (size_t i = size + tail; i-- > 0;) {
+        const double y = B_ * forward[i] + b1_ * y1 + b2_ * y2 + b3_ * y3;
+        if (i < size) {
+            smoothed[i] = y;
+        }
+        y3 = y2;
+        y2 = y1;
+        y1 = y;
+    }
+}
+
+void GaussianSmoother::smooth(std::span<const std::span<const double>> channels,
+                              std::span<const std::span<double>> smoothed,
+                              SmoothingMode mode) const
+{
+    if (smoothed.size() != channels.size()) {
+        throw std::invalid_argument("GaussianSmoother: one output is needed per channel.");
+    }
+    for (size_t c = 0; c < channels.size(); ++c) {
+        if (channels[c].size() != channels.front().size() || smoothed[c].size() != channels[c].size()) {
+            throw std::invalid_argument("GaussianSmoother: the channels and outputs must have the same size.");
+        }
+    }
+    if (channels.empty()) {
+        return;
+    }
+
+    switch (mode) {
+    case SmoothingMode::Direct:
+        smoothDirect(channels, smoothed);
+        break;
+    case SmoothingMode::Fir:
+        smoothFir(channels, smoothed);
+        break;
+    case SmoothingMode::Recursive:
+        if (sigma_ < 0.5) {
+            smoothFir(channels, smoothed);
+        } else {
+            smoothRecursive(channels, smoothed);
+        }
+        break;
+    }
+}
+
+/**
+ * @brief Direct convolution of every channel, clipping the kernel to the series once per sample.
+ */
+void GaussianSmoother::smoothDirect(std::span<const std::span<const double>> channels,
+                                    std::span<const std::span<double>> smoothed) const
+{
+    const long long half_size = kernel_size_ / 2;
+    const long long size = static_cast<long long>(channels.front().size());
+
+    for (long long i = 0; i < size; ++i) {
+        // Same taps, in the same order, as the single channel loop skipping the outside samples
+        const long long j_first = std::max(-half_size, -i);
+        const long long j_last = std::min(half_size, size - 1 - i);
+        for (size_t c = 0; c < channels.size(); ++c) {
+            double sum = 0.0;
+            for (long long j = j_first; j <= j_last; ++j) {
+                sum += channels[c][i + j] * kernel_[half_size + j];
+            }
+            smoothed[c][i] = sum;
+        }
+    }
+}
+
+/**
+ * @brief FIR convolution of every channel, block by block so a block of every channel is
+ * convolved before moving on.
+ */
+void GaussianSmoother::smoothFir(std::span<const std::span<const double>> channels,
+                                 std::span<const std::span<double>> smoothed) const
+{
+    const size_t size = channels.front().size();
+    const auto [head_end, tail_begin] = firInterior(size);
+    for (size_t c = 0; c < channels.size(); ++c) {
+        const ValueColumn<double> data{channels[c]};
+        for (size_t i = 0; i < head_end; ++i) {
+            firBorder(data, smoothed[c], i);
+        }
+        for (size_t i = tail_begin; i < size; ++i) {
+            firBorder(data, smoothed[c], i);
+        }
+    }
+
+    for (size_t block = head_end; block < tail_begin; block += fir_block_size) {
+        const size_t block_end = std::min(block + fir_block_size, tail_begin);
+        for (size_t c = 0; c < channels.size(); ++c) {
+            firBlock(ValueColumn<double>{channels[c]}, smoothed[c], block, block_end);
+        }
+    }
+}
+
+/**
+ * @brief Recursive filter of every channel, stepping all the channel states at each sample.
+ *
+ * The causal responses are stored sample-major, so a step reads and writes the channels of one
+ * sample contiguously.
+ */
+void GaussianSmoother::smoothRecursive(std::span<const std::span<const double>> channels,
+                                       std::span<const std::span<double>> smoothed) const
+{
+    const size_t size = channels.front().size();
+    const size_t channel_count = channels.size();
+    if (size == 0) {
+        return;
+    }
+
+    const size_t tail = static_cast<size_t>(std::ceil(6.0 * sigma_)) + 3;
+    std::pmr::vector<double> forward((size + tail) * channel_count, resource_);
+    std::pmr::vector<double> state(3 * channel_count, 0.0, resource_);
+
+    for (size_t i = 0; i < size + tail; ++i) {
+        for (size_t c = 0; c < channel_count; ++c) {
+            double *s = state.data() + 3 * c;
+            const double x = i < size ? channels[c][i] : 0.0;
+            const double w = B_ * x + b1_ * s[0] + b2_ * s[1] + b3_ * s[2];
+            forward[i * channel_count + c] = w;
+            s[2] = s[1];
+            s[1] = s[0];
+            s[0] = w;
+        }
+    }
+
+    std::fill(state.begin(), state.end(), 0.0);
+    for (size_t i = size + tail; i-- > 0;) {
+        for (size_t c = 0; c < channel_count; ++c) {
+            double *s = state.data() + 3 * c;
+            const double y = B_ * forward[i * channel_count + c] + b1_ * s[0] + b2_ * s[1] + b3_ * s[2];
+            if (i < size) {
+                smoothed[c][i] = y;
+            }
+            s[2] = s[1];
+            s[1] = s[0];
+            s[0] = y;
+        }
+    }
+}
+
+template void GaussianSmoother::smooth(const ValueColumn<double> &, std::span<double>, SmoothingMode) const;
+template void GaussianSmoother::smooth(const ValueColumn<float> &, std::span<double>, SmoothingMode) const;
+template void GaussianSmoother::smooth(const ValueColumn<int16_t> &, std::span<double>, SmoothingMode) const;
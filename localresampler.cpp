@@ -0,0 +1,292 @@
+#include "localresampler.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+/**
+ * @brief First grid instant start + k * step that is >= first.
+ */
+uint64_t firstGridInstant(uint64_t start_time_us, uint64_t step_us, uint64_t first)
+{
+    if (first <= start_time_us) {
+        return start_time_us;
+    }
+    return start_time_us + (first - start_time_us + step_us - 1) / step_us * step_us;
+}
+
+/**
+ * @brief Samples an output instant is interpolated from, and their weights.
+ *
+ * Every mode is a linear combination of at most four samples whose weights only depend on the
+ * timestamps, so the weights are computed once per instant and applied to every channel.
+ */
+struct Stencil
+{
+    size_t first = 0;   ///< Index of the first sample.
+    size_t count = 0;   ///< Number of samples, up to four.
+    double weights[4]{}; ///< Weight of every sample.
+
+    template<typename Column>
+    double apply(const Column &data) const
+    {
+        double sum = 0.0;
+        for (size_t i = 0; i < count; ++i) {
+            sum += weights[i] * data[first + i];
+        }
+        return sum;
+    }
+};
+
+Stencil linear(double t, double t0, double t1, size_t first)
+{
+    const double fraction = (t - t0) / (t1 - t0);
+    return {first, 2, {1.0 - fraction, fraction}};
+}
+
+/**
+ * @brief Cubic Hermite on [t1, t2] with tangents estimated by central differences.
+ */
+Stencil catmullRom(double t, const double *times, size_t first)
+{
+    const double h = times[2] - times[1];
+    const double s = (t - times[1]) / h;
+    const double s2 = s * s, s3 = s2 * s;
+    // Hermite basis, then the tangents expanded on the four samples
+    const double h00 = 2 * s3 - 3 * s2 + 1, h10 = s3 - 2 * s2 + s, h01 = -2 * s3 + 3 * s2,
+                 h11 = s3 - s2;
+    const double g1 = h10 * h / (times[2] - times[0]);
+    const double g2 = h11 * h / (times[3] - times[1]);
+    return {first, 4, {-g1, h00 - g2, h01 + g1, g2}};
+}
+
+/**
+ * @brief Cubic Lagrange polynomial through four points.
+ */
+Stencil lagrange(double t, const double *times, size_t first)
+{
+    Stencil stencil{first, 4};
+    for (int i = 0; i < 4; ++i) {
+        double weight = 1.0;
+        for (int j = 0; j < 4; ++j) {
+            if (j != i) {
+                weight *= (t - times[j]) / (times[i] - times[j]);
+            }
+        }
+        stencil.weights[i] = weight;
+    }
+    return stencil;
+}
+
+/**
+ * @brief Walk the grid instants of a window and give the stencil of each to interpolate(k, stencil).
+ *
+ * The cursor and the timestamp arithmetic are shared by every channel interpolated at the instant.
+ *
+ * @return size_t The number of instants, count.
+ */
+template<typename Offset, typename Interpolate>
+size_t walkGrid(InterpolationMode mode,
+                const TimestampColumn<Offset> &timestamps,
+                size_t count,
+                uint64_t start_time_us,
+                uint64_t step_us,
+                std::span<uint64_t> timestamps_us,
+                Interpolate &&interpolate)
+{
+    const size_t size = timestamps.size();
+    const uint64_t origin_us = timestamps[0];
+    auto relative = [&](size_t i) { return static_cast<double>(timestamps[i] - origin_us); };
+
+    uint64_t current_time_us = firstGridInstant(start_time_us, step_us, origin_us);
+    size_t cursor = 0; // timestamps[cursor] <= current_time_us <= timestamps[cursor + 1]
+
+    for (size_t k = 0; k < count; ++k, current_time_us += step_us) {
+        while (cursor + 2 < size && timestamps[cursor + 1] < current_time_us) {
+            ++cursor;
+        }
+        timestamps_us[k] = current_time_us;
+
+        if (size == 1) {
+            interpolate(k, Stencil{0, 1, {1.0}});
+            continue;
+        }
+
+        const double t = static_cast<double>(current_time_us - origin_us);
+        if (mode == InterpolationMode::Linear || size < 4) {
+            interpolate(k, linear(t, relative(cursor), relative(cursor + 1), cursor));
+            continue;
+        }
+
+        // Four-point stencil around the interval, shifted inwards on the window edges
+        const size_t first = std::clamp<size_t>(cursor, 1, size - 3) - 1;
+        double times[4];
+        for (int i = 0; i < 4; ++i) {
+            times[i] = relative(first + i);
+        }
+
+        if (mode == InterpolationMode::CatmullRom && first + 1 == cursor) {
+            interpolate(k, catmullRom(t, times, first));
+        } else if (mode == InterpolationMode::CatmullRom) {
+            // Edge intervals have no neighbour on one side: fall back to linear
+            interpolate(k, linear(t, relative(cursor), relative(cursor + 1), cursor));
+        } else {
+            interpolate(k, lagrange(t, times, first));
+        }
+    }
+    return count;
+}
+
+} // namespace
+
+LocalResampler::LocalResampler(InterpolationMode mode)
+    : mode_(mode)
+{
+    if (mode_ == InterpolationMode::Polyphase) {
+        throw std::invalid_argument("LocalResampler: the polyphase filter is not a local interpolation.");
+    }
+}
+
+size_t LocalResampler::outputSize(const WKVView &window,
+                                  uint64_t start_time_us,
+                                  uint64_t end_time_us,
+                                  uint64_t step_us)
+{
+    return outputSize(window.getTimestampsUs(), start_time_us, end_time_us, step_us);
+}
+
+size_t LocalResampler::resample(const WKVView &window,
+                                uint64_t start_time_us,
+                                uint64_t end_time_us,
+                                uint64_t step_us,
+                                std::span<uint64_t> timestamps_us,
+                                std::span<double> values) const
+{
+    return resample(window.getTimestampsUs(),
+                    window.getData(),
+                    start_time_us,
+                    end_time_us,
+                    step_us,
+                    timestamps_us,
+                    values);
+}
+
+size_t LocalResampler::outputSize(std::span<const uint64_t> timestamps,
+                                  uint64_t start_time_us,
+                                  uint64_t end_time_us,
+                                  uint64_t step_us)
+{
+    return outputSize(TimestampColumn<uint64_t>{timestamps}, start_time_us, end_time_us, step_us);
+}
+
+size_t LocalResampler::resample(std::span<const uint64_t> timestamps,
+                                std::span<const double> data,
+                                uint64_t start_time_us,
+                                uint64_t end_time_us,
+                                uint64_t step_us,
+                                std::span<uint64_t> timestamps_us,
+                                std::span<double> values) const
+{
+    return resample(TimestampColumn<uint64_t>{timestamps},
+                    ValueColumn<double>{data},
+                    start_time_us,
+                    end_time_us,
+                    step_us,
+                    timestamps_us,
+                    values);
+}
+
+template<typename Offset>
+size_t LocalResampler::outputSize(const TimestampColumn<Offset> &timestamps,
+                                  uint64_t start_time_us,
+                                  uint64_t end_time_us,
+                                  uint64_t step_us)
+{
+    if (timestamps.empty() || step_us == 0) {
+        return 0;
+    }
+    const uint64_t first = firstGridInstant(start_time_us, step_us, timestamps[0]);
+    const uint64_t last = std::min(end_time_us, timestamps[timestamps.size() - 1]);
+    return first > last ? 0 : (last - first) / step_us + 1;
+}
+
+template<typename Offset, typename Value>
+size_t LocalResampler::resample(const TimestampColumn<Offset> &timestamps,
+                                const ValueColumn<Value> &data,
+                                uint64_t start_time_us,
+                                uint64_t end_time_us,
+                                uint64_t step_us,
+                                std::span<uint64_t> timestamps_us,
+                                std::span<double> values) const
+{
+    const size_t count = outputSize(timestamps, start_time_us, end_time_us, step_us);
+    if (count == 0) {
+        return 0;
+    }
+
+    return walkGrid(mode_,
+                    timestamps,
+                    count,
+                    start_time_us,
+                    step_us,
+                    timestamps_us,
+                    [&](size_t k, const Stencil &stencil) { values[k] = stencil.apply(data); });
+}
+
+size_t LocalResampler::resample(std::span<const uint64_t> input_timestamps_us,
+                                std::span<const std::span<const double>> input_channels,
+                                uint64_t start_time_us,
+                                uint64_t end_time_us,
+                                uint64_t step_us,
+                                std::span<uint64_t> timestamps_us,
+                                std::span<const std::span<double>> channels) const
+{
+    const TimestampColumn<uint64_t> timestamps{input_timestamps_us};
+    const size_t count = outputSize(timestamps, start_time_us, end_time_us, step_us);
+    if (count == 0) {
+        return 0;
+    }
+    return walkGrid(mode_,
+                    timestamps,
+                    count,
+                    start_time_us,
+                    step_us,
+                    timestamps_us,
+                    [&](size_t k, const Stencil &stencil) {
+                        for (size_t c = 0; c < input_channels.size(); ++c) {
+                            channels[c][k] = stencil.apply(input_channels[c]);
+                        }
+                    });
+}
+
+template size_t LocalResampler::outputSize(const TimestampColumn<uint64_t> &, uint64_t, uint64_t, uint64_t);
+template size_t LocalResampler::outputSize(const TimestampColumn<uint32_t> &, uint64_t, uint64_t, uint64_t);
+
+template size_t LocalResampler::resample(const TimestampColumn<uint64_t> &,
+                                         const ValueColumn<double> &,
+                                         uint64_t,
+                                         uint64_t,
+                                         uint64_t,
+                                         std::span<uint64_t>,
+                                         std::span<double>) const;
+template size_t LocalResampler::resample(const TimestampColumn<uint32_t> &,
+                                         const ValueColumn<double> &,
+                                         uint64_t,
+                                         uint64_t,
+                                         uint64_t,
+                                         std::span<uint64_t>,
+                                         std::span<double>) const;
+template size_t LocalResampler::resample(const TimestampColumn<uint32_t> &,
+                                         const ValueColumn<float> &,
+                                         uint64_t,
+                                         uint64_t,
+                                         uint64_t,
+                                         std::span<uint64_t>,
+                                         std::span<double>) const;
+template size_t LocalResampler::resample(const TimestampColumn<uint32_t> &,
+                                         const ValueColumn<int16_t> &,
+                                         uint64_t,
+                                         uint64_t,
+                                         uint64_t,
+                                         std::span<uint64_t>,
+                                         std::span<double>) const;
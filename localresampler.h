@@ -0,0 +1,138 @@
+#ifndef LOCALRESAMPLER_H
+#define LOCALRESAMPLER_H
+
+#include "samplecolumns.h"
+#include "wkvview.h"
+#include <span>
+
+/**
+ * @brief Selects the interpolation used to resample a series.
+ */
+enum class InterpolationMode {
+    /// Global cardinal cubic B-spline. Assumes uniformly spaced samples, kept for reference.
+    CardinalSpline,
+    /// Piecewise linear interpolation between the two surrounding samples.
+    Linear,
+    /// Cubic Hermite interpolation with Catmull-Rom tangents computed on the real timestamps.
+    CatmullRom,
+    /// Cubic Lagrange interpolation through the four surrounding samples at their real timestamps.
+    Cubic,
+    /// Anti-aliased polyphase FIR rate conversion of a uniform series, see PolyphaseResampler.
+    Polyphase,
+};
+
+/**
+ * @brief The LocalResampler class resamples a jittered series onto a uniform time grid.
+ *
+ * Unlike a cardinal spline, it uses the real, non-uniform timestamps of the samples. It walks a
+ * monotone cursor through the input and only looks at the samples surrounding each output
+ * instant, so the cost is proportional to the window length and no global state is built.
+ * Interpolation is done on time relative to the first sample of the window, which keeps full
+ * double precision instead of working on absolute epoch microseconds.
+ */
+class LocalResampler
+{
+private:
+    InterpolationMode mode_; ///< Interpolation used between samples.
+
+public:
+    /**
+     * @brief Construct a new LocalResampler.
+     *
+     * @param mode The interpolation, one of Linear, CatmullRom or Cubic.
+     */
+    explicit LocalResampler(InterpolationMode mode);
+
+    /**
+     * @brief Count the grid instants start_time_us + k * step_us <= end_time_us that fall within
+     * the time span covered by a window.
+     *
+     * @return size_t The number of samples resample() writes for the same arguments.
+     */
+    static size_t outputSize(const WKVView &window,
+                             uint64_t start_time_us,
+                             uint64_t end_time_us,
+                             uint64_t step_us);
+
+    /**
+     * @brief Interpolate a window at the grid instants start_time_us + k * step_us <= end_time_us.
+     *
+     * Instants outside the time span covered by the window are skipped.
+     *
+     * @param window The samples to interpolate, with sorted timestamps.
+     * @param timestamps_us Output timestamps, at least outputSize() long.
+     * @param values Output values, at least outputSize() long.
+     * @return size_t The number of samples written.
+     */
+    size_t resample(const WKVView &window,
+                    uint64_t start_time_us,
+                    uint64_t end_time_us,
+                    uint64_t step_us,
+                    std::span<uint64_t> timestamps_us,
+                    std::span<double> values) const;
+
+    /**
+     * @brief Same as outputSize(const WKVView &, ...) on raw sorted timestamps.
+     */
+    static size_t outputSize(std::span<const uint64_t> input_timestamps_us,
+                             uint64_t start_time_us,
+                             uint64_t end_time_us,
+                             uint64_t step_us);
+
+    /**
+     * @brief Same as resample(const WKVView &, ...) on raw sorted timestamps and values.
+     */
+    size_t resample(std::span<const uint64_t> input_timestamps_us,
+                    std::span<const double> input_data,
+                    uint64_t start_time_us,
+                    uint64_t end_time_us,
+                    uint64_t step_us,
+                    std::span<uint64_t> timestamps_us,
+                    std::span<double> values) const;
+
+    /**
+     * @brief Interpolate several channels sharing the same timestamps in one pass.
+     *
+     * The grid walk and the interpolation weights are computed once per output instant and
+     * applied to every channel, see MultiChannelWKV.
+     *
+     * @param input_channels The values of every channel, as long as input_timestamps_us.
+     * @param channels Output values of every channel, each at least outputSize() long.
+     * @return size_t The number of samples written to every channel.
+     */
+    size_t resample(std::span<const uint64_t> input_timestamps_us,
+                    std::span<const std::span<const double>> input_channels,
+                    uint64_t start_time_us,
+                    uint64_t end_time_us,
+                    uint64_t step_us,
+                    std::span<uint64_t> timestamps_us,
+                    std::span<const std::span<double>> channels) const;
+
+    /**
+     * @brief Same as outputSize(const WKVView &, ...) on a timestamp column.
+     *
+     * Instantiated for uint64_t and uint32_t offsets.
+     */
+    template<typename Offset>
+    static size_t outputSize(const TimestampColumn<Offset> &input_timestamps,
+                             uint64_t start_time_us,
+                             uint64_t end_time_us,
+                             uint64_t step_us);
+
+    /**
+     * @brief Same as resample(const WKVView &, ...) on compact columns, decoded on the fly.
+     *
+     * Instantiated for the IWKV columns and for uint32_t offsets with double, float or int16_t
+     * values. The output is in absolute microseconds and decoded units.
+     */
+    template<typename Offset, typename Value>
+    size_t resample(const TimestampColumn<Offset> &input_timestamps,
+                    const ValueColumn<Value> &input_data,
+                    uint64_t start_time_us,
+                    uint64_t end_time_us,
+                    uint64_t step_us,
+                    std::span<uint64_t> timestamps_us,
+                    std::span<double> values) const;
+};
+
+#endif // LOCALRESAMPLER_H
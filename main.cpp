@@ -1,109 +1,145 @@
-#include <QApplication>
-#include "mainwindow.h"
-#include "sensordataprocessor.h"
-#include "wkvfactory.h"
-#include <iostream>
-
-int main(int argc, char *argv[])
-{
-    QApplication a(argc, argv);
-    MainWindow w;
-
-    // Create sensors using the factory method
-    auto hip_angle_sensor = WKVFactory::createSensor("HIP", "hip_sensor");
-    auto imu_sensor = WKVFactory::createSensor("IMU", "3-axis-IMU");
-
-    // Ensure sensors were created successfully
-    if (!hip_angle_sensor || !imu_sensor) {
-        std::cerr << "Failed to create sensors." << std::endl;
-        return -1; // Exit if sensors weren't created
-    }
-
-    QObject::connect(hip_angle_sensor.get(), &IWKV::sensorDataReady, &w, &MainWindow::updateUI);
-    QObject::connect(imu_sensor.get(), &IWKV::sensorDataReady, &w, &MainWindow::updateUI);
-
-    // Sensor data generation
-    hip_angle_sensor->generateData(1000, 0.02, 20);
-    imu_sensor->generateData(400, 0.03, 20, hip_angle_sensor.get());
-
-    // Resampling to 100Hz
-    auto hip_angle_resampled_sensor = WKVFactory::createSensor("HIP", "hip_sensor_resampled");
-    auto imu_resampled_sensor = WKVFactory::createSensor("IMU", "3-axis-IMU-resampled");
-    // Ensure sensors were created successfully
-    if (!hip_angle_resampled_sensor || !imu_resampled_sensor) {
-        std::cerr << "Failed to create sensors." << std::endl;
-        return -1; // Exit if sensors weren't created
-    }
-    QObject::connect(hip_angle_resampled_sensor.get(),
-                     &IWKV::sensorDataReady,
-                     &w,
-                     &MainWindow::updateUI);
-    QObject::connect(imu_resampled_sensor.get(), &IWKV::sensorDataReady, &w, &MainWindow::updateUI);
-
-    SensorDataProcessor processor;
-
-    // Window
-    constexpr auto start_time_s = 2.7, end_time_s = 4.8;
-
-    processor.resampleData(hip_angle_sensor.get(),
-                           hip_angle_resampled_sensor.get(),
-                           100,
-                           start_time_s,
-                           end_time_s);
-    processor.resampleData(imu_sensor.get(),
-                           imu_resampled_sensor.get(),
-                           100,
-                           start_time_s,
-                           end_time_s);
-
-    // Finding peaks
-    QObject::connect(&processor,
-                     &SensorDataProcessor::peaksDataReady,
-                     &w,
-                     &MainWindow::updateUIWithPeaks);
-
-    const auto hip_peaks_window = processor.findPeaks(hip_angle_resampled_sensor.get(),
-                                                      start_time_s,
-                                                      end_time_s);
-
-    // Smooth signal before velocity and acceleration calculation
-
-    auto imu_resampled_smoothed_sensor = WKVFactory::createSensor("IMU",
-                                                                  "3-axis-IMU-smoothed-resampled");
-    // Ensure sensors were created successfully
-    if (!imu_resampled_smoothed_sensor) {
-        std::cerr << "Failed to create sensor." << std::endl;
-        return -1; // Exit if sensors weren't created
-    }
-    QObject::connect(imu_resampled_smoothed_sensor.get(),
-                     &IWKV::sensorDataReady,
-                     &w,
-                     &MainWindow::updateUI);
-
-    // Copy data from non smoothed imu sensor to smoothed imu sensor
-    imu_resampled_smoothed_sensor->copyFrom(*imu_resampled_sensor);
-
-    processor.applyGaussianSmoothing(*imu_resampled_smoothed_sensor, 19, 3);
-
-    std::vector<double> velocities_hip, velocities_imu;
-    std::vector<double> accelerations_hip, accelerations_imu;
-
-    processor.calculateVelocityAndAcceleration(*hip_angle_resampled_sensor,
-                                               start_time_s,
-                                               end_time_s,
-                                               velocities_hip,
-                                               accelerations_hip);
-
-    processor.calculateVelocityAndAcceleration(*imu_resampled_smoothed_sensor,
-                                               start_time_s,
-                                               end_time_s,
-                                               velocities_imu,
-                                               accelerations_imu);
-
-    // Update UI with sensor data, velocities, and accelerations
-    w.updateUIWithVelocities(*hip_angle_resampled_sensor, velocities_hip, accelerations_hip);
-    w.updateUIWithVelocities(*imu_resampled_smoothed_sensor, velocities_imu, accelerations_imu);
-
-    w.show();
-    return a.exec();
-}
+#include <QApplication>
+#include "mainwindow.h"
+#include "processinggraph.h"
+#include "sensordataprocessor.h"
+#include "taskgraph.h"
+#include "wkvfactory.h"
+#include <iostream>
+
+int main(int argc, char *argv[])
+{
+    QApplication a(argc, argv);
+    MainWindow w;
+
+    // Create sensors using the factory method
+    auto hip_angle_sensor = WKVFactory::createSensor("HIP", "hip_sensor");
+    auto imu_sensor = WKVFactory::createSensor("IMU", "3-axis-IMU");
+
+    // Ensure sensors were created successfully
+    if (!hip_angle_sensor || !imu_sensor) {
+        std::cerr << "Failed to create sensors." << std::endl;
+        return -1; // Exit if sensors weren't created
+    }
+
+    // Resampling to 100Hz
+    auto hip_angle_resampled_sensor = WKVFactory::createSensor("HIP", "hip_sensor_resampled");
+    auto imu_resampled_sensor = WKVFactory::createSensor("IMU", "3-axis-IMU-resampled");
+    auto imu_resampled_smoothed_sensor = WKVFactory::createSensor("IMU",
+                                                                  "3-axis-IMU-smoothed-resampled");
+    // Ensure sensors were created successfully
+    if (!hip_angle_resampled_sensor || !imu_resampled_sensor || !imu_resampled_smoothed_sensor) {
+        std::cerr << "Failed to create sensors." << std::endl;
+        return -1; // Exit if sensors weren't created
+    }
+
+    // Window
+    constexpr auto start_time_s = 2.7, end_time_s = 4.8;
+
+    // Shared by the tasks of the hip chain, including those running in parallel
+    SensorDataProcessor hip_processor;
+
+    // IMU chain, declared once and evaluated lazily: only the window and the halos of the filters
+    // are computed, and a moved window reuses the cached tiles. Its tasks run one after the other.
+    ProcessingGraph imu_graph;
+    const auto imu_resampling = imu_graph.addResampling(*imu_sensor, 100);
+    const auto imu_smoothing = imu_graph.addSmoothing(imu_resampling, 19, 3, SmoothingMode::Fir);
+    const auto imu_derivatives_node = imu_graph.addDerivatives(imu_smoothing);
+
+    PeakSeries hip_peaks_window;
+    DerivativeSeries derivatives_hip, derivatives_imu;
+
+    // The stages run on worker threads. Results are handed to the window through queued calls, once
+    // a sensor is no longer modified, since the plots read the sensor columns in place.
+    auto publish = [&w](const IWKV &sensor) {
+        QMetaObject::invokeMethod(&w, [&w, &sensor] { w.updateUI(sensor); }, Qt::QueuedConnection);
+    };
+
+    // Blocks appended to the recordings later on, e.g. by a live acquisition, extend their plots
+    w.followSensor(*hip_angle_sensor);
+    w.followSensor(*imu_sensor);
+
+    // Declared after the sensors and results so that it is destroyed, and waited for, first
+    TaskGraph graph;
+
+    // Sensor data generation
+    const auto hip_generated = graph.addTask("hip generation", [&] {
+        hip_angle_sensor->generateData(1000, 0.02, 20);
+        publish(*hip_angle_sensor);
+    });
+    const auto imu_generated = graph.addTask("imu generation", [&] {
+        imu_sensor->generateData(400, 0.03, 20, hip_angle_sensor.get());
+        publish(*imu_sensor);
+    }, {hip_generated});
+
+    // Hip chain: resampling, then peaks and derivatives in parallel
+    const auto hip_resampled = graph.addTask("hip resampling", [&] {
+        hip_processor.resampleData(hip_angle_sensor.get(),
+                                   hip_angle_resampled_sensor.get(),
+                                   100,
+                                   start_time_s,
+                                   end_time_s);
+    }, {hip_generated});
+    const auto hip_peaks = graph.addTask("hip peaks", [&] {
+        // Gait cycles: at least 10 deg of prominence and half a second (50 samples) apart
+        PeakCriteria criteria;
+        criteria.prominence = 10.0;
+        criteria.distance = 50;
+        hip_processor.findPeaks(hip_angle_resampled_sensor.get(),
+                                start_time_s,
+                                end_time_s,
+                                criteria,
+                                hip_peaks_window);
+    }, {hip_resampled});
+    const auto hip_derivatives = graph.addTask("hip derivatives", [&] {
+        hip_processor.calculateVelocityAndAcceleration(*hip_angle_resampled_sensor,
+                                                       start_time_s,
+                                                       end_time_s,
+                                                       derivatives_hip);
+    }, {hip_resampled});
+    graph.addTask("hip publication", [&] {
+        QMetaObject::invokeMethod(&w, [&] {
+            w.updateUIWithVelocities(*hip_angle_resampled_sensor, derivatives_hip);
+            w.updateUIWithPeaks(*hip_angle_resampled_sensor,
+                                hip_peaks_window.timestamps_us,
+                                hip_angle_resampled_sensor->getName());
+        }, Qt::QueuedConnection);
+    }, {hip_peaks, hip_derivatives});
+
+    // IMU chain: resampling, smoothing, then derivatives
+    // Fill a sensor with a node of the IMU graph over the window
+    auto evaluateInto = [&](ProcessingGraph::NodeId node, WKV &sensor) {
+        std::vector<uint64_t> timestamps;
+        std::vector<double> values;
+        imu_graph.evaluate(node, start_time_s, end_time_s, timestamps, values);
+        sensor.setTimestampsUs(std::move(timestamps));
+        sensor.setData(std::move(values));
+        sensor.setStartTimeUs(imu_sensor->getStartTimeUs());
+    };
+    const auto imu_resampled = graph.addTask("imu resampling", [&] {
+        evaluateInto(imu_resampling, *imu_resampled_sensor);
+        publish(*imu_resampled_sensor);
+    }, {imu_generated});
+    const auto imu_smoothed = graph.addTask("imu smoothing", [&] {
+        evaluateInto(imu_smoothing, *imu_resampled_smoothed_sensor);
+    }, {imu_resampled});
+    const auto imu_derivatives = graph.addTask("imu derivatives", [&] {
+        imu_graph.evaluate(imu_derivatives_node, start_time_s, end_time_s, derivatives_imu);
+    }, {imu_smoothed});
+    graph.addTask("imu publication", [&] {
+        QMetaObject::invokeMethod(&w, [&] {
+            w.updateUIWithVelocities(*imu_resampled_smoothed_sensor, derivatives_imu);
+        }, Qt::QueuedConnection);
+    }, {imu_derivatives});
+
+    // Show the window at once, the plots appear as their chains complete
+    w.show();
+    graph.start();
+    const int result = a.exec();
+
+    try {
+        graph.wait();
+    } catch (const std::exception &e) {
+        std::cerr << "Processing failed: " << e.what() << std::endl;
+    }
+    return result;
+}
@@ -1,176 +1,180 @@
-#include "mainwindow.h"
-#include <QtCharts/QChart>
-#include <QtCharts/QChartView>
-#include <QtCharts/QLineSeries>
-#include <QtCharts/QScatterSeries>
-#include <QtCharts/QValueAxis>
-#include "./ui_mainwindow.h"
-
-MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent)
-    , ui(new Ui::MainWindow)
-{
-    ui->setupUi(this);
-    tabWidget = new QTabWidget(this);
-    setCentralWidget(tabWidget);
-}
-
-MainWindow::~MainWindow()
-{
-    delete ui;
-}
-
-void MainWindow::updateUI(const IWKV &wkv)
-{
-    updateUIWithVelocities(wkv, std::vector<double>(), std::vector<double>());
-}
-
-void MainWindow::updateUIWithVelocities(const IWKV &wkv,
-                                        const std::vector<double> &velocities,
-                                        const std::vector<double> &accelerations)
-{
-    QString sensorId = QString::fromStdString(wkv.getName());
-    QChartView *chartView = tabWidget->findChild<QChartView *>(sensorId);
-
-    if (!chartView) {
-        // If the tab does not exist, create a new chart
-        QChart *chart = new QChart();
-        chart->setTitle(sensorId);
-
-        QLineSeries *series = new QLineSeries();
-        for (size_t i = 0; i < wkv.getTimestampsUs().size(); ++i) {
-            series->append((wkv.getTimestampsUs()[i] - wkv.getStartTimeUs()) / 1e6,
-                           wkv.getData()[i]);
-        }
-
-        chart->addSeries(series);
-
-        QValueAxis *axisX = new QValueAxis;
-        axisX->setTitleText("Time (s)");
-        axisX->setTickCount(10);
-        chart->addAxis(axisX, Qt::AlignBottom);
-        series->attachAxis(axisX);
-
-        QValueAxis *axisY = new QValueAxis;
-        axisY->setTitleText("Value");
-        chart->addAxis(axisY, Qt::AlignLeft);
-        series->attachAxis(axisY);
-
-        chartView = new QChartView(chart);
-        chartView->setRenderHint(QPainter::Antialiasing);
-        chartView->setObjectName(sensorId);
-        tabWidget->addTab(chartView, sensorId);
-    } else {
-        // If the tab exists, update the existing chart
-        QChart *chart = chartView->chart();
-        chart->removeAllSeries();
-
-        QLineSeries *series = new QLineSeries();
-        for (size_t i = 0; i < wkv.getTimestampsUs().size(); ++i) {
-            series->append((wkv.getTimestampsUs()[i] - wkv.getStartTimeUs()) / 1e6,
-                           wkv.getData()[i]);
-        }
-
-        chart->addSeries(series);
-        series->attachAxis(chart->axes(Qt::Horizontal).first());
-        series->attachAxis(chart->axes(Qt::Vertical).first());
-    }
-
-    // Create velocity chart
-    QString velocitySensorId = "velocity_" + sensorId;
-    QChartView *velocityChartView = tabWidget->findChild<QChartView *>(velocitySensorId);
-
-    if (!velocities.empty()) {
-        // If the velocity tab does not exist, create a new chart
-        QChart *velocityChart = new QChart();
-        velocityChart->setTitle("velocity_" + sensorId);
-
-        QLineSeries *velocitySeries = new QLineSeries();
-        for (size_t i = 0; i < velocities.size(); ++i) {
-            velocitySeries->append((wkv.getTimestampsUs()[i] - wkv.getStartTimeUs()) / 1e6,
-                                   velocities[i]);
-        }
-
-        velocityChart->addSeries(velocitySeries);
-
-        QValueAxis *velocityAxisX = new QValueAxis;
-        velocityAxisX->setTitleText("Time (s)");
-        velocityAxisX->setTickCount(10);
-        velocityChart->addAxis(velocityAxisX, Qt::AlignBottom);
-        velocitySeries->attachAxis(velocityAxisX);
-
-        QValueAxis *velocityAxisY = new QValueAxis;
-        velocityAxisY->setTitleText("Velocity");
-        velocityChart->addAxis(velocityAxisY, Qt::AlignLeft);
-        velocitySeries->attachAxis(velocityAxisY);
-
-        velocityChartView = new QChartView(velocityChart);
-        velocityChartView->setRenderHint(QPainter::Antialiasing);
-        velocityChartView->setObjectName(velocitySensorId);
-        tabWidget->addTab(velocityChartView, velocitySensorId);
-    }
-
-    // Create acceleration chart
-    QString accelerationSensorId = "acceleration_" + sensorId;
-    QChartView *accelerationChartView = tabWidget->findChild<QChartView *>(accelerationSensorId);
-
-    if (!accelerations.empty()) {
-        // If the acceleration tab does not exist, create a new chart
-        QChart *accelerationChart = new QChart();
-        accelerationChart->setTitle("acceleration_" + sensorId);
-
-        QLineSeries *accelerationSeries = new QLineSeries();
-        for (size_t i = 0; i < accelerations.size(); ++i) {
-            accelerationSeries->append((wkv.getTimestampsUs()[i] - wkv.getStartTimeUs()) / 1e6,
-                                       accelerations[i]);
-        }
-
-        accelerationChart->addSeries(accelerationSeries);
-
-        QValueAxis *accelerationAxisX = new QValueAxis;
-        accelerationAxisX->setTitleText("Time (s)");
-        accelerationAxisX->setTickCount(10);
-        accelerationChart->addAxis(accelerationAxisX, Qt::AlignBottom);
-        accelerationSeries->attachAxis(accelerationAxisX);
-
-        QValueAxis *accelerationAxisY = new QValueAxis;
-        accelerationAxisY->setTitleText("Acceleration");
-        accelerationChart->addAxis(accelerationAxisY, Qt::AlignLeft);
-        accelerationSeries->attachAxis(accelerationAxisY);
-
-        accelerationChartView = new QChartView(accelerationChart);
-        accelerationChartView->setRenderHint(QPainter::Antialiasing);
-        accelerationChartView->setObjectName(accelerationSensorId);
-        tabWidget->addTab(accelerationChartView, accelerationSensorId);
-    }
-}
-
-void MainWindow::updateUIWithPeaks(const IWKV &wkv,
-                                   const std::vector<uint64_t> &peaks,
-                                   const std::string &sensorId)
-{
-    QString qSensorId = QString::fromStdString(sensorId);
-    QChartView *chartView = tabWidget->findChild<QChartView *>(qSensorId);
-    if (chartView) {
-        QChart *chart = chartView->chart();
-
-        // Safely cast the axis to QValueAxis
-        QValueAxis *axisY = dynamic_cast<QValueAxis *>(chart->axisY());
-        if (!axisY) {
-            qDebug() << "Error: Y-axis is not a QValueAxis.";
-            return;
-        }
-
-        for (auto peakTime : peaks) {
-            double timeInSeconds = (peakTime - wkv.getStartTimeUs()) / 1e6;
-            QLineSeries *lineSeries = new QLineSeries();
-            lineSeries->append(timeInSeconds, axisY->min());
-            lineSeries->append(timeInSeconds, axisY->max());
-            lineSeries->setName("Peak at " + QString::number(timeInSeconds) + "s");
-
-            chart->addSeries(lineSeries);
-            lineSeries->attachAxis(chart->axes(Qt::Horizontal).first());
-            lineSeries->attachAxis(axisY);
-        }
-    }
-}
+#include "mainwindow.h"
+#include <QTabWidget>
+#include "metrics.h"
+#include "plotupdatescheduler.h"
+#include "./ui_mainwindow.h"
+
+#ifdef TWIICE_ENABLE_METRICS
+#include <QFileDialog>
+#include <QLabel>
+#include <QMenuBar>
+#include <QMessageBox>
+#include <QTimer>
+
+namespace {
+
+// Interval between two refreshes of the metrics in the status bar.
+constexpr int metrics_refresh_ms = 1000;
+
+QString formatSeconds(double seconds)
+{
+    if (seconds >= 1.0)
+        return QString::number(seconds, 'f', 2) + " s";
+    if (seconds >= 1e-3)
+        return QString::number(seconds * 1e3, 'f', 2) + " ms";
+    return QString::number(seconds * 1e6, 'f', 1) + " us";
+}
+
+} // namespace
+#endif
+
+MainWindow::MainWindow(QWidget *parent)
+    : QMainWindow(parent)
+    , ui(new Ui::MainWindow)
+{
+    ui->setupUi(this);
+    tabWidget = new QTabWidget(this);
+    setCentralWidget(tabWidget);
+    plots = new PlotUpdateScheduler(tabWidget);
+
+#ifdef TWIICE_ENABLE_METRICS
+    metricsLabel = new QLabel(this);
+    ui->statusbar->addWidget(metricsLabel, 1);
+    auto *refresh = new QTimer(this);
+    connect(refresh, &QTimer::timeout, this, &MainWindow::showMetrics);
+    refresh->start(metrics_refresh_ms);
+
+    QMenu *metricsMenu = menuBar()->addMenu(tr("&Metrics"));
+    metricsMenu->addAction(tr("Export as &JSON..."), this, [this] { exportMetrics(false); });
+    metricsMenu->addAction(tr("Export as &Prometheus text..."), this, [this] { exportMetrics(true); });
+#endif
+}
+
+MainWindow::~MainWindow()
+{
+    delete ui;
+}
+
+void MainWindow::updateUI(const IWKV &wkv)
+{
+    TWIICE_METRICS_SCOPE("MainWindow::updateUI");
+    updateUIWithVelocities(wkv, DerivativeSeries());
+}
+
+void MainWindow::followSensor(const IWKV &wkv)
+{
+    // Direct, so the block is copied on the thread appending, before the columns can change again
+    const auto copyBlock = [this](const IWKV &sensor, size_t first_index, size_t count) {
+        const auto timestamps = sensor.getTimestampsUs().subspan(first_index, count);
+        const auto data = sensor.getData().subspan(first_index, count);
+        QMetaObject::invokeMethod(
+            this,
+            [this,
+             sensorId = QString::fromStdString(sensor.getName()),
+             first_index,
+             timestamps_us = std::vector<uint64_t>(timestamps.begin(), timestamps.end()),
+             values = std::vector<double>(data.begin(), data.end()),
+             origin_us = sensor.getStartTimeUs()]() mutable {
+                appendUI(sensorId, first_index, std::move(timestamps_us), std::move(values), origin_us);
+            },
+            Qt::QueuedConnection);
+    };
+    connect(&wkv, &IWKV::sensorDataAppended, this, copyBlock, Qt::DirectConnection);
+}
+
+void MainWindow::appendUI(const QString &sensorId,
+                          size_t first_index,
+                          std::vector<uint64_t> timestamps_us,
+                          std::vector<double> values,
+                          uint64_t origin_us)
+{
+    TWIICE_METRICS_SCOPE("MainWindow::appendUI");
+    TWIICE_METRICS_SAMPLES(values.size());
+    plots->appendSensor(sensorId,
+                        "Value",
+                        first_index,
+                        std::move(timestamps_us),
+                        std::move(values),
+                        origin_us);
+}
+
+void MainWindow::updateUIWithVelocities(const IWKV &wkv, const DerivativeSeries &derivatives)
+{
+    TWIICE_METRICS_SCOPE("MainWindow::updateUIWithVelocities");
+    TWIICE_METRICS_SAMPLES(wkv.getData().size() + derivatives.timestamps_us.size());
+    QString sensorId = QString::fromStdString(wkv.getName());
+
+    // The plot reads the sensor columns in place, the derivatives carry their own timestamps
+    plots->showSensor(sensorId, "Value", wkv);
+
+    if (!derivatives.empty()) {
+        plots->showSeries("velocity_" + sensorId,
+                          "Velocity",
+                          std::vector<uint64_t>(derivatives.timestamps_us),
+                          std::vector<double>(derivatives.velocities),
+                          wkv.getStartTimeUs());
+        plots->showSeries("acceleration_" + sensorId,
+                          "Acceleration",
+                          std::vector<uint64_t>(derivatives.timestamps_us),
+                          std::vector<double>(derivatives.accelerations),
+                          wkv.getStartTimeUs());
+    }
+}
+
+void MainWindow::updateUIWithPeaks(const IWKV &wkv,
+                                   const std::vector<uint64_t> &peaks,
+                                   const std::string &sensorId)
+{
+    TWIICE_METRICS_SCOPE("MainWindow::updateUIWithPeaks");
+    TWIICE_METRICS_SAMPLES(peaks.size());
+    std::vector<double> times;
+    times.reserve(peaks.size());
+    for (auto peakTime : peaks)
+        times.push_back((static_cast<double>(peakTime) - static_cast<double>(wkv.getStartTimeUs())) / 1e6);
+    plots->showMarkers(QString::fromStdString(sensorId), std::move(times));
+}
+
+#ifdef TWIICE_ENABLE_METRICS
+void MainWindow::showMetrics()
+{
+    QStringList summary, details;
+    for (const StageSnapshot &stage : MetricsRegistry::instance().snapshot()) {
+        if (stage.calls == 0)
+            continue;
+        const QString name = QString::fromStdString(stage.stage);
+        const QString shortName = name.section("::", -1);
+        QString text = shortName + " " + formatSeconds(stage.p50_s);
+        if (stage.samples > 0)
+            text += QString(" %1 MS/s").arg(stage.samplesPerSecond() / 1e6, 0, 'f', 1);
+        summary << text;
+        details << QString("%1: %2 calls, p50 %3, p90 %4, p99 %5, max %6, %7 samples, %8 MB")
+                       .arg(name)
+                       .arg(stage.calls)
+                       .arg(formatSeconds(stage.p50_s), formatSeconds(stage.p90_s),
+                            formatSeconds(stage.p99_s), formatSeconds(stage.max_s))
+                       .arg(stage.samples)
+                       .arg(stage.bytes / 1e6, 0, 'f', 1);
+    }
+    metricsLabel->setText(summary.join(" | "));
+    metricsLabel->setToolTip(details.join("\n"));
+}
+
+void MainWindow::exportMetrics(bool prometheus)
+{
+    const QString path = QFileDialog::getSaveFileName(this,
+                                                      tr("Export metrics"),
+                                                      prometheus ? "twiice_metrics.prom" : "twiice_metrics.json",
+                                                      prometheus ? tr("Prometheus text (*.prom)")
+                                                                 : tr("JSON (*.json)"));
+    if (path.isEmpty())
+        return;
+    try {
+        if (prometheus)
+            MetricsRegistry::instance().exportPrometheus(path.toStdString());
+        else
+            MetricsRegistry::instance().exportJson(path.toStdString());
+    } catch (const std::exception &e) {
+        QMessageBox::warning(this, tr("Export metrics"), QString::fromStdString(e.what()));
+    }
+}
+#endif
@@ -1,34 +1,70 @@
-#ifndef MAINWINDOW_H
-#define MAINWINDOW_H
-
-#include <QMainWindow>
-#include "iwkv.h"
-
-QT_BEGIN_NAMESPACE
-namespace Ui {
-class MainWindow;
-}
-QT_END_NAMESPACE
-
-class MainWindow : public QMainWindow
-{
-    Q_OBJECT
-
-public:
-    MainWindow(QWidget *parent = nullptr);
-    ~MainWindow();
-
-private:
-    Ui::MainWindow *ui;
-    QTabWidget *tabWidget;
-
-public slots:
-    void updateUI(const IWKV &wkv);
-    void updateUIWithVelocities(const IWKV &wkv,
-                                const std::vector<double> &velocities,
-                                const std::vector<double> &accelerations);
-    void updateUIWithPeaks(const IWKV &wkv,
-                           const std::vector<uint64_t> &peaks,
-                           const std::string &sensorId);
-};
-#endif // MAINWINDOW_H
+#ifndef MAINWINDOW_H
+#define MAINWINDOW_H
+
+#include <QMainWindow>
+#include "derivativeengine.h"
+#include "iwkv.h"
+
+class PlotUpdateScheduler;
+class QLabel;
+
+QT_BEGIN_NAMESPACE
+namespace Ui {
+class MainWindow;
+}
+QT_END_NAMESPACE
+
+class MainWindow : public QMainWindow
+{
+    Q_OBJECT
+
+public:
+    MainWindow(QWidget *parent = nullptr);
+    ~MainWindow();
+
+private:
+    Ui::MainWindow *ui;
+    QTabWidget *tabWidget;
+    PlotUpdateScheduler *plots; ///< Coalesces the updates of the tabs, one redraw per frame.
+
+#ifdef TWIICE_ENABLE_METRICS
+    QLabel *metricsLabel; ///< Live summary of the stage metrics, in the status bar.
+
+    /**
+     * @brief Show the median latency and the throughput of every stage in the status bar.
+     */
+    void showMetrics();
+
+    /**
+     * @brief Ask for a file and export the stage metrics to it, as JSON or Prometheus text.
+     */
+    void exportMetrics(bool prometheus);
+#endif
+
+public:
+    /**
+     * @brief Extend the plot of a sensor with every block appended to it from now on.
+     *
+     * The blocks are copied by the thread appending them, when IWKV::sensorDataAppended is
+     * emitted, and handed to appendUI() through queued calls, so the sensor may keep being
+     * appended to while it is plotted. It must outlive the window.
+     */
+    void followSensor(const IWKV &wkv);
+
+public slots:
+    void updateUI(const IWKV &wkv);
+
+    /**
+     * @brief Extend the plot of a sensor with a copy of a block it appended at first_index.
+     */
+    void appendUI(const QString &sensorId,
+                  size_t first_index,
+                  std::vector<uint64_t> timestamps_us,
+                  std::vector<double> values,
+                  uint64_t origin_us);
+    void updateUIWithVelocities(const IWKV &wkv, const DerivativeSeries &derivatives);
+    void updateUIWithPeaks(const IWKV &wkv,
+                           const std::vector<uint64_t> &peaks,
+                           const std::string &sensorId);
+};
+#endif // MAINWINDOW_H
@@ -0,0 +1,201 @@
+#include "mappedwkv.h"
+#include <QFile>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr char recording_magic[8] = {'T', 'W', 'I', 'I', 'C', 'E', 'W', 'K'};
+constexpr uint32_t recording_version = 1;
+
+// The header is read and written as raw bytes: it must not contain padding.
+static_assert(sizeof(RecordingHeader) == 56);
+
+uint64_t alignUp(uint64_t offset)
+{
+    return (offset + recording_column_alignment - 1) / recording_column_alignment
+           * recording_column_alignment;
+}
+
+} // namespace
+
+MappedWKV::MappedWKV(const std::string &path)
+    : frequency_(0)
+    , start_time_us_(0)
+    , file_(std::make_unique<QFile>(QString::fromStdString(path)))
+{
+    if (!file_->open(QIODevice::ReadOnly)) {
+        throw std::runtime_error("Cannot open recording " + path + ": "
+                                 + file_->errorString().toStdString());
+    }
+
+    const auto file_size = static_cast<uint64_t>(file_->size());
+    if (file_size < sizeof(RecordingHeader)) {
+        throw std::runtime_error("Recording " + path + " is truncated.");
+    }
+
+    const uchar *mapping = file_->map(0, file_->size());
+    if (!mapping) {
+        throw std::runtime_error("Cannot map recording " + path + ": "
+                                 + file_->errorString().toStdString());
+    }
+
+    RecordingHeader header;
+    std::memcpy(&header, mapping, sizeof(header));
+    if (std::memcmp(header.magic, recording_magic, sizeof(recording_magic)) != 0
+        || header.version != recording_version) {
+        throw std::runtime_error(path + " is not a recording file.");
+    }
+
+    // Written so that no sum can wrap around, whatever the header holds
+    const auto fits = [file_size](uint64_t offset, uint64_t size) {
+        return offset <= file_size && size <= file_size - offset;
+    };
+    const uint64_t column_size = header.sample_count * sizeof(uint64_t);
+    if (header.sample_count > file_size / sizeof(uint64_t)
+        || !fits(sizeof(header), uint64_t(header.name_size) + header.unit_size)
+        || header.timestamps_offset % recording_column_alignment != 0
+        || header.data_offset % recording_column_alignment != 0
+        || !fits(header.timestamps_offset, column_size)
+        || !fits(header.data_offset, column_size)) {
+        throw std::runtime_error("Recording " + path + " is corrupted.");
+    }
+
+    const auto *strings = reinterpret_cast<const char *>(mapping) + sizeof(header);
+    name_.assign(strings, header.name_size);
+    unit_.assign(strings + header.name_size, header.unit_size);
+    frequency_ = header.frequency;
+    start_time_us_ = header.start_time_us;
+    timestamps_us_ = {reinterpret_cast<const uint64_t *>(mapping + header.timestamps_offset),
+                      header.sample_count};
+    data_ = {reinterpret_cast<const double *>(mapping + header.data_offset), header.sample_count};
+}
+
+MappedWKV::~MappedWKV() {}
+
+/**
+ * @brief Write the header, the strings and both columns, each column in a single write.
+ */
+void MappedWKV::write(const IWKV &wkv, const std::string &path)
+{
+    const std::string name = wkv.getName();
+    const std::string unit = wkv.getUnit();
+    const std::span<const uint64_t> timestamps = wkv.getTimestampsUs();
+    const std::span<const double> data = wkv.getData();
+
+    RecordingHeader header{};
+    std::memcpy(header.magic, recording_magic, sizeof(recording_magic));
+    header.version = recording_version;
+    header.frequency = wkv.getFrequency();
+    header.start_time_us = wkv.getStartTimeUs();
+    header.sample_count = timestamps.size();
+    header.name_size = static_cast<uint32_t>(name.size());
+    header.unit_size = static_cast<uint32_t>(unit.size());
+    header.timestamps_offset = alignUp(sizeof(header) + name.size() + unit.size());
+    header.data_offset = alignUp(header.timestamps_offset + timestamps.size_bytes());
+
+    QFile file(QString::fromStdString(path));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        throw std::runtime_error("Cannot create recording " + path + ": "
+                                 + file.errorString().toStdString());
+    }
+
+    const std::vector<char> padding(recording_column_alignment, 0);
+    auto writeBytes = [&](const void *bytes, uint64_t size) {
+        if (file.write(static_cast<const char *>(bytes), static_cast<qint64>(size))
+            != static_cast<qint64>(size)) {
+            throw std::runtime_error("Cannot write recording " + path + ": "
+                                     + file.errorString().toStdString());
+        }
+    };
+    writeBytes(&header, sizeof(header));
+    writeBytes(name.data(), name.size());
+    writeBytes(unit.data(), unit.size());
+    writeBytes(padding.data(), header.timestamps_offset - (sizeof(header) + name.size() + unit.size()));
+    writeBytes(timestamps.data(), timestamps.size_bytes());
+    writeBytes(padding.data(), header.data_offset - (header.timestamps_offset + timestamps.size_bytes()));
+    writeBytes(data.data(), data.size_bytes());
+}
+
+void MappedWKV::generateData(int frequency,
+                             double jitter,
+                             int duration_seconds,
+                             std::optional<IWKV *> other_sensor_ptr)
+{
+    throw std::logic_error("MappedWKV is a read-only recording and cannot generate data.");
+}
+
+std::string MappedWKV::getName() const
+{
+    return name_;
+}
+
+int MappedWKV::getFrequency() const
+{
+    return frequency_;
+}
+
+std::string MappedWKV::getUnit() const
+{
+    return unit_;
+}
+
+uint64_t MappedWKV::getStartTimeUs() const
+{
+    return start_time_us_;
+}
+
+void MappedWKV::setName(const std::string &name)
+{
+    name_ = name;
+}
+
+void MappedWKV::setUnit(const std::string &unit)
+{
+    unit_ = unit;
+}
+
+void MappedWKV::setStartTimeUs(uint64_t start_time_us)
+{
+    start_time_us_ = start_time_us;
+}
+
+void MappedWKV::setFrequency(int frequency)
+{
+    frequency_ = frequency;
+}
+
+void MappedWKV::addDataPoint(const uint64_t epoch_us, const double value)
+{
+    throw std::logic_error("MappedWKV is a read-only recording.");
+}
+
+void MappedWKV::addDataPoints(std::span<const uint64_t> epochs_us, std::span<const double> values)
+{
+    throw std::logic_error("MappedWKV is a read-only recording.");
+}
+
+void MappedWKV::setData(const std::vector<double> &data)
+{
+    throw std::logic_error("MappedWKV is a read-only recording.");
+}
+
+void MappedWKV::setData(std::vector<double> &&data)
+{
+    throw std::logic_error("MappedWKV is a read-only recording.");
+}
+
+void MappedWKV::copyFrom(const IWKV &other)
+{
+    throw std::logic_error("MappedWKV is a read-only recording.");
+}
+
+std::span<const uint64_t> MappedWKV::getTimestampsUs() const
+{
+    return timestamps_us_;
+}
+
+std::span<const double> MappedWKV::getData() const
+{
+    return data_;
+}
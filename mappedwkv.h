@@ -0,0 +1,107 @@
+#ifndef MAPPEDWKV_H
+#define MAPPEDWKV_H
+
+#include "iwkv.h"
+#include <memory>
+#include <span>
+
+class QFile;
+
+/**
+ * @brief Header of a columnar recording file.
+ *
+ * A recording file is laid out as, in native byte order:
+ *   - this header,
+ *   - the sensor name and unit (name_size and unit_size bytes, not null-terminated),
+ *   - the timestamps column, sample_count uint64_t starting at timestamps_offset,
+ *   - the data column, sample_count double starting at data_offset.
+ * Both columns start on a recording_column_alignment boundary so they can be used in place from a
+ * memory mapping.
+ */
+struct RecordingHeader
+{
+    char magic[8];              ///< "TWIICEWK"
+    uint32_t version;           ///< Format version, currently 1.
+    int32_t frequency;          ///< Frequency of the sensor in Hertz.
+    uint64_t start_time_us;     ///< Start time of the data series in microseconds.
+    uint64_t sample_count;      ///< Number of samples in each column.
+    uint32_t name_size;         ///< Size of the sensor name in bytes.
+    uint32_t unit_size;         ///< Size of the unit in bytes.
+    uint64_t timestamps_offset; ///< File offset of the timestamps column.
+    uint64_t data_offset;       ///< File offset of the data column.
+};
+
+constexpr size_t recording_column_alignment = 64;
+
+/**
+ * @brief The MappedWKV class serves a recording file straight from a read-only memory mapping.
+ *
+ * Opening a recording only reads and validates the header: getTimestampsUs() and getData() point
+ * into the mapping, so the columns are paged in lazily by the OS and never copied onto the heap.
+ * The series is read-only, every modifier throws std::logic_error.
+ */
+class MappedWKV : public IWKV
+{
+private:
+    std::string name_;                        ///< Name of the sensor.
+    std::string unit_;                        ///< Unit of measurement for the data.
+    int frequency_;                           ///< Frequency in Hertz
+    uint64_t start_time_us_;                  ///< Start time of the data series in microseconds.
+    std::unique_ptr<QFile> file_;             ///< The mapped file, unmapped when destroyed.
+    std::span<const uint64_t> timestamps_us_; ///< Timestamps column inside the mapping.
+    std::span<const double> data_;            ///< Data column inside the mapping.
+
+public:
+    /**
+     * @brief Map a recording file.
+     *
+     * @param path The recording written by MappedWKV::write.
+     * @throws std::runtime_error If the file cannot be mapped or is not a valid recording.
+     */
+    explicit MappedWKV(const std::string &path);
+    ~MappedWKV() override;
+
+    /**
+     * @brief Write a sensor to a recording file.
+     *
+     * @param wkv The sensor to persist.
+     * @param path The file to create or overwrite.
+     * @throws std::runtime_error If the file cannot be written.
+     */
+    static void write(const IWKV &wkv, const std::string &path);
+
+    /**
+     * @brief Not supported: a mapped recording is read-only.
+     *
+     * @throws std::logic_error Always.
+     */
+    void generateData(int frequency,
+                      double jitter,
+                      int duration_seconds,
+                      std::optional<IWKV *> other_sensor_ptr = std::nullopt) override;
+
+    std::string getName() const override;
+    int getFrequency() const override;
+    std::string getUnit() const override;
+    uint64_t getStartTimeUs() const override;
+    void setName(const std::string &name) override;
+    void setUnit(const std::string &unit) override;
+    void setStartTimeUs(uint64_t start_time_us) override;
+    void setFrequency(int frequency) override;
+
+    /**
+     * @brief Not supported: a mapped recording is read-only.
+     *
+     * @throws std::logic_error Always.
+     */
+    void addDataPoint(const uint64_t epoch_us, const double value) override;
+    void addDataPoints(std::span<const uint64_t> epochs_us, std::span<const double> values) override;
+    void setData(const std::vector<double> &data) override;
+    void setData(std::vector<double> &&data) override;
+    void copyFrom(const IWKV &other) override;
+
+    std::span<const uint64_t> getTimestampsUs() const override;
+    std::span<const double> getData() const override;
+};
+
+#endif // MAPPEDWKV_H
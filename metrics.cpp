@@ -0,0 +1,309 @@
+#include "metrics.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+thread_local ScopedStageTimer *ScopedStageTimer::current_ = nullptr;
+
+namespace {
+
+/**
+ * @brief Quote a stage name for a JSON string or a Prometheus label value.
+ *
+ * Both escape the quote, the backslash and the line feed the same way. JSON also needs the other
+ * control characters escaped, which Prometheus takes as they are.
+ */
+std::string quoted(const std::string &text, bool json)
+{
+    std::string result = "\"";
+    for (const char c : text) {
+        switch (c) {
+        case '"':
+            result += "\\\"";
+            break;
+        case '\\':
+            result += "\\\\";
+            break;
+        case '\n':
+            result += "\\n";
+            break;
+        default:
+            if (json && static_cast<unsigned char>(c) < 0x20) {
+                char escape[7];
+                std::snprintf(escape, sizeof(escape), "\\u%04x", static_cast<unsigned char>(c));
+                result += escape;
+            } else {
+                result += c;
+            }
+        }
+    }
+    return result + '"';
+}
+
+/**
+ * @brief Write a text to a file, replacing it.
+ */
+void writeFile(const std::string &path, const std::string &text)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << text;
+    if (!file) {
+        throw std::runtime_error("MetricsRegistry: cannot write " + path + ".");
+    }
+}
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram()
+    : buckets_(std::make_unique<std::atomic<uint64_t>[]>(bucket_count))
+    , count_(0)
+    , total_ns_(0)
+    , max_ns_(0)
+{}
+
+void LatencyHistogram::record(uint64_t duration_ns)
+{
+    buckets_[bucketIndex(duration_ns)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    total_ns_.fetch_add(duration_ns, std::memory_order_relaxed);
+    uint64_t max_ns = max_ns_.load(std::memory_order_relaxed);
+    while (duration_ns > max_ns
+           && !max_ns_.compare_exchange_weak(max_ns, duration_ns, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t LatencyHistogram::count() const
+{
+    return count_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::totalNs() const
+{
+    return total_ns_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::maxNs() const
+{
+    return max_ns_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::percentileNs(double quantile) const
+{
+    const uint64_t count = this->count();
+    if (count == 0) {
+        return 0;
+    }
+    const auto rank = std::max<uint64_t>(std::ceil(std::clamp(quantile, 0.0, 1.0) * count), 1);
+    uint64_t seen = 0;
+    for (size_t index = 0; index < bucket_count; ++index) {
+        seen += buckets_[index].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            // Middle of the bucket, never above the longest duration recorded
+            const uint64_t lower = bucketLowerBound(index);
+            // The last bucket ends at 2^64, which has no bound of its own
+            uint64_t width = 1;
+            if (index + 1 == bucket_count) {
+                width = std::numeric_limits<uint64_t>::max() - lower + 1;
+            } else if (index >= sub_bucket_count) {
+                width = bucketLowerBound(index + 1) - lower;
+            }
+            return std::min(lower + width / 2, maxNs());
+        }
+    }
+    return maxNs();
+}
+
+void LatencyHistogram::reset()
+{
+    for (size_t index = 0; index < bucket_count; ++index) {
+        buckets_[index].store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    total_ns_.store(0, std::memory_order_relaxed);
+    max_ns_.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Durations below 32 ns have a bucket each. Above, the bucket is given by the position of
+ * the highest bit (the power of two) and the 5 bits below it (the linear sub-bucket).
+ */
+size_t LatencyHistogram::bucketIndex(uint64_t duration_ns)
+{
+    if (duration_ns < sub_bucket_count) {
+        return duration_ns;
+    }
+    const int shift = std::bit_width(duration_ns) - 1 - sub_bucket_bits;
+    const size_t sub_bucket = (duration_ns >> shift) - sub_bucket_count;
+    return (shift + 1) * sub_bucket_count + sub_bucket;
+}
+
+uint64_t LatencyHistogram::bucketLowerBound(size_t index)
+{
+    const size_t group = index / sub_bucket_count;
+    const uint64_t sub_bucket = index % sub_bucket_count;
+    if (group == 0) {
+        return sub_bucket;
+    }
+    return (sub_bucket_count + sub_bucket) << (group - 1);
+}
+
+MetricsRegistry &MetricsRegistry::instance()
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+StageMetrics &MetricsRegistry::stage(std::string_view name)
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    auto it = stages_.find(name);
+    if (it == stages_.end()) {
+        it = stages_.emplace(std::string(name), std::make_unique<StageMetrics>()).first;
+    }
+    return *it->second;
+}
+
+std::vector<StageSnapshot> MetricsRegistry::snapshot() const
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<StageSnapshot> snapshots;
+    snapshots.reserve(stages_.size());
+    for (const auto &[name, metrics] : stages_) {
+        const LatencyHistogram &latency = metrics->latency;
+        StageSnapshot snapshot;
+        snapshot.stage = name;
+        snapshot.calls = latency.count();
+        snapshot.samples = metrics->samples.load(std::memory_order_relaxed);
+        snapshot.bytes = metrics->bytes.load(std::memory_order_relaxed);
+        snapshot.total_s = latency.totalNs() * 1e-9;
+        snapshot.mean_s = snapshot.calls > 0 ? snapshot.total_s / snapshot.calls : 0.0;
+        snapshot.p50_s = latency.percentileNs(0.5) * 1e-9;
+        snapshot.p90_s = latency.percentileNs(0.9) * 1e-9;
+        snapshot.p99_s = latency.percentileNs(0.99) * 1e-9;
+        snapshot.max_s = latency.maxNs() * 1e-9;
+        snapshots.push_back(std::move(snapshot));
+    }
+    return snapshots;
+}
+
+std::string MetricsRegistry::toJson() const
+{
+    std::ostringstream json;
+    json << std::setprecision(9) << "{\"stages\":[";
+    bool first = true;
+    for (const StageSnapshot &stage : snapshot()) {
+        json << (first ? "" : ",") << "\n  {\"stage\":" << quoted(stage.stage, true) << ",\"calls\":" << stage.calls
+             << ",\"samples\":" << stage.samples << ",\"bytes\":" << stage.bytes
+             << ",\"total_s\":" << stage.total_s << ",\"samples_per_s\":" << stage.samplesPerSecond()
+             << ",\"latency_s\":{\"mean\":" << stage.mean_s << ",\"p50\":" << stage.p50_s
+             << ",\"p90\":" << stage.p90_s << ",\"p99\":" << stage.p99_s << ",\"max\":" << stage.max_s
+             << "}}";
+        first = false;
+    }
+    json << "\n]}\n";
+    return json.str();
+}
+
+std::string MetricsRegistry::toPrometheus() const
+{
+    const std::vector<StageSnapshot> stages = snapshot();
+    std::ostringstream text;
+    text << std::setprecision(9);
+
+    text << "# HELP twiice_stage_latency_seconds Duration of the calls of a processing stage.\n"
+         << "# TYPE twiice_stage_latency_seconds summary\n";
+    for (const StageSnapshot &stage : stages) {
+        const std::string label = "stage=" + quoted(stage.stage, false);
+        const std::pair<const char *, double> quantiles[] = {{"0.5", stage.p50_s},
+                                                             {"0.9", stage.p90_s},
+                                                             {"0.99", stage.p99_s}};
+        for (const auto &[quantile, value] : quantiles) {
+            text << "twiice_stage_latency_seconds{" << label << ",quantile=\"" << quantile << "\"} " << value
+                 << '\n';
+        }
+        text << "twiice_stage_latency_seconds_sum{" << label << "} " << stage.total_s << '\n'
+             << "twiice_stage_latency_seconds_count{" << label << "} " << stage.calls << '\n';
+    }
+
+    text << "# HELP twiice_stage_samples_total Samples processed by a processing stage.\n"
+         << "# TYPE twiice_stage_samples_total counter\n";
+    for (const StageSnapshot &stage : stages) {
+        text << "twiice_stage_samples_total{stage=" << quoted(stage.stage, false) << "} " << stage.samples << '\n';
+    }
+    text << "# HELP twiice_stage_bytes_total Bytes processed by a processing stage.\n"
+         << "# TYPE twiice_stage_bytes_total counter\n";
+    for (const StageSnapshot &stage : stages) {
+        text << "twiice_stage_bytes_total{stage=" << quoted(stage.stage, false) << "} " << stage.bytes << '\n';
+    }
+    return text.str();
+}
+
+void MetricsRegistry::exportJson(const std::string &path) const
+{
+    writeFile(path, toJson());
+}
+
+void MetricsRegistry::exportPrometheus(const std::string &path) const
+{
+    writeFile(path, toPrometheus());
+}
+
+void MetricsRegistry::reset()
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &[name, metrics] : stages_) {
+        metrics->latency.reset();
+        metrics->samples.store(0, std::memory_order_relaxed);
+        metrics->bytes.store(0, std::memory_order_relaxed);
+    }
+}
+
+ScopedStageTimer::ScopedStageTimer(StageMetrics &stage)
+    : stage_(stage)
+    , outer_(current_)
+{
+    // Nested in any active scope of the same stage, not only the innermost one, e.g. A -> B -> A
+    owner_ = this;
+    for (ScopedStageTimer *scope = outer_; scope; scope = scope->outer_) {
+        if (&scope->stage_ == &stage_) {
+            owner_ = scope->owner_;
+            break;
+        }
+    }
+    current_ = this;
+    if (owner_ == this) {
+        begin_ = std::chrono::steady_clock::now();
+    }
+}
+
+ScopedStageTimer::~ScopedStageTimer()
+{
+    current_ = outer_;
+    if (owner_ != this) {
+        return;
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - begin_;
+    stage_.latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    if (samples_ > 0) {
+        stage_.samples.fetch_add(samples_, std::memory_order_relaxed);
+    }
+    if (bytes_ > 0) {
+        stage_.bytes.fetch_add(bytes_, std::memory_order_relaxed);
+    }
+}
+
+void ScopedStageTimer::addSamples(uint64_t samples)
+{
+    owner_->samples_ += samples;
+}
+
+void ScopedStageTimer::addBytes(uint64_t bytes)
+{
+    owner_->bytes_ += bytes;
+}
@@ -0,0 +1,199 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief The LatencyHistogram class counts durations in logarithmic buckets, HDR-style.
+ *
+ * Every power of two of nanoseconds is split into 32 linear sub-buckets, so a percentile is
+ * known within about 3% from 1 ns to the largest durations, in a fixed 15 KB table. Recording
+ * is a few relaxed atomic increments and never allocates nor locks, so stages running on
+ * several threads can record into the same histogram.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr int sub_bucket_bits = 5;
+    static constexpr size_t sub_bucket_count = size_t(1) << sub_bucket_bits;
+    static constexpr size_t bucket_count = (64 - sub_bucket_bits + 1) * sub_bucket_count;
+
+    LatencyHistogram();
+
+    void record(uint64_t duration_ns);
+
+    uint64_t count() const;
+    uint64_t totalNs() const;
+    uint64_t maxNs() const;
+
+    /**
+     * @brief Get the duration below which a fraction quantile of the recorded ones fall.
+     *
+     * @param quantile In [0, 1].
+     * @return uint64_t The middle of the bucket holding that duration, 0 if nothing was recorded.
+     */
+    uint64_t percentileNs(double quantile) const;
+
+    void reset();
+
+    /**
+     * @brief Get the bucket of a duration.
+     */
+    static size_t bucketIndex(uint64_t duration_ns);
+
+    /**
+     * @brief Get the smallest duration counted in a bucket.
+     */
+    static uint64_t bucketLowerBound(size_t index);
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets_; ///< Count of every bucket.
+    std::atomic<uint64_t> count_;                      ///< Durations recorded.
+    std::atomic<uint64_t> total_ns_;                   ///< Sum of the durations.
+    std::atomic<uint64_t> max_ns_;                     ///< Longest duration.
+};
+
+/**
+ * @brief Latency and volume of one processing stage.
+ */
+struct StageMetrics
+{
+    LatencyHistogram latency;         ///< Duration of every call.
+    std::atomic<uint64_t> samples{0}; ///< Samples processed by all calls.
+    std::atomic<uint64_t> bytes{0};   ///< Bytes read or written by all calls.
+};
+
+/**
+ * @brief Metrics of a stage at one instant, in seconds.
+ */
+struct StageSnapshot
+{
+    std::string stage;
+    uint64_t calls = 0;
+    uint64_t samples = 0;
+    uint64_t bytes = 0;
+    double total_s = 0.0;  ///< Time spent in the stage, over all calls.
+    double mean_s = 0.0;
+    double p50_s = 0.0;
+    double p90_s = 0.0;
+    double p99_s = 0.0;
+    double max_s = 0.0;
+
+    /**
+     * @brief Get the throughput of the stage while it runs.
+     */
+    double samplesPerSecond() const { return total_s > 0.0 ? samples / total_s : 0.0; }
+};
+
+/**
+ * @brief The MetricsRegistry class holds the metrics of every stage of the process.
+ *
+ * Stages are created on first use and live as long as the process, so the references returned
+ * by stage() can be cached; the instrumentation macros look a stage up once per call site. The
+ * metrics are exported as JSON or as Prometheus text exposition format, to a string or a file.
+ */
+class MetricsRegistry
+{
+public:
+    static MetricsRegistry &instance();
+
+    /**
+     * @brief Get the metrics of a stage, creating them on first use. Thread-safe.
+     */
+    StageMetrics &stage(std::string_view name);
+
+    /**
+     * @brief Get the metrics of every stage, sorted by name.
+     */
+    std::vector<StageSnapshot> snapshot() const;
+
+    std::string toJson() const;
+    std::string toPrometheus() const;
+
+    /**
+     * @brief Write toJson() to a file.
+     *
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    void exportJson(const std::string &path) const;
+
+    /**
+     * @brief Write toPrometheus() to a file, e.g. for the textfile collector of a node exporter.
+     *
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    void exportPrometheus(const std::string &path) const;
+
+    /**
+     * @brief Clear the metrics of every stage, keeping the stages.
+     */
+    void reset();
+
+private:
+    MetricsRegistry() = default;
+
+    mutable std::mutex mutex_;                                            ///< Guards stages_.
+    std::map<std::string, std::unique_ptr<StageMetrics>, std::less<>> stages_; ///< Stages by name.
+};
+
+/**
+ * @brief The ScopedStageTimer class records the duration of a scope into a stage on destruction.
+ *
+ * Calls nest: a scope opened while another scope of the same stage is active on the thread,
+ * e.g. an overload forwarding to another one, or a stage reached again through another stage,
+ * does not record, and the samples and bytes it counts go to the outermost scope of the stage.
+ * Each call is counted once, with the time of the outermost scope.
+ */
+class ScopedStageTimer
+{
+public:
+    explicit ScopedStageTimer(StageMetrics &stage);
+    ~ScopedStageTimer();
+
+    ScopedStageTimer(const ScopedStageTimer &) = delete;
+    ScopedStageTimer &operator=(const ScopedStageTimer &) = delete;
+
+    void addSamples(uint64_t samples);
+    void addBytes(uint64_t bytes);
+
+private:
+    StageMetrics &stage_;                          ///< Stage the scope records into.
+    ScopedStageTimer *outer_;                      ///< Scope active on the thread before this one.
+    ScopedStageTimer *owner_;                      ///< Outermost scope of the same stage.
+    std::chrono::steady_clock::time_point begin_;  ///< Start of the scope, if it records.
+    uint64_t samples_ = 0;
+    uint64_t bytes_ = 0;
+
+    static thread_local ScopedStageTimer *current_; ///< Innermost scope of the thread.
+};
+
+/*
+ * Instrumentation of the processing stages, compiled in with TWIICE_ENABLE_METRICS (the CMake
+ * option of the same name). Without it the macros expand to nothing and their arguments are
+ * not evaluated, so the instrumented code is unchanged.
+ *
+ * TWIICE_METRICS_SCOPE(name) times the rest of the enclosing scope as stage name, a string
+ * literal. TWIICE_METRICS_SAMPLES(n) and TWIICE_METRICS_BYTES(n) count the volume processed
+ * by that scope.
+ */
+#ifdef TWIICE_ENABLE_METRICS
+#define TWIICE_METRICS_SCOPE(name) \
+    static StageMetrics &twiice_metrics_stage_ = MetricsRegistry::instance().stage(name); \
+    ScopedStageTimer twiice_metrics_scope_(twiice_metrics_stage_)
+#define TWIICE_METRICS_SAMPLES(samples) twiice_metrics_scope_.addSamples(samples)
+#define TWIICE_METRICS_BYTES(bytes) twiice_metrics_scope_.addBytes(bytes)
+#else
+#define TWIICE_METRICS_SCOPE(name)
+#define TWIICE_METRICS_SAMPLES(samples)
+#define TWIICE_METRICS_BYTES(bytes)
+#endif
+
+#endif // METRICS_H
@@ -0,0 +1,160 @@
+#include "multichannelwkv.h"
+#include <algorithm>
+#include <stdexcept>
+
+MultiChannelWKV::MultiChannelWKV(const std::string &name,
+                                 const std::string &unit,
+                                 const std::vector<std::string> &channel_names,
+                                 std::pmr::memory_resource *resource)
+    : name_(name)
+    , unit_(unit)
+    , channel_names_(channel_names)
+    , start_time_us_(0)
+    , timestamps_us_(resource)
+    , channels_(channel_names.size(), SharedColumn<double>(resource))
+{
+    if (channel_names_.empty()) {
+        throw std::invalid_argument("MultiChannelWKV: a series needs at least one channel.");
+    }
+}
+
+void MultiChannelWKV::checkChannel(size_t channel) const
+{
+    if (channel >= channels_.size()) {
+        throw std::out_of_range("MultiChannelWKV: no channel " + std::to_string(channel) + ".");
+    }
+}
+
+std::string MultiChannelWKV::getName() const
+{
+    return name_;
+}
+
+std::string MultiChannelWKV::getUnit() const
+{
+    return unit_;
+}
+
+uint64_t MultiChannelWKV::getStartTimeUs() const
+{
+    return start_time_us_;
+}
+
+void MultiChannelWKV::setStartTimeUs(uint64_t start_time_us)
+{
+    start_time_us_ = start_time_us;
+}
+
+size_t MultiChannelWKV::channelCount() const
+{
+    return channels_.size();
+}
+
+const std::string &MultiChannelWKV::getChannelName(size_t channel) const
+{
+    checkChannel(channel);
+    return channel_names_[channel];
+}
+
+size_t MultiChannelWKV::size() const
+{
+    return timestamps_us_.size();
+}
+
+std::span<const uint64_t> MultiChannelWKV::getTimestampsUs() const
+{
+    return timestamps_us_.view();
+}
+
+std::span<const double> MultiChannelWKV::getChannel(size_t channel) const
+{
+    checkChannel(channel);
+    return channels_[channel].view();
+}
+
+void MultiChannelWKV::addDataPoint(uint64_t epoch_us, std::span<const double> values)
+{
+    if (values.size() != channels_.size()) {
+        throw std::invalid_argument("MultiChannelWKV: a sample needs one value per channel.");
+    }
+    timestamps_us_.push_back(epoch_us);
+    for (size_t c = 0; c < channels_.size(); ++c) {
+        channels_[c].push_back(values[c]);
+    }
+}
+
+void MultiChannelWKV::addDataPoints(std::span<const uint64_t> epochs_us,
+                                    std::span<const std::span<const double>> channels)
+{
+    const bool matching = channels.size() == channels_.size()
+                          && std::all_of(channels.begin(), channels.end(), [&](auto channel) {
+                                 return channel.size() == epochs_us.size();
+                             });
+    if (!matching) {
+        throw std::invalid_argument("MultiChannelWKV: a block needs one column per channel of "
+                                    "one value per timestamp.");
+    }
+    timestamps_us_.append(epochs_us);
+    for (size_t c = 0; c < channels_.size(); ++c) {
+        channels_[c].append(channels[c]);
+    }
+}
+
+void MultiChannelWKV::setTimestampsUs(std::vector<uint64_t> &&timestamps_us)
+{
+    timestamps_us_ = std::move(timestamps_us);
+}
+
+void MultiChannelWKV::setTimestampsUs(std::pmr::vector<uint64_t> &&timestamps_us)
+{
+    timestamps_us_ = std::move(timestamps_us);
+}
+
+void MultiChannelWKV::setChannel(size_t channel, std::vector<double> &&values)
+{
+    checkChannel(channel);
+    channels_[channel] = std::move(values);
+}
+
+void MultiChannelWKV::setChannel(size_t channel, std::pmr::vector<double> &&values)
+{
+    checkChannel(channel);
+    channels_[channel] = std::move(values);
+}
+
+/**
+ * @brief Find a window with a binary search on the shared timestamps, once for every channel.
+ */
+std::pair<size_t, size_t> MultiChannelWKV::window(double start_time_s,
+                                                  double end_time_s,
+                                                  size_t before,
+                                                  size_t after) const
+{
+    const std::span<const uint64_t> timestamps = getTimestampsUs();
+    const uint64_t start_time_us = start_time_us_ + static_cast<uint64_t>(start_time_s * 1e6);
+    const uint64_t end_time_us = start_time_us_ + static_cast<uint64_t>(end_time_s * 1e6);
+    size_t first = 0, last = 0;
+    if (end_time_us >= start_time_us) {
+        first = std::lower_bound(timestamps.begin(), timestamps.end(), start_time_us) - timestamps.begin();
+        last = std::upper_bound(timestamps.begin() + first, timestamps.end(), end_time_us)
+               - timestamps.begin();
+    }
+    first -= std::min(before, first);
+    last = std::min(last + after, timestamps.size());
+    return {first, last - first};
+}
+
+void MultiChannelWKV::copyFrom(const MultiChannelWKV &other)
+{
+    if (other.channels_.size() != channels_.size()) {
+        throw std::invalid_argument("MultiChannelWKV: cannot copy a series with "
+                                    + std::to_string(other.channels_.size()) + " channels into one with "
+                                    + std::to_string(channels_.size()) + ".");
+    }
+    unit_ = other.unit_;
+    start_time_us_ = other.start_time_us_;
+    timestamps_us_ = other.timestamps_us_;
+    for (size_t c = 0; c < channels_.size(); ++c) {
+        channels_[c] = other.channels_[c];
+    }
+}
@@ -0,0 +1,133 @@
+#ifndef MULTICHANNELWKV_H
+#define MULTICHANNELWKV_H
+
+#include "sharedcolumn.h"
+#include <cstdint>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief The MultiChannelWKV class stores the channels of a multi-axis sensor (e.g. the x, y and
+ * z axes of an IMU) against a single timestamp column.
+ *
+ * The channels are stored as a structure of arrays: one value column per channel, all as long as
+ * the timestamp column. Compared with one WKV per axis, the timestamps are stored once instead of
+ * once per channel, and the processors of SensorDataProcessor handle every channel in one pass
+ * over the timestamps, so the per-sample timing work (window search, interpolation weights,
+ * sample intervals) is done once for all channels.
+ *
+ * Like WKV, the columns are copy-on-write SharedColumns allocated from the memory resource given
+ * at construction, and copyFrom() shares them.
+ */
+class MultiChannelWKV
+{
+private:
+    std::string name_;                          ///< Name of the sensor.
+    std::string unit_;                          ///< Unit of measurement of every channel.
+    std::vector<std::string> channel_names_;    ///< Name of every channel.
+    uint64_t start_time_us_;                    ///< Start time of the data series in microseconds.
+    SharedColumn<uint64_t> timestamps_us_;      ///< Timestamps shared by the channels.
+    std::vector<SharedColumn<double>> channels_; ///< Values of every channel.
+
+    void checkChannel(size_t channel) const;
+
+public:
+    /**
+     * @brief Construct an empty multi-channel series.
+     *
+     * @param name The name of the sensor.
+     * @param unit The measurement unit of the channels.
+     * @param channel_names The name of every channel, e.g. {"x", "y", "z"}.
+     * @param resource Memory resource of the columns, which must outlive the sensor.
+     * @throws std::invalid_argument if there is no channel.
+     */
+    MultiChannelWKV(const std::string &name,
+                    const std::string &unit,
+                    const std::vector<std::string> &channel_names,
+                    std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+    std::string getName() const;
+    std::string getUnit() const;
+    uint64_t getStartTimeUs() const;
+    void setStartTimeUs(uint64_t start_time_us);
+
+    size_t channelCount() const;
+
+    /**
+     * @brief Get the name of a channel.
+     *
+     * @throws std::out_of_range if the channel does not exist.
+     */
+    const std::string &getChannelName(size_t channel) const;
+
+    /**
+     * @brief Get the number of samples of every channel.
+     */
+    size_t size() const;
+
+    std::span<const uint64_t> getTimestampsUs() const;
+
+    /**
+     * @brief Get the values of a channel.
+     *
+     * @throws std::out_of_range if the channel does not exist.
+     */
+    std::span<const double> getChannel(size_t channel) const;
+
+    /**
+     * @brief Append a sample of every channel.
+     *
+     * @param values One value per channel.
+     * @throws std::invalid_argument if there is not one value per channel.
+     */
+    void addDataPoint(uint64_t epoch_us, std::span<const double> values);
+
+    /**
+     * @brief Append a block of samples of every channel.
+     *
+     * @param channels The values of every channel, each as long as epochs_us.
+     * @throws std::invalid_argument if there is not one column per channel of epochs_us.size() values.
+     */
+    void addDataPoints(std::span<const uint64_t> epochs_us,
+                       std::span<const std::span<const double>> channels);
+
+    /**
+     * @brief Set the timestamps in microseconds, taking ownership of the vector without copying it.
+     *
+     * The channels are left as they are, the caller keeps every column the same size.
+     */
+    void setTimestampsUs(std::vector<uint64_t> &&timestamps_us);
+    void setTimestampsUs(std::pmr::vector<uint64_t> &&timestamps_us);
+
+    /**
+     * @brief Set the values of a channel, taking ownership of the vector without copying it.
+     *
+     * @throws std::out_of_range if the channel does not exist.
+     */
+    void setChannel(size_t channel, std::vector<double> &&values);
+    void setChannel(size_t channel, std::pmr::vector<double> &&values);
+
+    /**
+     * @brief Samples of [start_time_s, end_time_s], relative to the start time, widened by
+     * before and after samples like WKVView::widened().
+     *
+     * @return The index of the first sample and the number of samples.
+     */
+    std::pair<size_t, size_t> window(double start_time_s,
+                                     double end_time_s,
+                                     size_t before = 0,
+                                     size_t after = 0) const;
+
+    /**
+     * @brief Share the columns of another series with the same number of channels.
+     *
+     * The channel names given at construction are kept.
+     *
+     * @throws std::invalid_argument if the channel counts differ.
+     */
+    void copyFrom(const MultiChannelWKV &other);
+};
+
+#endif // MULTICHANNELWKV_H
@@ -0,0 +1,442 @@
+#include "peakdetector.h"
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <ranges>
+#include <stdexcept>
+
+namespace {
+
+// Samples flagged per block by the candidate scan, small enough for the flags to stay in L1.
+constexpr size_t scan_block_size = 4096;
+
+template<typename T>
+void compact(std::vector<T> &column, std::span<const char> keep)
+{
+    if (column.size() != keep.size())
+        return;
+    size_t kept = 0;
+    for (size_t i = 0; i < column.size(); ++i) {
+        if (keep[i])
+            column[kept++] = column[i];
+    }
+    column.resize(kept);
+}
+
+/**
+ * @brief Drop the peaks whose keep flag is false from every column computed so far.
+ */
+void compact(PeakSeries &peaks, std::span<const char> keep)
+{
+    compact(peaks.indices, keep);
+    compact(peaks.timestamps_us, keep);
+    compact(peaks.heights, keep);
+    compact(peaks.plateau_sizes, keep);
+    compact(peaks.prominences, keep);
+    compact(peaks.left_bases, keep);
+    compact(peaks.right_bases, keep);
+    compact(peaks.widths, keep);
+    compact(peaks.width_heights, keep);
+    compact(peaks.left_ips, keep);
+    compact(peaks.right_ips, keep);
+}
+
+/**
+ * @brief Lowest sample of a stretch of the series.
+ */
+struct Minimum
+{
+    double value;
+    size_t index;
+};
+
+} // namespace
+
+void PeakSeries::clear()
+{
+    indices.clear();
+    timestamps_us.clear();
+    heights.clear();
+    plateau_sizes.clear();
+    prominences.clear();
+    left_bases.clear();
+    right_bases.clear();
+    widths.clear();
+    width_heights.clear();
+    left_ips.clear();
+    right_ips.clear();
+}
+
+PeakDetector::PeakDetector(const PeakCriteria &criteria, std::pmr::memory_resource *resource)
+    : criteria_(criteria)
+    , resource_(resource)
+{
+    if (criteria_.rel_height < 0.0)
+        throw std::invalid_argument("PeakDetector: rel_height must be positive");
+    if (criteria_.distance < 1)
+        throw std::invalid_argument("PeakDetector: distance must be at least one sample");
+}
+
+void PeakDetector::detect(const WKVView &window, PeakSeries &peaks) const
+{
+    detect(window.getTimestampsUs(), window.getData(), peaks);
+}
+
+void PeakDetector::detect(std::span<const uint64_t> timestamps_us,
+                          std::span<const double> values,
+                          PeakSeries &peaks) const
+{
+    detect(TimestampColumn<uint64_t>{timestamps_us}, ValueColumn<double>{values}, peaks);
+}
+
+template<typename Offset, typename Value>
+void PeakDetector::detect(const TimestampColumn<Offset> &timestamps,
+                          const ValueColumn<Value> &values,
+                          PeakSeries &peaks) const
+{
+    peaks.clear();
+    const size_t size = std::min(timestamps.size(), values.size());
+    if (size < 3)
+        return;
+
+    std::pmr::vector<size_t> turning_points(1, 0, resource_);
+    for (size_t begin = 1; begin < size - 1; begin += scan_block_size)
+        scan(values, size, begin, std::min(begin + scan_block_size, size - 1), turning_points, peaks);
+    turning_points.push_back(size - 1);
+    filter(timestamps, values, size, turning_points, peaks);
+}
+
+void PeakDetector::detect(std::span<const uint64_t> timestamps_us,
+                          std::span<const std::span<const double>> channels,
+                          std::vector<PeakSeries> &peaks) const
+{
+    for (const std::span<const double> channel : channels) {
+        if (channel.size() != timestamps_us.size())
+            throw std::invalid_argument("PeakDetector: every channel needs one value per timestamp");
+    }
+    peaks.resize(channels.size());
+    for (PeakSeries &channel_peaks : peaks)
+        channel_peaks.clear();
+    const size_t size = timestamps_us.size();
+    if (size < 3)
+        return;
+
+    // Every channel is scanned block by block, then labelled against the shared timestamps
+    std::pmr::vector<std::pmr::vector<size_t>> turning_points(resource_);
+    turning_points.reserve(channels.size());
+    for (size_t c = 0; c < channels.size(); ++c)
+        turning_points.emplace_back(1, 0);
+    for (size_t begin = 1; begin < size - 1; begin += scan_block_size) {
+        const size_t end = std::min(begin + scan_block_size, size - 1);
+        for (size_t c = 0; c < channels.size(); ++c)
+            scan(ValueColumn<double>{channels[c]}, size, begin, end, turning_points[c], peaks[c]);
+    }
+
+    const TimestampColumn<uint64_t> timestamps{timestamps_us};
+    for (size_t c = 0; c < channels.size(); ++c) {
+        turning_points[c].push_back(size - 1);
+        filter(timestamps, ValueColumn<double>{channels[c]}, size, turning_points[c], peaks[c]);
+    }
+}
+
+/**
+ * @brief Flag the candidates and turning points of the samples [begin, end) of a series of size
+ * samples, appending the turning points and the peaks found there.
+ */
+template<typename Value>
+void PeakDetector::scan(const ValueColumn<Value> &values,
+                        size_t size,
+                        size_t begin,
+                        size_t end,
+                        std::pmr::vector<size_t> &turning_points,
+                        PeakSeries &peaks) const
+{
+    const Value *x = values.samples.data();
+
+    // Candidates: samples higher than their left neighbour and not lower than their right one.
+    // Turning points: samples at or above (or at or below) both neighbours and strictly above
+    // (below) one of them, plus both ends.
+    constexpr uint8_t candidate_flag = 1, turning_flag = 2;
+    uint8_t flags[scan_block_size];
+    for (size_t i = begin; i < end; ++i) {
+        const double previous = values.decode(x[i - 1]), current = values.decode(x[i]),
+                     next = values.decode(x[i + 1]);
+        const bool maximum = (current >= previous) & (current >= next)
+                             & ((current > previous) | (current > next));
+        const bool minimum = (current <= previous) & (current <= next)
+                             & ((current < previous) | (current < next));
+        flags[i - begin] = ((current > previous) & (next <= current)) * candidate_flag
+                           + (maximum | minimum) * turning_flag;
+    }
+
+    for (size_t i = begin; i < end; ++i) {
+        if (!flags[i - begin])
+            continue;
+        if (flags[i - begin] & turning_flag)
+            turning_points.push_back(i);
+        if (!(flags[i - begin] & candidate_flag))
+            continue;
+
+        // Walk a plateau to its last sample, it is a peak if the series falls after it
+        size_t last = i;
+        while (last + 1 < size && x[last + 1] == x[i])
+            ++last;
+        if (last + 1 < size && x[last + 1] < x[i]) {
+            peaks.indices.push_back((i + last) / 2);
+            peaks.plateau_sizes.push_back(last - i + 1);
+        }
+    }
+}
+
+/**
+ * @brief Label the scanned peaks of a series of size samples and apply the criteria to them.
+ */
+template<typename Offset, typename Value>
+void PeakDetector::filter(const TimestampColumn<Offset> &timestamps,
+                          const ValueColumn<Value> &values,
+                          size_t size,
+                          std::pmr::vector<size_t> &turning_points,
+                          PeakSeries &peaks) const
+{
+    peaks.heights.resize(peaks.size());
+    peaks.timestamps_us.resize(peaks.size());
+    for (size_t p = 0; p < peaks.size(); ++p) {
+        peaks.heights[p] = values[peaks.indices[p]];
+        peaks.timestamps_us[p] = timestamps[peaks.indices[p]];
+    }
+
+    std::pmr::vector<char> keep(resource_);
+    if (criteria_.height) {
+        keep.assign(peaks.size(), 0);
+        for (size_t p = 0; p < peaks.size(); ++p)
+            keep[p] = peaks.heights[p] >= *criteria_.height;
+        compact(peaks, keep);
+    }
+
+    if (criteria_.threshold) {
+        keep.assign(peaks.size(), 0);
+        for (size_t p = 0; p < peaks.size(); ++p) {
+            const size_t i = peaks.indices[p];
+            keep[p] = std::min(values[i] - values[i - 1], values[i] - values[i + 1])
+                      >= *criteria_.threshold;
+        }
+        compact(peaks, keep);
+    }
+
+    if (criteria_.distance > 1 && peaks.size() > 1) {
+        // Visit the peaks from the highest and drop their lower neighbours that are too close
+        std::pmr::vector<size_t> order(peaks.size(), resource_);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return peaks.heights[a] < peaks.heights[b];
+        });
+        keep.assign(peaks.size(), 1);
+        for (auto it = order.rbegin(); it != order.rend(); ++it) {
+            const size_t p = *it;
+            if (!keep[p])
+                continue;
+            for (size_t k = p; k > 0 && peaks.indices[p] - peaks.indices[k - 1] < criteria_.distance; --k)
+                keep[k - 1] = 0;
+            for (size_t k = p + 1; k < peaks.size() && peaks.indices[k] - peaks.indices[p] < criteria_.distance; ++k)
+                keep[k] = 0;
+        }
+        compact(peaks, keep);
+    }
+
+    // The middle of a plateau is not a turning point, add the peaks to the visited samples
+    std::pmr::vector<size_t> visited(resource_);
+    visited.reserve(turning_points.size() + peaks.size());
+    std::set_union(turning_points.begin(),
+                   turning_points.end(),
+                   peaks.indices.begin(),
+                   peaks.indices.end(),
+                   std::back_inserter(visited));
+    turning_points.clear();
+    turning_points.shrink_to_fit();
+
+    const ValueColumn<Value> series{values.samples.first(size), values.scale, values.offset};
+    computeProminences(series, visited, peaks);
+    if (criteria_.prominence) {
+        keep.assign(peaks.size(), 0);
+        for (size_t p = 0; p < peaks.size(); ++p)
+            keep[p] = peaks.prominences[p] >= *criteria_.prominence;
+        compact(peaks, keep);
+    }
+
+    computeWidths(series, visited, peaks);
+    if (criteria_.width) {
+        keep.assign(peaks.size(), 0);
+        for (size_t p = 0; p < peaks.size(); ++p)
+            keep[p] = peaks.widths[p] >= *criteria_.width;
+        compact(peaks, keep);
+    }
+}
+
+template<typename Value>
+void PeakDetector::computeProminences(const ValueColumn<Value> &values,
+                                      std::span<const size_t> turning_points,
+                                      PeakSeries &peaks) const
+{
+    const size_t count = peaks.size();
+    peaks.prominences.resize(count);
+    peaks.left_bases.resize(count);
+    peaks.right_bases.resize(count);
+    if (count == 0)
+        return;
+
+    // The stack holds the samples not yet dominated by a later higher-or-equal sample, each with
+    // the minimum of the stretch since the previous stack entry. Popping the entries lower than
+    // or equal to a sample merges their stretches, so once a sample is pushed its stretch is the
+    // minimum back to the nearest strictly higher sample: the base of a peak on that side.
+    // Visiting only the turning points gives the same bases, as the lowest sample of a stretch
+    // is a turning point and every higher sample is preceded by a turning point at least as high.
+    struct Entry
+    {
+        double value;
+        Minimum minimum;
+    };
+    std::pmr::vector<Entry> stack(resource_);
+    std::pmr::vector<Minimum> left_minima(count, resource_), right_minima(count, resource_);
+
+    // Ties go to the sample nearest to the peak, as the stretches are merged outwards
+    auto push = [&](size_t i) {
+        const double value = values[i];
+        Entry entry{value, {value, i}};
+        while (!stack.empty() && stack.back().value <= value) {
+            if (stack.back().minimum.value < entry.minimum.value)
+                entry.minimum = stack.back().minimum;
+            stack.pop_back();
+        }
+        stack.push_back(entry);
+        return entry.minimum;
+    };
+
+    size_t p = 0;
+    for (size_t t = 0; t < turning_points.size() && p < count; ++t) {
+        const Minimum minimum = push(turning_points[t]);
+        if (turning_points[t] == peaks.indices[p])
+            left_minima[p++] = minimum;
+    }
+
+    stack.clear();
+    p = count;
+    for (size_t t = turning_points.size(); t-- > 0 && p > 0;) {
+        const Minimum minimum = push(turning_points[t]);
+        if (turning_points[t] == peaks.indices[p - 1])
+            right_minima[--p] = minimum;
+    }
+
+    for (p = 0; p < count; ++p) {
+        peaks.left_bases[p] = left_minima[p].index;
+        peaks.right_bases[p] = right_minima[p].index;
+        peaks.prominences[p] = values[peaks.indices[p]]
+                               - std::max(left_minima[p].value, right_minima[p].value);
+    }
+}
+
+template<typename Value>
+void PeakDetector::computeWidths(const ValueColumn<Value> &values,
+                                 std::span<const size_t> turning_points,
+                                 PeakSeries &peaks) const
+{
+    const size_t count = peaks.size();
+    peaks.widths.resize(count);
+    peaks.width_heights.resize(count);
+    peaks.left_ips.resize(count);
+    peaks.right_ips.resize(count);
+    if (count == 0)
+        return;
+
+    for (size_t p = 0; p < count; ++p) {
+        peaks.width_heights[p] = values[peaks.indices[p]]
+                                 - peaks.prominences[p] * criteria_.rel_height;
+    }
+
+    // The stack holds, by increasing value, the positions in turning_points with no lower-or-equal
+    // turning point closer to the current one. The nearest turning point at or below a height is
+    // therefore the last stack entry at or below it, found by binary search, and every turning
+    // point after it up to the peak is above the height: the crossing lies in the monotone run
+    // that follows it, where it is found by a second binary search.
+    std::pmr::vector<size_t> stack(resource_);
+    auto push = [&](size_t t) {
+        while (!stack.empty() && values[turning_points[stack.back()]] > values[turning_points[t]])
+            stack.pop_back();
+        stack.push_back(t);
+    };
+    auto nearestAtOrBelow = [&](double height) -> std::optional<size_t> {
+        const auto it = std::upper_bound(stack.begin(), stack.end(), height, [&](double h, size_t t) {
+            return h < values[turning_points[t]];
+        });
+        if (it == stack.begin())
+            return std::nullopt;
+        return *(it - 1);
+    };
+
+    size_t p = 0;
+    for (size_t t = 0; t < turning_points.size() && p < count; ++t) {
+        push(t);
+        if (turning_points[t] != peaks.indices[p])
+            continue;
+
+        const double height = peaks.width_heights[p];
+        size_t stop = peaks.left_bases[p];
+        const std::optional<size_t> below = nearestAtOrBelow(height);
+        if (below == t) {
+            stop = peaks.indices[p];
+        } else if (below) {
+            // Rising run from the turning point to the next one: last sample at or below height
+            const auto run = std::views::iota(turning_points[*below], turning_points[*below + 1]);
+            const size_t crossing = *std::ranges::upper_bound(run, height, {}, [&](size_t i) {
+                return values[i];
+            }) - 1;
+            stop = std::max(crossing, stop);
+        }
+        double left_ip = static_cast<double>(stop);
+        if (values[stop] < height)
+            left_ip += (height - values[stop]) / (values[stop + 1] - values[stop]);
+        peaks.left_ips[p++] = left_ip;
+    }
+
+    stack.clear();
+    p = count;
+    for (size_t t = turning_points.size(); t-- > 0 && p > 0;) {
+        push(t);
+        if (turning_points[t] != peaks.indices[p - 1])
+            continue;
+
+        --p;
+        const double height = peaks.width_heights[p];
+        size_t stop = peaks.right_bases[p];
+        const std::optional<size_t> below = nearestAtOrBelow(height);
+        if (below == t) {
+            stop = peaks.indices[p];
+        } else if (below) {
+            // Falling run from the previous turning point: first sample at or below height
+            const auto run = std::views::iota(turning_points[*below - 1] + 1, turning_points[*below] + 1);
+            const size_t crossing = *std::ranges::partition_point(run, [&](size_t i) {
+                return values[i] > height;
+            });
+            stop = std::min(crossing, stop);
+        }
+        double right_ip = static_cast<double>(stop);
+        if (values[stop] < height)
+            right_ip -= (height - values[stop]) / (values[stop - 1] - values[stop]);
+        peaks.right_ips[p] = right_ip;
+    }
+
+    for (p = 0; p < count; ++p)
+        peaks.widths[p] = peaks.right_ips[p] - peaks.left_ips[p];
+}
+
+template void PeakDetector::detect(const TimestampColumn<uint64_t> &,
+                                   const ValueColumn<double> &,
+                                   PeakSeries &) const;
+template void PeakDetector::detect(const TimestampColumn<uint32_t> &,
+                                   const ValueColumn<double> &,
+                                   PeakSeries &) const;
+template void PeakDetector::detect(const TimestampColumn<uint32_t> &,
+                                   const ValueColumn<float> &,
+                                   PeakSeries &) const;
+template void PeakDetector::detect(const TimestampColumn<uint32_t> &,
+                                   const ValueColumn<int16_t> &,
+                                   PeakSeries &) const;
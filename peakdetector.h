@@ -0,0 +1,158 @@
+#ifndef PEAKDETECTOR_H
+#define PEAKDETECTOR_H
+
+#include "samplecolumns.h"
+#include "wkvview.h"
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <vector>
+
+/**
+ * @brief Filters applied to the local maxima of a series, modelled on scipy.signal.find_peaks.
+ *
+ * Unset filters are not applied. The filters run in the order of the fields.
+ */
+struct PeakCriteria
+{
+    std::optional<double> height;     ///< Minimum value of a peak.
+    std::optional<double> threshold;  ///< Minimum vertical distance of a peak to both its neighbours.
+    size_t distance = 1;              ///< Minimum distance in samples between peaks, the highest peaks win.
+    std::optional<double> prominence; ///< Minimum prominence of a peak.
+    std::optional<double> width;      ///< Minimum width in samples, measured at rel_height.
+    double rel_height = 0.5;          ///< Height, relative to the prominence, at which widths are measured.
+};
+
+/**
+ * @brief Peaks of a series and their properties, as one column per property.
+ *
+ * Positions are sample indices in the analysed series. Bases and widths follow the scipy
+ * definitions: the bases are the lowest points between a peak and the nearest higher sample on
+ * each side, and the width is measured at peak - rel_height * prominence, with linear
+ * interpolation between samples.
+ */
+struct PeakSeries
+{
+    std::vector<size_t> indices;         ///< Index of every peak (middle of its plateau).
+    std::vector<uint64_t> timestamps_us; ///< Timestamp of every peak.
+    std::vector<double> heights;         ///< Value of every peak.
+    std::vector<size_t> plateau_sizes;   ///< Number of samples at the peak value.
+    std::vector<double> prominences;
+    std::vector<size_t> left_bases;
+    std::vector<size_t> right_bases;
+    std::vector<double> widths;          ///< Width in samples.
+    std::vector<double> width_heights;   ///< Value at which the width is measured.
+    std::vector<double> left_ips;        ///< Interpolated left end of the width, in samples.
+    std::vector<double> right_ips;       ///< Interpolated right end of the width, in samples.
+
+    size_t size() const { return indices.size(); }
+    bool empty() const { return indices.empty(); }
+
+    /**
+     * @brief Empty every column, keeping their capacity.
+     */
+    void clear();
+};
+
+/**
+ * @brief The PeakDetector class finds and filters the peaks of a series in linear time.
+ *
+ * A branch-free, vectorisable pass over blocks of samples flags the peak candidates (higher than
+ * the left neighbour, not lower than the right one) and the turning points (local extrema,
+ * plateau edges included); only the flagged samples are then looked at one by one.
+ *
+ * Prominences and widths are computed for every remaining peak at once with monotonic stacks,
+ * one pass per side, instead of searching the bases and the width crossings from each peak. The
+ * passes only visit the turning points: bases are always turning points, and a width crossing is
+ * found by binary search in the monotone run between two of them. Overall the cost is
+ * O(n + p log p) for p peaks, the log coming from the distance filter.
+ */
+class PeakDetector
+{
+private:
+    PeakCriteria criteria_;
+    std::pmr::memory_resource *resource_; ///< Resource of the per-call scratch buffers.
+
+    template<typename Value>
+    void scan(const ValueColumn<Value> &values,
+              size_t size,
+              size_t begin,
+              size_t end,
+              std::pmr::vector<size_t> &turning_points,
+              PeakSeries &peaks) const;
+    template<typename Offset, typename Value>
+    void filter(const TimestampColumn<Offset> &timestamps,
+                const ValueColumn<Value> &values,
+                size_t size,
+                std::pmr::vector<size_t> &turning_points,
+                PeakSeries &peaks) const;
+    template<typename Value>
+    void computeProminences(const ValueColumn<Value> &values,
+                            std::span<const size_t> turning_points,
+                            PeakSeries &peaks) const;
+    template<typename Value>
+    void computeWidths(const ValueColumn<Value> &values,
+                       std::span<const size_t> turning_points,
+                       PeakSeries &peaks) const;
+
+public:
+    /**
+     * @brief Construct a new PeakDetector.
+     *
+     * @param criteria Filters applied to the peaks.
+     * @param resource Resource of the scratch buffers of detect(), the peaks themselves are
+     * written to the caller's PeakSeries.
+     * @throws std::invalid_argument if rel_height is negative or distance is zero.
+     */
+    explicit PeakDetector(const PeakCriteria &criteria = PeakCriteria(),
+                          std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+    /**
+     * @brief Find the peaks of a series matching the criteria.
+     *
+     * The first and last samples are never peaks. Every property of the output is filled.
+     *
+     * @param timestamps_us Timestamps of the samples, used to label the peaks.
+     * @param values The series.
+     * @param peaks Output, overwritten. Its capacity is kept, so a series reused across calls
+     * stops allocating once it is large enough.
+     */
+    void detect(std::span<const uint64_t> timestamps_us,
+                std::span<const double> values,
+                PeakSeries &peaks) const;
+
+    /**
+     * @brief Find the peaks of a pair of compact columns, decoding the samples on the fly.
+     *
+     * Instantiated for the IWKV columns and for uint32_t offsets with double, float or int16_t
+     * values. Timestamps are absolute and heights, prominences and width heights are in decoded
+     * units, so the criteria are given in decoded units too.
+     */
+    template<typename Offset, typename Value>
+    void detect(const TimestampColumn<Offset> &timestamps,
+                const ValueColumn<Value> &values,
+                PeakSeries &peaks) const;
+
+    /**
+     * @brief Find the peaks of channels sharing the same timestamps, one PeakSeries per channel.
+     *
+     * The candidate scan runs block by block over every channel, and every channel is labelled
+     * against the single timestamp column. Each output is identical to detecting its channel
+     * alone.
+     *
+     * @param channels The values of every channel, as long as timestamps_us.
+     * @param peaks Output, resized to one series per channel and overwritten.
+     * @throws std::invalid_argument if a channel does not have one value per timestamp.
+     */
+    void detect(std::span<const uint64_t> timestamps_us,
+                std::span<const std::span<const double>> channels,
+                std::vector<PeakSeries> &peaks) const;
+
+    /**
+     * @brief Find the peaks of a view. Indices are relative to the start of the view.
+     */
+    void detect(const WKVView &window, PeakSeries &peaks) const;
+};
+
+#endif // PEAKDETECTOR_H
@@ -0,0 +1,117 @@
+#include "pipelinearena.h"
+
+CountingResource::CountingResource(std::pmr::memory_resource *upstream)
+    : upstream_(upstream)
+{}
+
+AllocationStats CountingResource::stats() const
+{
+    return {allocations_.load(std::memory_order_relaxed), bytes_.load(std::memory_order_relaxed)};
+}
+
+void CountingResource::resetStats()
+{
+    allocations_.store(0, std::memory_order_relaxed);
+    bytes_.store(0, std::memory_order_relaxed);
+}
+
+void *CountingResource::do_allocate(size_t bytes, size_t alignment)
+{
+    allocations_.fetch_add(1, std::memory_order_relaxed);
+    bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    return upstream_->allocate(bytes, alignment);
+}
+
+void CountingResource::do_deallocate(void *p, size_t bytes, size_t alignment)
+{
+    upstream_->deallocate(p, bytes, alignment);
+}
+
+bool CountingResource::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+{
+    return this == &other;
+}
+
+PipelineArena::PipelineArena(size_t initial_bytes, std::pmr::memory_resource *upstream)
+    : upstream_(upstream)
+{
+    allocateBuffer(initial_bytes);
+    run_upstream_bytes_ = upstream_.stats().bytes;
+}
+
+PipelineArena::~PipelineArena()
+{
+    monotonic_.reset();
+    if (buffer_) {
+        upstream_.deallocate(buffer_, capacity_, alignof(std::max_align_t));
+    }
+}
+
+/**
+ * @brief Replace the buffer by one of the given size and restart the bump allocator on it.
+ *
+ * @param bytes Size of the new buffer, none when 0.
+ */
+void PipelineArena::allocateBuffer(size_t bytes)
+{
+    monotonic_.reset();
+    if (buffer_) {
+        upstream_.deallocate(buffer_, capacity_, alignof(std::max_align_t));
+        buffer_ = nullptr;
+    }
+    capacity_ = bytes;
+    if (capacity_ == 0) {
+        monotonic_.emplace(&upstream_);
+        return;
+    }
+    buffer_ = static_cast<std::byte *>(upstream_.allocate(capacity_, alignof(std::max_align_t)));
+    monotonic_.emplace(buffer_, capacity_, &upstream_);
+}
+
+/**
+ * @brief Free every allocation of the run.
+ *
+ * The memory taken from upstream during the run is what did not fit in the buffer, adding it to
+ * the buffer makes the same run fit next time.
+ */
+void PipelineArena::reset()
+{
+    monotonic_->release();
+    const size_t overflow_bytes = upstream_.stats().bytes - run_upstream_bytes_;
+    if (overflow_bytes > 0) {
+        allocateBuffer(capacity_ + overflow_bytes);
+    }
+    run_upstream_bytes_ = upstream_.stats().bytes;
+}
+
+size_t PipelineArena::capacity() const
+{
+    return capacity_;
+}
+
+AllocationStats PipelineArena::stats() const
+{
+    return stats_;
+}
+
+AllocationStats PipelineArena::upstreamStats() const
+{
+    return upstream_.stats();
+}
+
+void *PipelineArena::do_allocate(size_t bytes, size_t alignment)
+{
+    ++stats_.allocations;
+    stats_.bytes += bytes;
+    return monotonic_->allocate(bytes, alignment);
+}
+
+void PipelineArena::do_deallocate(void *p, size_t bytes, size_t alignment)
+{
+    // Freed all at once by reset()
+}
+
+bool PipelineArena::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+{
+    return this == &other;
+}
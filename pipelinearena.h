@@ -0,0 +1,129 @@
+#ifndef PIPELINEARENA_H
+#define PIPELINEARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+
+/**
+ * @brief Number and size of the allocations made through a memory resource.
+ */
+struct AllocationStats
+{
+    size_t allocations = 0; ///< Calls to allocate().
+    size_t bytes = 0;       ///< Bytes requested by those calls.
+
+    AllocationStats &operator+=(const AllocationStats &other)
+    {
+        allocations += other.allocations;
+        bytes += other.bytes;
+        return *this;
+    }
+
+    AllocationStats operator-(const AllocationStats &other) const
+    {
+        return {allocations - other.allocations, bytes - other.bytes};
+    }
+};
+
+/**
+ * @brief The CountingResource class forwards to another memory resource and counts the
+ * allocations going through it.
+ *
+ * The counters are atomic, so one resource can watch several threads, e.g. installed with
+ * std::pmr::set_default_resource() to check that a pipeline does not allocate.
+ */
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    /**
+     * @brief Construct a new CountingResource.
+     *
+     * @param upstream Resource the allocations are forwarded to.
+     */
+    explicit CountingResource(std::pmr::memory_resource *upstream = std::pmr::get_default_resource());
+
+    /**
+     * @brief Get the allocations counted since construction or the last resetStats().
+     */
+    AllocationStats stats() const;
+
+    void resetStats();
+
+private:
+    std::pmr::memory_resource *upstream_; ///< Resource doing the allocations.
+    std::atomic<size_t> allocations_{0};  ///< Calls to allocate().
+    std::atomic<size_t> bytes_{0};        ///< Bytes requested.
+
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+};
+
+/**
+ * @brief The PipelineArena class is a monotonic memory resource for the temporaries of a
+ * processing run, reset between runs.
+ *
+ * Allocations are a pointer bump in a buffer and deallocations do nothing; reset() frees
+ * everything at once. When a run does not fit in the buffer, the arena takes more memory from its
+ * upstream resource and reset() then grows the buffer to what the run used, so after the first
+ * run of a given size the arena no longer allocates: upstreamStats() stays constant while
+ * stats() keeps counting the allocations served.
+ *
+ * Anything allocated from the arena, including the columns of a WKV constructed on it, must be
+ * destroyed before reset(). An arena is not thread-safe: use one per worker.
+ */
+class PipelineArena : public std::pmr::memory_resource
+{
+public:
+    /**
+     * @brief Construct a new PipelineArena.
+     *
+     * @param initial_bytes Size of the buffer allocated up front, 0 to size it on the first run.
+     * @param upstream Resource the buffer is allocated from.
+     */
+    explicit PipelineArena(size_t initial_bytes = 0,
+                           std::pmr::memory_resource *upstream = std::pmr::get_default_resource());
+    ~PipelineArena();
+
+    PipelineArena(const PipelineArena &) = delete;
+    PipelineArena &operator=(const PipelineArena &) = delete;
+
+    /**
+     * @brief Free every allocation and keep the buffer, grown if the last run overflowed it.
+     */
+    void reset();
+
+    /**
+     * @brief Get the size of the buffer the runs are served from.
+     */
+    size_t capacity() const;
+
+    /**
+     * @brief Get the allocations served by the arena since construction.
+     */
+    AllocationStats stats() const;
+
+    /**
+     * @brief Get the allocations the arena made from its upstream resource since construction,
+     * buffer growth included.
+     */
+    AllocationStats upstreamStats() const;
+
+private:
+    CountingResource upstream_;                                  ///< Counts the arena's own allocations.
+    std::byte *buffer_ = nullptr;                                ///< Buffer the runs are served from.
+    size_t capacity_ = 0;                                        ///< Size of buffer_.
+    std::optional<std::pmr::monotonic_buffer_resource> monotonic_; ///< Bump allocator over buffer_.
+    size_t run_upstream_bytes_ = 0;                              ///< upstream_ bytes when the run started.
+    AllocationStats stats_;                                      ///< Allocations served.
+
+    void allocateBuffer(size_t bytes);
+
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+};
+
+#endif // PIPELINEARENA_H
@@ -0,0 +1,190 @@
+#include "plotupdatescheduler.h"
+#include <QTabWidget>
+#include <QVBoxLayout>
+#include <algorithm>
+#include "iwkv.h"
+#include "metrics.h"
+#include "seriesplotwidget.h"
+
+PlotUpdateScheduler::PlotUpdateScheduler(QTabWidget *tabs, int frame_interval_ms)
+    : QObject(tabs)
+    , tabs_(tabs)
+{
+    frame_timer_.setSingleShot(true);
+    frame_timer_.setInterval(frame_interval_ms);
+    connect(&frame_timer_, &QTimer::timeout, this, &PlotUpdateScheduler::flush);
+    connect(tabs_, &QTabWidget::currentChanged, this, &PlotUpdateScheduler::showTab);
+}
+
+void PlotUpdateScheduler::showSensor(const QString &tab_id, const QString &y_title, const IWKV &wkv)
+{
+    Tab &tab = tabFor(tab_id, y_title);
+    tab.change = Change::Replace;
+    tab.sensor = &wkv;
+    tab.dropped = 0;
+    tab.timestamps_us.clear();
+    tab.values.clear();
+    schedule();
+}
+
+void PlotUpdateScheduler::appendSensor(const QString &tab_id,
+                                       const QString &y_title,
+                                       size_t first_index,
+                                       std::vector<uint64_t> &&timestamps_us,
+                                       std::vector<double> &&values,
+                                       uint64_t origin_us)
+{
+    Tab &tab = tabFor(tab_id, y_title);
+    if (tab.change == Change::Replace && tab.sensor) {
+        // The sensor is read when the change is applied, after the block was stored
+        schedule();
+        return;
+    }
+
+    // Samples of the sensor plotted, or waiting to be, that it dropped before storing the block
+    const size_t kept = std::min(first_index, tab.appended_end);
+    size_t dropped = tab.appended_end - kept;
+    tab.appended_end = first_index + values.size();
+    if (!tab.plot && tab.change == Change::None) {
+        tab.change = Change::Replace;
+        tab.sensor = nullptr;
+        tab.origin_us = origin_us;
+    } else if (tab.change != Change::Replace) {
+        tab.change = Change::Append;
+        tab.dropped += dropped;
+        dropped = 0;
+    }
+
+    // Queued after the blocks not yet applied. A pending series drops its own oldest samples
+    tab.timestamps_us.insert(tab.timestamps_us.end(), timestamps_us.begin(), timestamps_us.end());
+    tab.values.insert(tab.values.end(), values.begin(), values.end());
+    dropped = std::min(dropped, tab.values.size());
+    tab.timestamps_us.erase(tab.timestamps_us.begin(), tab.timestamps_us.begin() + dropped);
+    tab.values.erase(tab.values.begin(), tab.values.begin() + dropped);
+    schedule();
+}
+
+void PlotUpdateScheduler::showSeries(const QString &tab_id,
+                                     const QString &y_title,
+                                     std::vector<uint64_t> &&timestamps_us,
+                                     std::vector<double> &&values,
+                                     uint64_t origin_us)
+{
+    Tab &tab = tabFor(tab_id, y_title);
+    tab.change = Change::Replace;
+    tab.sensor = nullptr;
+    tab.appended_end = 0;
+    tab.dropped = 0;
+    tab.timestamps_us = std::move(timestamps_us);
+    tab.values = std::move(values);
+    tab.origin_us = origin_us;
+    schedule();
+}
+
+bool PlotUpdateScheduler::showMarkers(const QString &tab_id, std::vector<double> times_s)
+{
+    const auto it = tabs_by_id_.find(tab_id);
+    if (it == tabs_by_id_.end())
+        return false;
+    it->markers_s = std::move(times_s);
+    schedule();
+    return true;
+}
+
+void PlotUpdateScheduler::flush()
+{
+    frame_timer_.stop();
+    const QWidget *page = tabs_->currentWidget();
+    if (!page)
+        return;
+    const auto it = tabs_by_id_.find(page->objectName());
+    if (it != tabs_by_id_.end())
+        apply(*it);
+}
+
+PlotUpdateScheduler::Tab &PlotUpdateScheduler::tabFor(const QString &tab_id, const QString &y_title)
+{
+    auto it = tabs_by_id_.find(tab_id);
+    if (it == tabs_by_id_.end()) {
+        // Only an empty page for now, the plot is built when the tab is first shown
+        Tab tab;
+        tab.page = new QWidget;
+        tab.page->setObjectName(tab_id);
+        auto *layout = new QVBoxLayout(tab.page);
+        layout->setContentsMargins(0, 0, 0, 0);
+        tab.y_title = y_title;
+
+        // Inserted before the page is added, as adding the first tab shows it at once
+        it = tabs_by_id_.insert(tab_id, tab);
+        tabs_->addTab(it->page, tab_id);
+    }
+    return *it;
+}
+
+/**
+ * @brief Start the frame timer unless a redraw is already pending, so updates arriving within a
+ * frame are applied together.
+ */
+void PlotUpdateScheduler::schedule()
+{
+    if (!frame_timer_.isActive())
+        frame_timer_.start();
+}
+
+void PlotUpdateScheduler::apply(Tab &tab)
+{
+    if (tab.change == Change::None && !tab.markers_s)
+        return;
+
+    TWIICE_METRICS_SCOPE("PlotUpdateScheduler::apply");
+    if (!tab.plot) {
+        tab.plot = new SeriesPlotWidget;
+        tab.plot->setTitle(tab.page->objectName());
+        tab.plot->setAxisTitles("Time (s)", tab.y_title);
+        tab.page->layout()->addWidget(tab.plot);
+    }
+
+    switch (tab.change) {
+    case Change::None:
+        break;
+    case Change::Append:
+        TWIICE_METRICS_SAMPLES(tab.values.size());
+        tab.plot->appendSamples(tab.timestamps_us, tab.values, tab.dropped);
+        tab.dropped = 0;
+        tab.timestamps_us.clear();
+        tab.values.clear();
+        break;
+    case Change::Replace:
+        if (tab.sensor) {
+            const auto timestamps = tab.sensor->getTimestampsUs();
+            TWIICE_METRICS_SAMPLES(timestamps.size());
+            tab.plot->setSeries(timestamps, tab.sensor->getData(), tab.sensor->getStartTimeUs());
+            tab.appended_end = tab.plot->sampleCount();
+        } else {
+            TWIICE_METRICS_SAMPLES(tab.values.size());
+            tab.plot->setSeries(std::move(tab.timestamps_us), std::move(tab.values), tab.origin_us);
+            tab.timestamps_us.clear();
+            tab.values.clear();
+        }
+        break;
+    }
+    tab.change = Change::None;
+
+    if (tab.markers_s) {
+        tab.plot->setMarkers(std::move(*tab.markers_s));
+        tab.markers_s.reset();
+    }
+}
+
+/**
+ * @brief Bring a tab up to date as soon as it is shown, building its plot the first time.
+ */
+void PlotUpdateScheduler::showTab(int index)
+{
+    const QWidget *page = tabs_->widget(index);
+    if (!page)
+        return;
+    const auto it = tabs_by_id_.find(page->objectName());
+    if (it != tabs_by_id_.end())
+        apply(*it);
+}
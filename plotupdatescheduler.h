@@ -0,0 +1,127 @@
+#ifndef PLOTUPDATESCHEDULER_H
+#define PLOTUPDATESCHEDULER_H
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+class IWKV;
+class QTabWidget;
+class QWidget;
+class SeriesPlotWidget;
+
+/**
+ * @brief The PlotUpdateScheduler class coalesces the updates of the plot tabs into at most one
+ * redraw per frame.
+ *
+ * The processing stages publish their results as bursts of queued calls. Instead of rebuilding a
+ * plot on every call, the scheduler records the latest state of each tab and applies it on the
+ * next frame tick, so a burst of updates of a sensor costs a single redraw. Tabs are found by id
+ * in a hash rather than by searching the widget tree.
+ *
+ * Tabs are materialised lazily: a tab starts as an empty page and its SeriesPlotWidget, with the
+ * min/max pyramid of its series, is only built the first time the tab is shown. The updates of
+ * hidden tabs stay pending until they are shown, so only the visible plot costs anything per
+ * frame.
+ *
+ * A sensor appended to in blocks is given as copies of its blocks, taken by the thread appending,
+ * since its columns may be reallocated by the next append while the plot is drawn. The blocks are
+ * queued until the next redraw and only they are reduced into the plot, whose oldest samples are
+ * dropped when the sensor drops its own, e.g. a ring buffer. A sensor shown whole is read in
+ * place when its update is applied, so it must outlive it and no longer be modified.
+ */
+class PlotUpdateScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Construct a new PlotUpdateScheduler, owned by the tab widget.
+     *
+     * @param tabs The tab widget the plots are added to.
+     * @param frame_interval_ms The minimum interval between two redraws, 16 ms for 60 Hz.
+     */
+    explicit PlotUpdateScheduler(QTabWidget *tabs, int frame_interval_ms = 16);
+
+    /**
+     * @brief Plot the whole series of a sensor, read in place, creating the tab on first use.
+     */
+    void showSensor(const QString &tab_id, const QString &y_title, const IWKV &wkv);
+
+    /**
+     * @brief Extend the plot of a sensor with a copy of a block it appended at first_index.
+     *
+     * The samples of the sensor before first_index that the plot shows past it are dropped, e.g.
+     * when a ring dropped its oldest samples before storing the block.
+     *
+     * @param origin_us Timestamp shown as 0 s, used if the block starts the plot.
+     */
+    void appendSensor(const QString &tab_id,
+                      const QString &y_title,
+                      size_t first_index,
+                      std::vector<uint64_t> &&timestamps_us,
+                      std::vector<double> &&values,
+                      uint64_t origin_us);
+
+    /**
+     * @brief Plot a series handed over to the plot, e.g. derived velocities.
+     */
+    void showSeries(const QString &tab_id,
+                    const QString &y_title,
+                    std::vector<uint64_t> &&timestamps_us,
+                    std::vector<double> &&values,
+                    uint64_t origin_us);
+
+    /**
+     * @brief Draw vertical markers on a tab, in seconds from the origin.
+     *
+     * @return bool false if the tab does not exist, in which case the markers are dropped.
+     */
+    bool showMarkers(const QString &tab_id, std::vector<double> times_s);
+
+public slots:
+    /**
+     * @brief Apply the pending updates of the visible tab now.
+     */
+    void flush();
+
+private:
+    /**
+     * @brief Change of the series of a tab waiting for the next redraw.
+     */
+    enum class Change {
+        None,
+        Append,  ///< Blocks of the sensor are waiting to be appended to the plot.
+        Replace, ///< The whole series is plotted again.
+    };
+
+    struct Tab
+    {
+        QWidget *page = nullptr;                  ///< Page of the tab, named after its id.
+        SeriesPlotWidget *plot = nullptr;         ///< Plot, built when the tab is first shown.
+        QString y_title;
+        Change change = Change::None;
+        const IWKV *sensor = nullptr;             ///< Sensor plotted in place, if any.
+        size_t appended_end = 0;                  ///< Samples of the sensor plotted once applied.
+        size_t dropped = 0;                       ///< Oldest samples plotted to drop once applied.
+        std::vector<uint64_t> timestamps_us;      ///< Series or blocks handed over, to be plotted.
+        std::vector<double> values;
+        uint64_t origin_us = 0;
+        std::optional<std::vector<double>> markers_s; ///< Markers waiting to be drawn.
+    };
+
+    QTabWidget *tabs_;
+    QHash<QString, Tab> tabs_by_id_; ///< Tabs by id, which is also the object name of their page.
+    QTimer frame_timer_;             ///< Single shot, started by the first pending update.
+
+    Tab &tabFor(const QString &tab_id, const QString &y_title);
+    void schedule();
+    void apply(Tab &tab);
+    void showTab(int index);
+};
+
+#endif // PLOTUPDATESCHEDULER_H
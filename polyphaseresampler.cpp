@@ -0,0 +1,221 @@
+#include "polyphaseresampler.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+// Cutoff of the low-pass filter, as a fraction of the lower Nyquist frequency, so most of the
+// transition band lies below it.
+constexpr double passband = 0.9;
+
+// Shape of the Kaiser window, about 55 dB of stopband attenuation.
+constexpr double kaiser_beta = 5.0;
+
+/**
+ * @brief Dot product of count coefficients and samples, count being a multiple of four.
+ *
+ * Four independent sums keep the additions free of a serial dependency, so they map onto SIMD
+ * lanes without reassociating floating-point operations.
+ */
+double dot(const double *coefficients, const double *samples, size_t count)
+{
+    double sums[4] = {0.0, 0.0, 0.0, 0.0};
+    for (size_t j = 0; j < count; j += 4) {
+        sums[0] += coefficients[j] * samples[j];
+        sums[1] += coefficients[j + 1] * samples[j + 1];
+        sums[2] += coefficients[j + 2] * samples[j + 2];
+        sums[3] += coefficients[j + 3] * samples[j + 3];
+    }
+    return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+}
+
+} // namespace
+
+PolyphaseResampler::PolyphaseResampler(int input_rate, int output_rate, int half_taps)
+{
+    if (input_rate <= 0 || output_rate <= 0) {
+        throw std::invalid_argument("PolyphaseResampler: the rates must be positive.");
+    }
+    if (half_taps <= 0) {
+        throw std::invalid_argument("PolyphaseResampler: the filter needs at least one tap per side.");
+    }
+    const int divisor = std::gcd(input_rate, output_rate);
+    up_ = output_rate / divisor;
+    down_ = input_rate / divisor;
+
+    // Windowed sinc at the upsampled rate, cut below the lower of the two Nyquist frequencies
+    const int64_t slowest = std::max(up_, down_);
+    centre_ = half_taps * slowest;
+    const size_t length = 2 * centre_ + 1;
+    const double cutoff = 0.5 * passband / slowest; // Cycles per upsampled sample
+    std::vector<double> prototype(length);
+    for (size_t n = 0; n < length; ++n) {
+        const double offset = static_cast<double>(static_cast<int64_t>(n) - centre_);
+        const double x = 2.0 * cutoff * offset;
+        const double sinc = offset == 0.0 ? 1.0 : std::sin(std::numbers::pi * x) / (std::numbers::pi * x);
+        const double position = offset / centre_;
+        const double window = std::cyl_bessel_i(0.0, kaiser_beta * std::sqrt(1.0 - position * position))
+                              / std::cyl_bessel_i(0.0, kaiser_beta);
+        prototype[n] = sinc * window;
+    }
+
+    // Phase p holds the taps p + k * L, reversed to run forward over the input
+    taps_per_phase_ = ((length + up_ - 1) / up_ + 3) / 4 * 4;
+    phases_.assign(up_ * taps_per_phase_, 0.0);
+    for (int phase = 0; phase < up_; ++phase) {
+        double *coefficients = phases_.data() + phase * taps_per_phase_;
+        double sum = 0.0;
+        for (size_t k = 0; k < taps_per_phase_; ++k) {
+            const size_t tap = phase + k * up_;
+            if (tap < length) {
+                coefficients[taps_per_phase_ - 1 - k] = prototype[tap];
+                sum += prototype[tap];
+            }
+        }
+        for (size_t j = 0; j < taps_per_phase_; ++j) {
+            coefficients[j] /= sum;
+        }
+    }
+}
+
+int PolyphaseResampler::upFactor() const
+{
+    return up_;
+}
+
+int PolyphaseResampler::downFactor() const
+{
+    return down_;
+}
+
+size_t PolyphaseResampler::tapsPerPhase() const
+{
+    return taps_per_phase_;
+}
+
+size_t PolyphaseResampler::resampledSize(size_t input_samples) const
+{
+    if (input_samples == 0) {
+        return 0;
+    }
+    return (input_samples - 1) * up_ / down_ + 1;
+}
+
+size_t PolyphaseResampler::maxOutputSize(size_t input_samples) const
+{
+    return (input_samples * up_ + down_ - 1) / down_ + 1;
+}
+
+size_t PolyphaseResampler::maxFlushSize() const
+{
+    return (centre_ + down_ - 1) / down_ + 1;
+}
+
+size_t PolyphaseResampler::process(std::span<const double> input, std::span<double> output)
+{
+    if (output.size() < maxOutputSize(input.size())) {
+        throw std::invalid_argument("PolyphaseResampler: the output is shorter than maxOutputSize().");
+    }
+    if (input.empty()) {
+        return 0;
+    }
+    consume(input);
+    const size_t written = emitOutputs(output, std::numeric_limits<uint64_t>::max());
+    trim();
+    return written;
+}
+
+size_t PolyphaseResampler::flush(std::span<double> output)
+{
+    if (output.size() < maxFlushSize()) {
+        throw std::invalid_argument("PolyphaseResampler: the output is shorter than maxFlushSize().");
+    }
+    if (consumed_ == 0) {
+        return 0;
+    }
+    // The last output is at the last input; the samples after it repeat the last one
+    const uint64_t last_output = (consumed_ - 1) * up_ / down_;
+    const double last_sample = history_.back();
+    history_.resize(history_.size() + centre_ / up_ + 1, last_sample);
+    const size_t written = emitOutputs(output, last_output);
+    reset();
+    return written;
+}
+
+void PolyphaseResampler::reset()
+{
+    history_.clear();
+    history_first_ = 0;
+    consumed_ = 0;
+    next_output_ = 0;
+}
+
+size_t PolyphaseResampler::resample(std::span<const double> input, std::span<double> output)
+{
+    const size_t count = resampledSize(input.size());
+    if (output.size() < count) {
+        throw std::invalid_argument("PolyphaseResampler: the output is shorter than resampledSize().");
+    }
+    reset();
+    if (input.empty()) {
+        return 0;
+    }
+    consume(input);
+    history_.resize(history_.size() + centre_ / up_ + 1, input.back());
+    emitOutputs(output, count - 1);
+    reset();
+    return count;
+}
+
+/**
+ * @brief Append a chunk to the history, which starts with copies of the first sample.
+ */
+void PolyphaseResampler::consume(std::span<const double> input)
+{
+    if (consumed_ == 0) {
+        history_.assign(taps_per_phase_ - 1, input.front());
+        history_first_ = 1 - static_cast<int64_t>(taps_per_phase_);
+    }
+    history_.insert(history_.end(), input.begin(), input.end());
+    consumed_ += input.size();
+}
+
+/**
+ * @brief Write the outputs up to last_output whose samples are all in the history.
+ */
+size_t PolyphaseResampler::emitOutputs(std::span<double> output, uint64_t last_output)
+{
+    const int64_t history_end = history_first_ + static_cast<int64_t>(history_.size());
+    size_t written = 0;
+    for (; next_output_ <= last_output; ++next_output_) {
+        // Position of the output at the upsampled rate, shifted by the filter delay
+        const uint64_t position = next_output_ * down_ + centre_;
+        const auto newest = static_cast<int64_t>(position / up_);
+        if (newest >= history_end) {
+            break;
+        }
+        const size_t phase = position % up_;
+        const double *samples = history_.data() + (newest + 1 - static_cast<int64_t>(taps_per_phase_)
+                                                   - history_first_);
+        output[written++] = dot(phases_.data() + phase * taps_per_phase_, samples, taps_per_phase_);
+    }
+    return written;
+}
+
+/**
+ * @brief Drop the samples older than those of the next output, keeping at least the last one.
+ */
+void PolyphaseResampler::trim()
+{
+    const auto newest = static_cast<int64_t>((next_output_ * down_ + centre_) / up_);
+    const int64_t oldest = newest + 1 - static_cast<int64_t>(taps_per_phase_);
+    const auto dropped = static_cast<size_t>(std::clamp<int64_t>(oldest - history_first_,
+                                                                 0,
+                                                                 static_cast<int64_t>(history_.size()) - 1));
+    history_.erase(history_.begin(), history_.begin() + dropped);
+    history_first_ += static_cast<int64_t>(dropped);
+}
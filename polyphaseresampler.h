@@ -0,0 +1,110 @@
+#ifndef POLYPHASERESAMPLER_H
+#define POLYPHASERESAMPLER_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @brief The PolyphaseResampler class converts a uniformly sampled series between two integer
+ * rates with an anti-aliasing low-pass filter.
+ *
+ * The rate changes by L / M, the ratio of the output and input rates reduced by their greatest
+ * common divisor. The series is conceptually upsampled by L, low-pass filtered below the lower
+ * of the two Nyquist frequencies and decimated by M. The filter is a Kaiser-windowed sinc, split
+ * into L phases of taps_per_phase coefficients stored contiguously and reversed, so an output
+ * sample is a single dot product of one phase with consecutive input samples: the cost is
+ * proportional to output samples x taps per phase, and the inner loop runs on four independent
+ * accumulators the compiler can vectorise. Each phase is normalised to a unit sum, so a constant
+ * series passes unchanged.
+ *
+ * The filter is centred: output m is at the instant of input m * M / L, the first output at the
+ * first input. Samples before the first and after the last one are taken equal to them.
+ *
+ * The resampler is streamable: process() consumes chunks of any size and emits the outputs whose
+ * inputs have all been seen, keeping the last taps_per_phase samples between calls; flush() emits
+ * the remaining outputs at the end of the stream. resample() converts a whole series at once.
+ */
+class PolyphaseResampler
+{
+public:
+    /**
+     * @brief Design the filter of a rate conversion.
+     *
+     * @param input_rate Rate of the input series, in Hertz.
+     * @param output_rate Rate of the output series, in Hertz.
+     * @param half_taps Half length of the filter, in samples at the slower of the two rates. A
+     * longer filter has a sharper cutoff and costs proportionally more.
+     * @throws std::invalid_argument if a rate or half_taps is not positive.
+     */
+    PolyphaseResampler(int input_rate, int output_rate, int half_taps = 10);
+
+    int upFactor() const;   ///< L, the upsampling factor.
+    int downFactor() const; ///< M, the decimation factor.
+    size_t tapsPerPhase() const;
+
+    /**
+     * @brief Get the number of outputs of a series of input_samples samples, converted at once.
+     */
+    size_t resampledSize(size_t input_samples) const;
+
+    /**
+     * @brief Get an upper bound on the outputs process() emits for a chunk of input_samples.
+     */
+    size_t maxOutputSize(size_t input_samples) const;
+
+    /**
+     * @brief Get an upper bound on the outputs flush() emits.
+     */
+    size_t maxFlushSize() const;
+
+    /**
+     * @brief Consume the next chunk of the stream.
+     *
+     * @param output Output, at least maxOutputSize(input.size()) long.
+     * @return size_t The number of outputs written, those whose inputs have all been seen.
+     * @throws std::invalid_argument if output is too short.
+     */
+    size_t process(std::span<const double> input, std::span<double> output);
+
+    /**
+     * @brief Emit the outputs waiting for samples past the end of the stream, then reset.
+     *
+     * @param output Output, at least maxFlushSize() long.
+     * @return size_t The number of outputs written.
+     * @throws std::invalid_argument if output is too short.
+     */
+    size_t flush(std::span<double> output);
+
+    /**
+     * @brief Forget the stream, so the next process() starts a new one.
+     */
+    void reset();
+
+    /**
+     * @brief Convert a whole series, starting a new stream.
+     *
+     * @param output Output, at least resampledSize(input.size()) long.
+     * @return size_t The number of outputs written, resampledSize(input.size()).
+     * @throws std::invalid_argument if output is too short.
+     */
+    size_t resample(std::span<const double> input, std::span<double> output);
+
+private:
+    int up_;                          ///< Upsampling factor L.
+    int down_;                        ///< Decimation factor M.
+    int64_t centre_;                  ///< Index of the centre tap of the prototype filter.
+    size_t taps_per_phase_;           ///< Coefficients per phase, a multiple of four.
+    std::vector<double> phases_;      ///< Reversed coefficients of every phase, phase after phase.
+
+    std::vector<double> history_;     ///< Input samples still needed by the next outputs.
+    int64_t history_first_ = 0;       ///< Index in the stream of history_[0].
+    uint64_t consumed_ = 0;           ///< Input samples seen since the start of the stream.
+    uint64_t next_output_ = 0;        ///< Index in the stream of the next output.
+
+    void consume(std::span<const double> input);
+    size_t emitOutputs(std::span<double> output, uint64_t last_output);
+    void trim();
+};
+
+#endif // POLYPHASERESAMPLER_H
@@ -0,0 +1,891 @@
+#include "batchprocessor.h"
+#include "compactwkv.h"
+#include "compressedwkv.h"
+#include "mappedwkv.h"
+#include "metrics.h"
+#include "multichannelwkv.h"
+#include "pipelinearena.h"
+#include "processinggraph.h"
+#include "rangeaggregateindex.h"
+#include "sensordataprocessor.h"
+#include "spectralanalyzer.h"
+#include "streamaligner.h"
+#include "streamingprocessor.h"
+#include "syntheticgenerator.h"
+#include "wkvfactory.h"
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Headless throughput benchmark for the sensor processing core.
+ *
+ * Times every processing stage on synthetic recordings of increasing length and reports the
+ * throughput (samples/s), the cost per sample (ns/sample) and the peak resident set size after
+ * the stage. Each stage is repeated and the fastest run is reported, which gives a repeatable
+ * baseline to compare optimisations against.
+ *
+ * Usage: twiice_benchmark [--min-samples N] [--max-samples N] [--repeat R] [--csv]
+ *                         [--metrics-json PATH] [--metrics-prom PATH]
+ *
+ * Built with TWIICE_ENABLE_METRICS, the latency histograms and volumes of the instrumented stages
+ * over the whole run can be exported as JSON or Prometheus text.
+ *
+ * Before timing, a few regression checks of the storage layers are run; the benchmark stops if
+ * one fails, so no numbers are reported for a broken build.
+ */
+
+namespace {
+
+struct BenchmarkOptions
+{
+    size_t min_samples = 1000;
+    size_t max_samples = 100000000;
+    int repeat = 3;
+    bool csv = false;
+    std::string metrics_json;       ///< File receiving the stage metrics as JSON, if any.
+    std::string metrics_prometheus; ///< File receiving the stage metrics as Prometheus text, if any.
+};
+
+struct StageResult
+{
+    std::string stage;
+    size_t samples;
+    double seconds;
+    long peak_rss_kb;
+};
+
+long peakRssKb()
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss; // Kilobytes on Linux
+}
+
+/**
+ * @brief Run a stage several times and keep the fastest run.
+ *
+ * @param setup Called before every run, outside of the timed region.
+ * @param stage The timed work.
+ * @return double The fastest run in seconds.
+ */
+double timeStage(int repeat, const std::function<void()> &setup, const std::function<void()> &stage)
+{
+    double best = std::numeric_limits<double>::max();
+    for (int r = 0; r < repeat; ++r) {
+        setup();
+        const auto begin = std::chrono::steady_clock::now();
+        stage();
+        const auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - begin).count());
+    }
+    return best;
+}
+
+void printResult(const StageResult &result, bool csv)
+{
+    const double samples_per_s = result.samples / result.seconds;
+    const double ns_per_sample = result.seconds * 1e9 / std::max<size_t>(result.samples, 1);
+    if (csv) {
+        std::cout << result.stage << ',' << result.samples << ',' << result.seconds << ','
+                  << samples_per_s << ',' << ns_per_sample << ',' << result.peak_rss_kb << '\n';
+        return;
+    }
+    std::cout << std::left << std::setw(44) << result.stage << std::right << std::setw(12)
+              << result.samples << std::setw(14) << std::fixed << std::setprecision(6)
+              << result.seconds << std::setw(16) << std::setprecision(0) << samples_per_s
+              << std::setw(12) << std::setprecision(2) << ns_per_sample << std::setw(12)
+              << std::setprecision(1) << result.peak_rss_kb / 1024.0 << '\n';
+}
+
+void printHeader(bool csv)
+{
+    if (csv) {
+        std::cout << "stage,samples,seconds,samples_per_s,ns_per_sample,peak_rss_kb\n";
+        return;
+    }
+    std::cout << std::left << std::setw(44) << "stage" << std::right << std::setw(12) << "samples"
+              << std::setw(14) << "seconds" << std::setw(16) << "samples/s" << std::setw(12)
+              << "ns/sample" << std::setw(12) << "peak MB" << '\n';
+}
+
+/**
+ * @brief Benchmark every stage on a hip recording of roughly the requested sample count.
+ */
+void benchmarkSize(size_t samples, const BenchmarkOptions &options)
+{
+    constexpr int hip_frequency = 1000, imu_frequency = 400, target_rate = 100;
+    const int duration_s = static_cast<int>(std::max<size_t>(samples / hip_frequency, 1));
+    const std::string suffix = " [" + std::to_string(samples) + "]";
+
+    SensorDataProcessor processor;
+    std::unique_ptr<WKV> hip, imu, resampled, smoothed;
+
+    // Generation
+    double seconds = timeStage(
+        options.repeat,
+        [&] { hip = WKVFactory::createSensor("HIP", "hip_sensor"); },
+        [&] { hip->generateData(hip_frequency, 0.02, duration_s); });
+    const size_t hip_samples = hip->getData().size();
+    printResult({"generateData HIP" + suffix, hip_samples, seconds, peakRssKb()}, options.csv);
+
+    seconds = timeStage(
+        options.repeat,
+        [&] { imu = WKVFactory::createSensor("IMU", "3-axis-IMU"); },
+        [&] { imu->generateData(imu_frequency, 0.03, duration_s, hip.get()); });
+    printResult({"generateData IMU" + suffix, imu->getData().size(), seconds, peakRssKb()},
+                options.csv);
+    imu.reset();
+
+    // Seeded, chunk-parallel generation, on one thread and on all of them
+    SyntheticTiming timing;
+    timing.start_time_us = hip->getStartTimeUs();
+    timing.frequency = hip_frequency;
+    timing.jitter = 0.02;
+    timing.duration_seconds = duration_s;
+    for (const size_t threads : {size_t(1), size_t(0)}) {
+        const SyntheticGenerator generator(1, threads);
+        std::vector<uint64_t> generated_timestamps;
+        std::vector<double> generated_values;
+        seconds = timeStage(
+            options.repeat,
+            [] {},
+            [&] { generator.generateHip(timing, generated_timestamps, generated_values); });
+        printResult({"SyntheticGenerator HIP threads=" + std::to_string(WorkStealingPool(threads).threadCount())
+                         + suffix,
+                     generated_timestamps.size(),
+                     seconds,
+                     peakRssKb()},
+                    options.csv);
+    }
+
+    // Recording persistence: writing, then mapping it back, which should not depend on its size
+    const std::string recording_path = "twiice_benchmark_recording.wkv";
+    seconds = timeStage(options.repeat, [] {}, [&] { MappedWKV::write(*hip, recording_path); });
+    printResult({"MappedWKV::write" + suffix, hip_samples, seconds, peakRssKb()}, options.csv);
+
+    std::unique_ptr<MappedWKV> mapped;
+    seconds = timeStage(
+        options.repeat,
+        [&] { mapped.reset(); },
+        [&] { mapped = std::make_unique<MappedWKV>(recording_path); });
+    printResult({"MappedWKV open" + suffix, hip_samples, seconds, peakRssKb()}, options.csv);
+    mapped.reset();
+    std::remove(recording_path.c_str());
+
+    // Compressed storage: encoding, then decoding everything or a window, against a plain pass
+    // over the vectors
+    for (const double resolution : {0.0, 1e-3}) {
+        const std::string variant = resolution > 0.0 ? " 1e-3" : " lossless";
+        CompressedWKV compressed("hip_sensor_compressed", "deg", 1024, resolution);
+        seconds = timeStage(options.repeat, [] {}, [&] { compressed.copyFrom(*hip); });
+        printResult({"CompressedWKV encode" + variant + suffix, hip_samples, seconds, peakRssKb()},
+                    options.csv);
+        if (!options.csv) {
+            std::cout << "    compression ratio: " << std::setprecision(2)
+                      << 16.0 * hip_samples / compressed.compressedBytes() << '\n';
+        }
+
+        std::vector<uint64_t> window_timestamps;
+        std::vector<double> window_values;
+        seconds = timeStage(
+            options.repeat,
+            [] {},
+            [&] {
+                compressed.decodeWindow(0, std::numeric_limits<uint64_t>::max(), window_timestamps, window_values);
+            });
+        printResult({"CompressedWKV decode" + variant + suffix, hip_samples, seconds, peakRssKb()},
+                    options.csv);
+
+        const uint64_t window_start_us = hip->getStartTimeUs() + 2700000;
+        seconds = timeStage(
+            options.repeat,
+            [] {},
+            [&] {
+                compressed.decodeWindow(window_start_us, window_start_us + 2100000, window_timestamps, window_values);
+            });
+        printResult({"CompressedWKV decode window" + variant + suffix,
+                     window_timestamps.size(),
+                     seconds,
+                     peakRssKb()},
+                    options.csv);
+    }
+
+    // Compact storage: encoding, then the derivative, smoothing and resampling kernels run on
+    // the narrow columns in place
+    auto benchmarkCompact = [&]<typename Value>(CompactWKV<Value> &compact, const std::string &variant) {
+        seconds = timeStage(options.repeat, [] {}, [&] { compact.copyFrom(*hip); });
+        printResult({"CompactWKV encode " + variant + suffix, hip_samples, seconds, peakRssKb()},
+                    options.csv);
+        if (!options.csv) {
+            std::cout << "    bytes per sample: " << std::setprecision(3)
+                      << static_cast<double>(compact.storageBytes()) / compact.size() << '\n';
+        }
+
+        DerivativeSeries compact_derivatives;
+        seconds = timeStage(
+            options.repeat,
+            [] {},
+            [&] {
+                processor.calculateVelocityAndAcceleration(compact, 0.0, duration_s, compact_derivatives);
+            });
+        printResult({"CompactWKV derivatives " + variant + suffix, hip_samples, seconds, peakRssKb()},
+                    options.csv);
+
+        std::vector<double> compact_smoothed;
+        seconds = timeStage(
+            options.repeat,
+            [] {},
+            [&] {
+                processor.applyGaussianSmoothing(compact, compact_smoothed, 19, 3, SmoothingMode::Fir);
+            });
+        printResult({"CompactWKV smoothing fir " + variant + suffix, hip_samples, seconds, peakRssKb()},
+                    options.csv);
+
+        seconds = timeStage(
+            options.repeat,
+            [&] { resampled = WKVFactory::createSensor("HIP", "hip_sensor_resampled"); },
+            [&] { processor.resampleData(compact, resampled.get(), target_rate, 0.0, duration_s); });
+        printResult({"CompactWKV resampleData cubic " + variant + suffix, hip_samples, seconds, peakRssKb()},
+                    options.csv);
+        resampled.reset();
+    };
+    // The 32-bit timestamp offsets cover about 71 minutes of recording
+    const uint64_t recording_span_us = hip->getTimestampsUs().back() - hip->getTimestampsUs().front();
+    if (recording_span_us <= std::numeric_limits<uint32_t>::max()) {
+        {
+            CompactWKV<double> compact("hip_sensor_compact", "deg");
+            benchmarkCompact(compact, "double");
+        }
+        {
+            CompactWKV<float> compact("hip_sensor_compact", "deg");
+            benchmarkCompact(compact, "float");
+        }
+        {
+            CompactWKV<int16_t> compact("hip_sensor_compact", "deg", 0.01);
+            benchmarkCompact(compact, "int16");
+        }
+    } else if (!options.csv) {
+        std::cout << "    CompactWKV skipped: recording longer than its 2^32 us timestamp range\n";
+    }
+
+    double checksum = 0.0;
+    seconds = timeStage(
+        options.repeat,
+        [&] { checksum = 0.0; },
+        [&] {
+            const std::span<const uint64_t> timestamps = hip->getTimestampsUs();
+            const std::span<const double> data = hip->getData();
+            for (size_t i = 0; i < data.size(); ++i) {
+                checksum += data[i] + static_cast<double>(timestamps[i] & 1);
+            }
+        });
+    printResult({"plain vectors read pass" + suffix, hip_samples, seconds, peakRssKb()}, options.csv);
+    if (checksum == 0.5) {
+        std::cout << std::flush; // Keep the read pass from being optimised away
+    }
+
+    // Processing over the full recording
+    const double end_time_s = duration_s;
+
+    const std::pair<InterpolationMode, const char *> interpolations[]
+        = {{InterpolationMode::CardinalSpline, "spline"},
+           {InterpolationMode::Linear, "linear"},
+           {InterpolationMode::CatmullRom, "catmull-rom"},
+           {InterpolationMode::Cubic, "cubic"},
+           {InterpolationMode::Polyphase, "polyphase"}};
+    for (const auto &[interpolation, interpolation_name] : interpolations) {
+        seconds = timeStage(
+            options.repeat,
+            [&] { resampled = WKVFactory::createSensor("HIP", "hip_sensor_resampled"); },
+            [&] {
+                processor.resampleData(hip.get(), resampled.get(), target_rate, 0.0, end_time_s, interpolation);
+            });
+        printResult({"resampleData " + std::string(interpolation_name) + suffix,
+                     hip_samples,
+                     seconds,
+                     peakRssKb()},
+                    options.csv);
+        resampled.reset();
+    }
+
+    seconds = timeStage(
+        options.repeat,
+        [] {},
+        [&] { processor.findPeaks(hip.get(), 0.0, end_time_s); });
+    printResult({"findPeaks" + suffix, hip_samples, seconds, peakRssKb()}, options.csv);
+
+    PeakCriteria criteria;
+    criteria.prominence = 10.0;
+    criteria.distance = hip_frequency / 2;
+    PeakSeries peaks;
+    seconds = timeStage(
+        options.repeat,
+        [] {},
+        [&] { processor.findPeaks(hip.get(), 0.0, end_time_s, criteria, peaks); });
+    printResult({"findPeaks prominence+distance" + suffix, hip_samples, seconds, peakRssKb()},
+                options.csv);
+
+    // Processing over the fixed window used by the GUI: cost should not depend on the recording
+    constexpr double window_start_s = 2.7, window_end_s = 4.8;
+    const size_t window_samples = WKVView::window(*hip, window_start_s, window_end_s).size();
+
+    seconds = timeStage(
+        options.repeat,
+        [&] { resampled = WKVFactory::createSensor("HIP", "hip_sensor_resampled"); },
+        [&] {
+            processor.resampleData(hip.get(), resampled.get(), target_rate, window_start_s, window_end_s);
+        });
+    printResult({"resampleData window" + suffix, window_samples, seconds, peakRssKb()}, options.csv);
+    resampled.reset();
+
+    seconds = timeStage(
+        options.repeat,
+        [] {},
+        [&] { processor.findPeaks(hip.get(), window_start_s, window_end_s); });
+    printResult({"findPeaks window" + suffix, window_samples, seconds, peakRssKb()}, options.csv);
+
+    // Lazy graph over the window: a cold evaluation, then the window panned by a tenth of its
+    // length, which only computes the newly exposed tiles
+    std::unique_ptr<ProcessingGraph> processing_graph;
+    ProcessingGraph::NodeId graph_derivatives = 0;
+    DerivativeSeries graph_output;
+    auto buildGraph = [&] {
+        processing_graph = std::make_unique<ProcessingGraph>(256, 64);
+        graph_derivatives = processing_graph->addDerivatives(
+            processing_graph->addSmoothing(processing_graph->addResampling(*hip, target_rate), 19, 3));
+    };
+    seconds = timeStage(options.repeat, buildGraph, [&] {
+        processing_graph->evaluate(graph_derivatives, window_start_s, window_end_s, graph_output);
+    });
+    printResult({"ProcessingGraph window" + suffix, window_samples, seconds, peakRssKb()}, options.csv);
+    const double pan_s = (window_end_s - window_start_s) / 10;
+    seconds = timeStage(
+        options.repeat,
+        [&] {
+            buildGraph();
+            processing_graph->evaluate(graph_derivatives, window_start_s, window_end_s, graph_output);
+        },
+        [&] {
+            processing_graph->evaluate(graph_derivatives,
+                                       window_start_s + pan_s,
+                                       window_end_s + pan_s,
+                                       graph_output);
+        });
+    printResult({"ProcessingGraph panned window" + suffix, window_samples, seconds, peakRssKb()},
+                options.csv);
+    processing_graph.reset();
+
+    DerivativeSeries derivatives;
+    seconds = timeStage(
+        options.repeat,
+        [] {},
+        [&] {
+            processor.calculateVelocityAndAcceleration(*hip,
+                                                       0.0,
+                                                       end_time_s,
+                                                       derivatives);
+        });
+    printResult({"calculateVelocityAndAcceleration" + suffix, hip_samples, seconds, peakRssKb()},
+                options.csv);
+    derivatives = DerivativeSeries();
+
+    // Multi-channel series: three axes against one timestamp column, compared with three
+    // single-channel sensors processed one after the other
+    constexpr size_t axis_count = 3;
+    const std::span<const uint64_t> hip_timestamps = hip->getTimestampsUs();
+    std::vector<std::unique_ptr<WKV>> axes;
+    MultiChannelWKV imu_axes("imu_axes", "deg", {"x", "y", "z"});
+    imu_axes.setStartTimeUs(hip->getStartTimeUs());
+    imu_axes.setTimestampsUs(std::vector<uint64_t>(hip_timestamps.begin(), hip_timestamps.end()));
+    for (size_t c = 0; c < axis_count; ++c) {
+        std::vector<double> axis(hip->getData().begin(), hip->getData().end());
+        axes.push_back(WKVFactory::createSensor("HIP", "hip_axis_" + std::to_string(c)));
+        axes.back()->copyFrom(*hip);
+        axes.back()->setTimestampsUs(std::vector<uint64_t>(hip_timestamps.begin(), hip_timestamps.end()));
+        axes.back()->setData(axis);
+        imu_axes.setChannel(c, std::move(axis));
+    }
+    const size_t axis_samples = axis_count * hip_samples;
+
+    std::vector<std::unique_ptr<WKV>> resampled_axes(axis_count);
+    seconds = timeStage(
+        options.repeat,
+        [&] {
+            for (auto &axis : resampled_axes) {
+                axis = WKVFactory::createSensor("HIP", "hip_axis_resampled");
+            }
+        },
+        [&] {
+            for (size_t c = 0; c < axis_count; ++c) {
+                processor.resampleData(axes[c].get(), resampled_axes[c].get(), target_rate, 0.0, end_time_s);
+            }
+        });
+    printResult({"resampleData cubic 3 sensors" + suffix, axis_samples, seconds, peakRssKb()},
+                options.csv);
+    resampled_axes.clear();
+    std::optional<MultiChannelWKV> resampled_imu_axes;
+    seconds = timeStage(
+        options.repeat,
+        [&] { resampled_imu_axes.emplace("imu_axes_resampled", "deg", std::vector<std::string>{"x", "y", "z"}); },
+        [&] { processor.resampleData(imu_axes, *resampled_imu_axes, target_rate, 0.0, end_time_s); });
+    printResult({"resampleData cubic MultiChannelWKV x3" + suffix, axis_samples, seconds, peakRssKb()},
+                options.csv);
+    resampled_imu_axes.reset();
+
+    seconds = timeStage(options.repeat, [] {}, [&] {
+        for (size_t c = 0; c < axis_count; ++c) {
+            processor.calculateVelocityAndAcceleration(*axes[c], 0.0, end_time_s, derivatives);
+        }
+    });
+    printResult({"calculateVelocityAndAcceleration 3 sensors" + suffix, axis_samples, seconds, peakRssKb()},
+                options.csv);
+    derivatives = DerivativeSeries();
+    MultiChannelDerivatives axis_derivatives;
+    seconds = timeStage(options.repeat, [] {}, [&] {
+        processor.calculateVelocityAndAcceleration(imu_axes, 0.0, end_time_s, axis_derivatives);
+    });
+    printResult({"calculateVelocityAndAcceleration MultiChannelWKV x3" + suffix,
+                 axis_samples,
+                 seconds,
+                 peakRssKb()},
+                options.csv);
+    axis_derivatives = MultiChannelDerivatives();
+
+    seconds = timeStage(options.repeat, [] {}, [&] {
+        for (size_t c = 0; c < axis_count; ++c) {
+            processor.findPeaks(axes[c].get(), 0.0, end_time_s, criteria, peaks);
+        }
+    });
+    printResult({"findPeaks prominence+distance 3 sensors" + suffix, axis_samples, seconds, peakRssKb()},
+                options.csv);
+    std::vector<PeakSeries> axis_peaks;
+    seconds = timeStage(options.repeat, [] {}, [&] {
+        processor.findPeaks(imu_axes, 0.0, end_time_s, criteria, axis_peaks);
+    });
+    printResult({"findPeaks prominence+distance MultiChannelWKV x3" + suffix,
+                 axis_samples,
+                 seconds,
+                 peakRssKb()},
+                options.csv);
+    axis_peaks.clear();
+
+    // Smoothing rewrites the series, run last
+    std::vector<double> axis_smoothed;
+    seconds = timeStage(options.repeat, [] {}, [&] {
+        for (size_t c = 0; c < axis_count; ++c) {
+            processor.applyGaussianSmoothing(WKVView::all(*axes[c]), axis_smoothed, 19, 3, SmoothingMode::Fir);
+            axes[c]->setData(axis_smoothed);
+        }
+    });
+    printResult({"applyGaussianSmoothing fir 3 sensors" + suffix, axis_samples, seconds, peakRssKb()},
+                options.csv);
+    seconds = timeStage(options.repeat, [] {}, [&] {
+        processor.applyGaussianSmoothing(imu_axes, 19, 3, SmoothingMode::Fir);
+    });
+    printResult({"applyGaussianSmoothing fir MultiChannelWKV x3" + suffix, axis_samples, seconds, peakRssKb()},
+                options.csv);
+    axes.clear();
+
+    // Alignment: the hip and IMU merged onto one time base, and the lag of the IMU angular
+    // velocity behind the hip angle derivative, by FFT and by a direct search over the lags
+    imu = WKVFactory::createSensor("IMU", "3-axis-IMU");
+    imu->generateData(imu_frequency, 0.03, duration_s, hip.get());
+    StreamAligner aligner(target_rate);
+    aligner.addStream(*hip, LagSignal::Derivative);
+    aligner.addStream(*imu);
+    const size_t stream_samples = hip_samples + imu->getData().size();
+    std::optional<MultiChannelWKV> aligned;
+    seconds = timeStage(options.repeat, [&] { aligned.reset(); }, [&] { aligned.emplace(aligner.align()); });
+    printResult({"StreamAligner align hip+imu" + suffix, stream_samples, seconds, peakRssKb()}, options.csv);
+
+    constexpr double max_lag_s = 10.0;
+    std::vector<LagEstimate> lags;
+    seconds = timeStage(options.repeat, [] {}, [&] { lags = aligner.estimateLags(max_lag_s); });
+    printResult({"StreamAligner estimateLags fft" + suffix, stream_samples, seconds, peakRssKb()},
+                options.csv);
+
+    // Direct search on the same signals, O(n * lags)
+    std::vector<double> hip_velocity(aligned->getChannel(0).begin(), aligned->getChannel(0).end());
+    for (size_t i = 1; i + 1 < hip_velocity.size(); ++i) {
+        hip_velocity[i] = (aligned->getChannel(0)[i + 1] - aligned->getChannel(0)[i - 1]) * 0.5 * target_rate;
+    }
+    const std::span<const double> imu_velocity = aligned->getChannel(1);
+    const long max_lag = std::min<long>(std::lround(max_lag_s * target_rate), static_cast<long>(aligned->size()) - 1);
+    long direct_lag = 0;
+    seconds = timeStage(options.repeat, [] {}, [&] {
+        double best = -std::numeric_limits<double>::max();
+        for (long lag = -max_lag; lag <= max_lag; ++lag) {
+            double sum = 0.0;
+            for (long i = std::max(0L, -lag); i < static_cast<long>(imu_velocity.size()) - std::max(0L, lag); ++i) {
+                sum += hip_velocity[i] * imu_velocity[i + lag];
+            }
+            if (sum > best) {
+                best = sum;
+                direct_lag = lag;
+            }
+        }
+    });
+    printResult({"cross-correlation direct search" + suffix, stream_samples, seconds, peakRssKb()},
+                options.csv);
+    if (!options.csv) {
+        std::cout << "    lag: fft " << std::setprecision(4) << lags[1].lag_s << " s (correlation "
+                  << lags[1].correlation << "), direct " << static_cast<double>(direct_lag) / target_rate
+                  << " s\n";
+    }
+    aligned.reset();
+    imu.reset();
+
+    // Spectral analysis of the resampled hip angle: Welch PSD and cadence of 20 s STFT frames
+    resampled = WKVFactory::createSensor("HIP", "hip_sensor_resampled");
+    processor.resampleData(hip.get(), resampled.get(), target_rate, 0.0, end_time_s);
+    const WKVView resampled_view = WKVView::all(*resampled);
+    SpectralAnalyzer analyzer({2048, 0.5, 0.3, 3.0});
+    PowerSpectrum spectrum;
+    seconds = timeStage(options.repeat, [] {}, [&] { analyzer.welch(resampled_view, spectrum); });
+    printResult({"SpectralAnalyzer welch" + suffix, resampled_view.size(), seconds, peakRssKb()}, options.csv);
+    CadenceSeries cadence;
+    seconds = timeStage(options.repeat, [] {}, [&] { analyzer.cadence(resampled_view, cadence); });
+    printResult({"SpectralAnalyzer cadence STFT" + suffix, resampled_view.size(), seconds, peakRssKb()},
+                options.csv);
+    if (!options.csv && !cadence.empty()) {
+        const auto [slowest, fastest] = std::minmax_element(cadence.cadence_hz.begin(), cadence.cadence_hz.end());
+        std::cout << "    cadence: " << cadence.size() << " frames, " << std::setprecision(4) << *slowest
+                  << " to " << *fastest << " Hz\n";
+    }
+    resampled.reset();
+
+    // Streaming pipeline fed with one-second blocks, as a live 1 kHz acquisition would
+    seconds = timeStage(
+        options.repeat,
+        [] {},
+        [&] {
+            constexpr size_t block_size = hip_frequency;
+            StreamingPipeline pipeline(hip->getStartTimeUs(), target_rate, 19, 3);
+            const std::span<const uint64_t> timestamps = hip->getTimestampsUs();
+            const std::span<const double> data = hip->getData();
+            for (size_t i = 0; i < timestamps.size(); i += block_size) {
+                const size_t count = std::min(block_size, timestamps.size() - i);
+                pipeline.push(timestamps.subspan(i, count), data.subspan(i, count));
+            }
+            pipeline.flush();
+        });
+    printResult({"StreamingPipeline 1000-sample blocks" + suffix, hip_samples, seconds, peakRssKb()},
+                options.csv);
+
+    // Derived series: copying a sensor shares its columns, its first modification copies one
+    seconds = timeStage(
+        options.repeat,
+        [&] { smoothed = WKVFactory::createSensor("HIP", "hip_sensor_copy"); },
+        [&] { smoothed->copyFrom(*hip); });
+    printResult({"WKV::copyFrom" + suffix, hip_samples, seconds, peakRssKb()}, options.csv);
+    seconds = timeStage(
+        options.repeat,
+        [&] {
+            smoothed = WKVFactory::createSensor("HIP", "hip_sensor_copy");
+            smoothed->copyFrom(*hip);
+        },
+        [&] { smoothed->addDataPoint(hip->getTimestampsUs().back() + 1, 0.0); });
+    printResult({"WKV first write after copyFrom" + suffix, hip_samples, seconds, peakRssKb()},
+                options.csv);
+
+    // Window statistics: a scan of every window against the range-aggregate index, over the same
+    // random windows. The samples column counts the samples of all the windows.
+    std::mt19937_64 window_rng(42);
+    std::uniform_real_distribution<double> window_edge(0.0, duration_s);
+    std::vector<std::pair<double, double>> statistics_windows(64);
+    for (auto &[start_s, end_s] : statistics_windows) {
+        start_s = window_edge(window_rng);
+        end_s = window_edge(window_rng);
+        if (end_s < start_s) {
+            std::swap(start_s, end_s);
+        }
+    }
+    std::vector<WindowStatistics> scanned(statistics_windows.size());
+    std::vector<WindowStatistics> indexed(statistics_windows.size());
+    size_t statistics_samples = 0;
+    hip->disableAggregateIndex();
+    seconds = timeStage(options.repeat, [] {}, [&] {
+        statistics_samples = 0;
+        for (size_t w = 0; w < statistics_windows.size(); ++w) {
+            scanned[w] = hip->statistics(statistics_windows[w].first, statistics_windows[w].second);
+            statistics_samples += scanned[w].count;
+        }
+    });
+    printResult({"WKV::statistics scan x64 windows" + suffix, statistics_samples, seconds, peakRssKb()},
+                options.csv);
+    seconds = timeStage(
+        options.repeat,
+        [&] { hip->disableAggregateIndex(); },
+        [&] { hip->enableAggregateIndex(); });
+    printResult({"RangeAggregateIndex build" + suffix, hip_samples, seconds, peakRssKb()}, options.csv);
+    seconds = timeStage(options.repeat, [] {}, [&] {
+        for (size_t w = 0; w < statistics_windows.size(); ++w) {
+            indexed[w] = hip->statistics(statistics_windows[w].first, statistics_windows[w].second);
+        }
+    });
+    printResult({"WKV::statistics indexed x64 windows" + suffix, statistics_samples, seconds, peakRssKb()},
+                options.csv);
+    double max_statistics_error = 0.0;
+    for (size_t w = 0; w < statistics_windows.size(); ++w) {
+        if (scanned[w].count > 0) {
+            max_statistics_error = std::max({max_statistics_error,
+                                             std::abs(indexed[w].mean - scanned[w].mean),
+                                             std::abs(indexed[w].rms - scanned[w].rms)});
+        }
+    }
+    if (!options.csv) {
+        std::cout << "    max abs mean/rms error vs scan: " << std::scientific << max_statistics_error
+                  << std::fixed << '\n';
+    }
+    hip->disableAggregateIndex();
+
+    // Smoothing: every engine at the pipeline sigma and at a wide sigma, with the error of the
+    // faster engines against the direct convolution.
+    struct SmoothingCase
+    {
+        int kernel_size;
+        double sigma;
+    };
+    const std::pair<SmoothingMode, const char *> modes[] = {{SmoothingMode::Direct, "direct"},
+                                                            {SmoothingMode::Fir, "fir"},
+                                                            {SmoothingMode::Recursive, "recursive"}};
+    for (const SmoothingCase smoothing_case : {SmoothingCase{19, 3}, SmoothingCase{301, 50}}) {
+        std::vector<double> reference;
+        for (const auto &[mode, mode_name] : modes) {
+            seconds = timeStage(
+                options.repeat,
+                [&] {
+                    smoothed = WKVFactory::createSensor("HIP", "hip_sensor_smoothed");
+                    smoothed->copyFrom(*hip);
+                },
+                [&] {
+                    processor.applyGaussianSmoothing(*smoothed,
+                                                     smoothing_case.kernel_size,
+                                                     smoothing_case.sigma,
+                                                     mode);
+                });
+            const std::string stage = "applyGaussianSmoothing " + std::string(mode_name) + " s="
+                                      + std::to_string(static_cast<int>(smoothing_case.sigma));
+            printResult({stage + suffix, hip_samples, seconds, peakRssKb()}, options.csv);
+
+            if (mode == SmoothingMode::Direct) {
+                reference.assign(smoothed->getData().begin(), smoothed->getData().end());
+                continue;
+            }
+            double max_error = 0.0;
+            for (size_t i = 0; i < reference.size(); ++i) {
+                max_error = std::max(max_error, std::abs(smoothed->getData()[i] - reference[i]));
+            }
+            if (!options.csv) {
+                std::cout << "    max abs error vs direct: " << std::scientific << max_error
+                          << " (signal amplitude 60)" << std::fixed << '\n';
+            }
+        }
+    }
+
+    // Batch engine: the same pipeline over a set of sessions, on one core and on every core
+    hip.reset();
+    constexpr size_t session_count = 16;
+    const int session_duration_s = std::max(duration_s / static_cast<int>(session_count), 1);
+    std::vector<std::unique_ptr<WKV>> sessions;
+    std::vector<const IWKV *> recordings;
+    size_t session_samples = 0;
+    for (size_t s = 0; s < session_count; ++s) {
+        sessions.push_back(WKVFactory::createSensor("HIP", "session_" + std::to_string(s)));
+        sessions.back()->generateData(hip_frequency, 0.02, session_duration_s);
+        recordings.push_back(sessions.back().get());
+        session_samples += sessions.back()->getData().size();
+    }
+    for (const size_t thread_count : {size_t(1), size_t(0)}) {
+        BatchProcessor batch(BatchPipeline{}, thread_count);
+        BatchReport report;
+        seconds = timeStage(options.repeat, [] {}, [&] { report = batch.process(recordings); });
+        printResult({"BatchProcessor threads=" + std::to_string(report.thread_count) + suffix,
+                     session_samples,
+                     seconds,
+                     peakRssKb()},
+                    options.csv);
+        if (!options.csv) {
+            std::cout << "    " << session_count << " sessions, " << report.steal_count
+                      << " chunks stolen, " << report.arena_allocations.allocations
+                      << " arena allocations, " << report.arena_upstream.allocations
+                      << " from the heap in the last run\n";
+        }
+    }
+}
+
+/**
+ * @brief Check that a sensor copied from one built on an arena stays valid after the arena reset.
+ */
+bool checkArenaCopy()
+{
+    // Large enough for the sensor, so reset() keeps the buffer and the next allocation reuses it
+    PipelineArena arena(1 << 20);
+    auto source = WKVFactory::createSensor("HIP", "arena_source", &arena);
+    source->generateData(100, 0.02, 2);
+    const std::span<const double> source_data = source->getData();
+    const std::vector<double> expected(source_data.begin(), source_data.end());
+
+    auto copy = WKVFactory::createSensor("HIP", "arena_copy");
+    copy->copyFrom(*source);
+    source.reset();
+    arena.reset();
+
+    // Clear the memory of the arena, so a copy still pointing into it reads empty columns
+    std::pmr::vector<double> reused(4 * expected.size(), 0.0, &arena);
+    const std::span<const double> data = copy->getData();
+    return std::equal(data.begin(), data.end(), expected.begin(), expected.end());
+}
+
+/**
+ * @brief Check that a recording whose column offset wraps around 2^64 is rejected, not mapped.
+ */
+bool checkMalformedRecording()
+{
+    const std::string path = "twiice_benchmark_malformed.wkv";
+    auto hip = WKVFactory::createSensor("HIP", "malformed");
+    hip->generateData(100, 0.02, 2);
+    MappedWKV::write(*hip, path);
+
+    // Aligned offset such that offset + column size wraps to a small value inside the file
+    const uint64_t offset = std::numeric_limits<uint64_t>::max() - recording_column_alignment + 1;
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(offsetof(RecordingHeader, timestamps_offset));
+        file.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+    }
+
+    bool rejected = false;
+    try {
+        MappedWKV mapped(path);
+    } catch (const std::runtime_error &) {
+        rejected = true;
+    }
+    std::remove(path.c_str());
+    return rejected;
+}
+
+/**
+ * @brief Check that the Welch spectrum does not depend on the number of workers.
+ */
+bool checkWelchThreadCount()
+{
+    auto hip = WKVFactory::createSensor("HIP", "welch");
+    hip->generateData(100, 0.02, 600);
+    const WKVView window = WKVView::all(*hip);
+
+    PowerSpectrum expected, spectrum;
+    SpectralAnalyzer({256, 0.5, 0.3, 3.0}, 1).welch(window, expected);
+    for (const size_t thread_count : {size_t(3), size_t(8)}) {
+        SpectralAnalyzer({256, 0.5, 0.3, 3.0}, thread_count).welch(window, spectrum);
+        if (spectrum.density != expected.density)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Check that the index sums a short window late in a long series with an offset as
+ * accurately as a scan of the window.
+ */
+bool checkIndexCancellation()
+{
+    constexpr size_t size = size_t(1) << 22;
+    std::vector<double> values(size);
+    std::mt19937_64 random(7);
+    std::uniform_real_distribution<double> noise(-1.0, 1.0);
+    for (double &value : values)
+        value = 1e6 + noise(random);
+
+    const RangeAggregateIndex index(values);
+    const size_t first = size - 1000, last = size - 100;
+    const WindowStatistics indexed = index.query(values, first, last);
+    const WindowStatistics scanned = RangeAggregateIndex::scan(std::span<const double>(values).subspan(first, last - first));
+    return std::abs(indexed.mean - scanned.mean) < 1e-8 && std::abs(indexed.rms - scanned.rms) < 1e-8;
+}
+
+/**
+ * @brief Run the regression checks, reporting the failed ones.
+ */
+bool runChecks()
+{
+    const std::pair<const char *, bool (*)()> checks[] = {
+        {"copy of an arena sensor after reset", checkArenaCopy},
+        {"recording with a wrapping column offset", checkMalformedRecording},
+        {"Welch spectrum on 1, 3 and 8 workers", checkWelchThreadCount},
+        {"index sums late in an offset series", checkIndexCancellation},
+    };
+    bool passed = true;
+    for (const auto &[name, check] : checks) {
+        if (!check()) {
+            std::cerr << "Check failed: " << name << std::endl;
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+bool parseOptions(int argc, char *argv[], BenchmarkOptions &options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--min-samples") == 0 && has_value) {
+            options.min_samples = std::stoull(argv[++i]);
+        } else if (std::strcmp(argv[i], "--max-samples") == 0 && has_value) {
+            options.max_samples = std::stoull(argv[++i]);
+        } else if (std::strcmp(argv[i], "--repeat") == 0 && has_value) {
+            options.repeat = std::max(1, std::stoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--csv") == 0) {
+            options.csv = true;
+        } else if (std::strcmp(argv[i], "--metrics-json") == 0 && has_value) {
+            options.metrics_json = argv[++i];
+        } else if (std::strcmp(argv[i], "--metrics-prom") == 0 && has_value) {
+            options.metrics_prometheus = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--min-samples N] [--max-samples N] [--repeat R] [--csv]"
+                         " [--metrics-json PATH] [--metrics-prom PATH]"
+                      << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    BenchmarkOptions options;
+    if (!parseOptions(argc, argv, options) || !runChecks()) {
+        return -1;
+    }
+
+    printHeader(options.csv);
+    for (size_t samples = options.min_samples; samples <= options.max_samples; samples *= 10) {
+        benchmarkSize(samples, options);
+    }
+
+    if (!options.metrics_json.empty()) {
+        MetricsRegistry::instance().exportJson(options.metrics_json);
+    }
+    if (!options.metrics_prometheus.empty()) {
+        MetricsRegistry::instance().exportPrometheus(options.metrics_prometheus);
+    }
+    return 0;
+}
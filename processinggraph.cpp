@@ -0,0 +1,356 @@
+#include "processinggraph.h"
+#include "wkvview.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// Input samples kept on each side of a resampled tile so the interpolation stencil is never clamped.
+constexpr size_t resample_halo_samples = 4;
+
+} // namespace
+
+size_t ProcessingGraph::TileKeyHash::operator()(const TileKey &key) const
+{
+    return std::hash<size_t>()(key.node * 0x9E3779B97F4A7C15ull ^ key.index);
+}
+
+ProcessingGraph::ProcessingGraph(size_t cache_tiles, size_t tile_samples)
+    : cache_tiles_(cache_tiles)
+    , tile_samples_(tile_samples)
+{
+    if (cache_tiles_ == 0)
+        throw std::invalid_argument("ProcessingGraph: the cache must hold at least one tile");
+    if (tile_samples_ == 0)
+        throw std::invalid_argument("ProcessingGraph: tiles must hold at least one sample");
+}
+
+ProcessingGraph::NodeId ProcessingGraph::addResampling(const IWKV &source,
+                                                       int target_rate,
+                                                       InterpolationMode mode)
+{
+    if (target_rate <= 0)
+        throw std::invalid_argument("ProcessingGraph: target rate must be positive");
+    if (mode == InterpolationMode::CardinalSpline)
+        throw std::invalid_argument("ProcessingGraph: the cardinal spline cannot be tiled, use a "
+                                    "local interpolation");
+    if (mode == InterpolationMode::Polyphase)
+        throw std::invalid_argument("ProcessingGraph: the polyphase filter spans tiles, use a local "
+                                    "interpolation");
+
+    Node resampling{NodeKind::Resampling};
+    resampling.source = &source;
+    resampling.root = nodes_.size();
+    resampling.target_rate = target_rate;
+    resampling.interpolation = mode;
+    return addNode(resampling);
+}
+
+ProcessingGraph::NodeId ProcessingGraph::addSmoothing(NodeId input,
+                                                      int kernel_size,
+                                                      double sigma,
+                                                      SmoothingMode mode)
+{
+    if (node(input).kind == NodeKind::Derivatives)
+        throw std::invalid_argument("ProcessingGraph: only a series can be smoothed");
+    if (kernel_size < 1 || kernel_size % 2 == 0)
+        throw std::invalid_argument("ProcessingGraph: the kernel must have an odd number of taps");
+    if (mode == SmoothingMode::Recursive)
+        throw std::invalid_argument("ProcessingGraph: the recursive filter cannot be tiled, use a "
+                                    "kernel mode");
+
+    Node smoothing{NodeKind::Smoothing};
+    smoothing.input = input;
+    smoothing.root = node(input).root;
+    smoothing.kernel_size = kernel_size;
+    smoothing.sigma = sigma;
+    smoothing.smoother.emplace(kernel_size, sigma);
+    smoothing.smoothing = mode;
+    return addNode(smoothing);
+}
+
+ProcessingGraph::NodeId ProcessingGraph::addDerivatives(NodeId input)
+{
+    if (node(input).kind == NodeKind::Derivatives)
+        throw std::invalid_argument("ProcessingGraph: only a series can be differentiated");
+
+    Node derivatives{NodeKind::Derivatives};
+    derivatives.input = input;
+    derivatives.root = node(input).root;
+    return addNode(derivatives);
+}
+
+void ProcessingGraph::evaluate(NodeId id,
+                               double start_time_s,
+                               double end_time_s,
+                               std::vector<uint64_t> &timestamps_us,
+                               std::vector<double> &values)
+{
+    if (node(id).kind == NodeKind::Derivatives)
+        throw std::invalid_argument("ProcessingGraph: evaluate a derivatives node into a DerivativeSeries");
+
+    const auto [first, last] = indexRange(id, start_time_s, end_time_s);
+    const Grid &g = grid(id);
+    timestamps_us.resize(last - first);
+    values.resize(last - first);
+    for (size_t k = first; k < last; ++k)
+        timestamps_us[k - first] = g.start_us + k * g.step_us;
+    const std::span<double> columns[] = {values};
+    read(id, first, last, columns);
+}
+
+void ProcessingGraph::evaluate(NodeId id,
+                               double start_time_s,
+                               double end_time_s,
+                               DerivativeSeries &derivatives)
+{
+    if (node(id).kind != NodeKind::Derivatives)
+        throw std::invalid_argument("ProcessingGraph: only a derivatives node fills a DerivativeSeries");
+
+    const auto [first, last] = indexRange(id, start_time_s, end_time_s);
+    const Grid &g = grid(id);
+    derivatives.timestamps_us.resize(last - first);
+    derivatives.velocities.resize(last - first);
+    derivatives.accelerations.resize(last - first);
+    for (size_t k = first; k < last; ++k)
+        derivatives.timestamps_us[k - first] = g.start_us + k * g.step_us;
+    // Both columns of a tile are copied together, so a window larger than the cache does not
+    // evaluate its tiles twice
+    const std::span<double> columns[] = {derivatives.velocities, derivatives.accelerations};
+    read(id, first, last, columns);
+}
+
+void ProcessingGraph::invalidate()
+{
+    tiles_.clear();
+    index_.clear();
+    std::fill(grids_.begin(), grids_.end(), std::nullopt);
+}
+
+size_t ProcessingGraph::cachedTiles() const
+{
+    return tiles_.size();
+}
+
+ProcessingGraphStats ProcessingGraph::stats() const
+{
+    return stats_;
+}
+
+void ProcessingGraph::resetStats()
+{
+    stats_ = ProcessingGraphStats();
+}
+
+const ProcessingGraph::Node &ProcessingGraph::node(NodeId id) const
+{
+    if (id >= nodes_.size())
+        throw std::out_of_range("ProcessingGraph: unknown node");
+    return nodes_[id];
+}
+
+ProcessingGraph::NodeId ProcessingGraph::addNode(const Node &node)
+{
+    nodes_.push_back(node);
+    grids_.emplace_back();
+    return nodes_.size() - 1;
+}
+
+/**
+ * @brief Get the grid of the resampling node a node lives on, from the first sample of the sensor
+ * to its last.
+ */
+const ProcessingGraph::Grid &ProcessingGraph::grid(NodeId id)
+{
+    const NodeId root = node(id).root;
+    std::optional<Grid> &g = grids_[root];
+    if (!g) {
+        const Node &resampling = nodes_[root];
+        const std::span<const uint64_t> timestamps = resampling.source->getTimestampsUs();
+        g.emplace();
+        g->step_us = static_cast<uint64_t>(std::llround(1e6 / resampling.target_rate));
+        if (!timestamps.empty()) {
+            g->start_us = timestamps.front();
+            g->size = LocalResampler::outputSize(timestamps, timestamps.front(), timestamps.back(), g->step_us);
+        }
+    }
+    return *g;
+}
+
+/**
+ * @brief Get the grid indices a node is defined at: the whole grid, less one sample on each side
+ * per derivatives node on the way.
+ */
+std::pair<size_t, size_t> ProcessingGraph::domain(NodeId id)
+{
+    const Node &n = node(id);
+    switch (n.kind) {
+    case NodeKind::Resampling:
+        return {0, grid(id).size};
+    case NodeKind::Smoothing:
+        return domain(n.input);
+    case NodeKind::Derivatives:
+        break;
+    }
+    const auto [first, last] = domain(n.input);
+    if (last - first < 3)
+        return {first, first};
+    return {first + 1, last - 1};
+}
+
+/**
+ * @brief Get the number of input samples a node needs on each side of an output sample.
+ */
+size_t ProcessingGraph::halo(NodeId id) const
+{
+    const Node &n = node(id);
+    switch (n.kind) {
+    case NodeKind::Smoothing:
+        return static_cast<size_t>(n.kernel_size / 2);
+    case NodeKind::Derivatives:
+        return 1;
+    case NodeKind::Resampling:
+        break;
+    }
+    return 0;
+}
+
+size_t ProcessingGraph::columnCount(NodeId id) const
+{
+    return node(id).kind == NodeKind::Derivatives ? 2 : 1;
+}
+
+/**
+ * @brief Get the grid indices of a node within [start_time_s, end_time_s] of its sensor.
+ */
+std::pair<size_t, size_t> ProcessingGraph::indexRange(NodeId id, double start_time_s, double end_time_s)
+{
+    const auto [domain_first, domain_last] = domain(id);
+    const Grid &g = grid(id);
+    if (end_time_s < start_time_s)
+        return {domain_first, domain_first};
+
+    const uint64_t sensor_start_us = nodes_[node(id).root].source->getStartTimeUs();
+    const uint64_t start_time_us = sensor_start_us + static_cast<uint64_t>(start_time_s * 1e6);
+    const uint64_t end_time_us = sensor_start_us + static_cast<uint64_t>(end_time_s * 1e6);
+    if (end_time_us < g.start_us)
+        return {domain_first, domain_first};
+
+    size_t first = start_time_us <= g.start_us ? 0 : (start_time_us - g.start_us + g.step_us - 1) / g.step_us;
+    size_t last = (end_time_us - g.start_us) / g.step_us + 1;
+    first = std::clamp(first, domain_first, domain_last);
+    last = std::clamp(last, first, domain_last);
+    return {first, last};
+}
+
+/**
+ * @brief Get a tile of a node, from the cache or evaluated and cached.
+ *
+ * The reference is valid until the next call, which may evict the tile.
+ */
+const std::vector<double> &ProcessingGraph::tile(NodeId id, size_t index)
+{
+    const TileKey key{id, index};
+    if (const auto found = index_.find(key); found != index_.end()) {
+        ++stats_.tiles_reused;
+        tiles_.splice(tiles_.begin(), tiles_, found->second);
+        return found->second->values;
+    }
+
+    const auto [domain_first, domain_last] = domain(id);
+    const size_t first = std::max(domain_first, index * tile_samples_);
+    const size_t last = std::min(domain_last, (index + 1) * tile_samples_);
+    std::vector<double> values = computeTile(id, first, last);
+    ++stats_.tiles_computed;
+    stats_.samples_computed += last - first;
+
+    tiles_.push_front({key, std::move(values)});
+    index_[key] = tiles_.begin();
+    while (tiles_.size() > cache_tiles_) {
+        index_.erase(tiles_.back().key);
+        tiles_.pop_back();
+    }
+    return tiles_.front().values;
+}
+
+/**
+ * @brief Copy the columns of a node over the grid indices [first, last), one output per column.
+ */
+void ProcessingGraph::read(NodeId id, size_t first, size_t last, std::span<const std::span<double>> columns)
+{
+    if (first >= last)
+        return;
+    const size_t domain_first = domain(id).first;
+    const size_t column_count = columnCount(id);
+    for (size_t index = first / tile_samples_; index <= (last - 1) / tile_samples_; ++index) {
+        const std::vector<double> &tile_values = tile(id, index);
+        const size_t tile_first = std::max(domain_first, index * tile_samples_);
+        const size_t tile_size = tile_values.size() / column_count;
+        const size_t copy_first = std::max(first, tile_first);
+        const size_t copy_last = std::min(last, tile_first + tile_size);
+        for (size_t column = 0; column < columns.size(); ++column) {
+            std::copy(tile_values.begin() + column * tile_size + (copy_first - tile_first),
+                      tile_values.begin() + column * tile_size + (copy_last - tile_first),
+                      columns[column].begin() + (copy_first - first));
+        }
+    }
+}
+
+/**
+ * @brief Evaluate a node over the grid indices [first, last) of its domain.
+ *
+ * The input is read over the range widened by the halo of the node, clamped to the domain of the
+ * input, so the samples of the range see the same neighbours as in a single pass.
+ */
+std::vector<double> ProcessingGraph::computeTile(NodeId id, size_t first, size_t last)
+{
+    const Node &n = node(id);
+    const Grid &g = grid(id);
+    const size_t count = last - first;
+
+    if (n.kind == NodeKind::Resampling) {
+        const uint64_t start_us = g.start_us + first * g.step_us;
+        const uint64_t end_us = g.start_us + (last - 1) * g.step_us;
+        const WKVView input = WKVView::windowUs(*n.source, start_us, end_us)
+                                  .widened(resample_halo_samples, resample_halo_samples);
+        std::vector<uint64_t> timestamps(count);
+        std::vector<double> values(count);
+        if (LocalResampler(n.interpolation).resample(input, start_us, end_us, g.step_us, timestamps, values)
+            != count) {
+            throw std::runtime_error("ProcessingGraph: tile does not cover its resampling grid");
+        }
+        return values;
+    }
+
+    const auto [input_domain_first, input_domain_last] = domain(n.input);
+    const size_t input_first = std::max(input_domain_first, first - std::min(first, halo(id)));
+    const size_t input_last = std::min(input_domain_last, last + halo(id));
+    std::vector<double> input_values(input_last - input_first);
+    const std::span<double> input_columns[] = {input_values};
+    read(n.input, input_first, input_last, input_columns);
+    const size_t offset = first - input_first;
+
+    std::vector<double> values;
+    if (n.kind == NodeKind::Smoothing) {
+        std::vector<double> smoothed(input_values.size());
+        n.smoother->smooth(input_values, smoothed, n.smoothing);
+        values.assign(smoothed.begin() + offset, smoothed.begin() + offset + count);
+        return values;
+    }
+
+    // Derivative k of the input range is taken at its sample k + 1
+    std::vector<uint64_t> input_timestamps(input_last - input_first);
+    for (size_t k = input_first; k < input_last; ++k)
+        input_timestamps[k - input_first] = g.start_us + k * g.step_us;
+    DerivativeSeries derivatives;
+    DerivativeEngine::compute(input_timestamps, input_values, derivatives);
+    values.reserve(2 * count);
+    values.insert(values.end(),
+                  derivatives.velocities.begin() + offset - 1,
+                  derivatives.velocities.begin() + offset - 1 + count);
+    values.insert(values.end(),
+                  derivatives.accelerations.begin() + offset - 1,
+                  derivatives.accelerations.begin() + offset - 1 + count);
+    return values;
+}
@@ -0,0 +1,184 @@
+#ifndef PROCESSINGGRAPH_H
+#define PROCESSINGGRAPH_H
+
+#include "derivativeengine.h"
+#include "gaussiansmoother.h"
+#include "iwkv.h"
+#include "localresampler.h"
+#include <list>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Work done by a ProcessingGraph, to check what an evaluation recomputed.
+ */
+struct ProcessingGraphStats
+{
+    size_t tiles_computed = 0;   ///< Tiles evaluated, over every node.
+    size_t tiles_reused = 0;     ///< Tiles served from the cache.
+    size_t samples_computed = 0; ///< Output samples of the evaluated tiles.
+};
+
+/**
+ * @brief The ProcessingGraph class evaluates a declared processing chain lazily, over the time
+ * range that is asked for.
+ *
+ * Nodes are declared once (a resampling of a sensor, then smoothing and derivatives of earlier
+ * nodes) and evaluate() computes a node over a window. Every node lives on the resampling grid of
+ * its root, anchored at the first sample of the sensor, so a window maps to a range of grid
+ * indices whatever its position. The grid is cut into fixed tiles: a node computes a tile from
+ * the input range it needs, i.e. the tile widened by its filter halo (half the kernel for the
+ * smoothing, one sample for the derivatives), which in turn only evaluates the input tiles that
+ * range overlaps.
+ *
+ * Tiles are memoised per (node, tile) in a cache bounded to a number of tiles, evicting the least
+ * recently used. Panning or extending a window therefore only computes the tiles it newly exposes.
+ * Thanks to the halos, a tile equals the same samples of a single pass over the whole recording.
+ *
+ * A graph is not thread-safe. Call invalidate() after modifying a source sensor.
+ */
+class ProcessingGraph
+{
+public:
+    using NodeId = size_t;
+
+    /**
+     * @brief Construct an empty graph.
+     *
+     * @param cache_tiles Maximum number of tiles kept, over every node.
+     * @param tile_samples Grid samples per tile.
+     * @throws std::invalid_argument if either is zero.
+     */
+    explicit ProcessingGraph(size_t cache_tiles = 256, size_t tile_samples = 4096);
+
+    /**
+     * @brief Add a resampling of a sensor at target_rate, on a grid starting at its first sample.
+     *
+     * @param source The sensor, which must outlive the graph.
+     * @throws std::invalid_argument if the rate is not positive or the interpolation is the
+     * cardinal spline, which is global to the window and cannot be tiled, or the polyphase filter.
+     */
+    NodeId addResampling(const IWKV &source,
+                         int target_rate,
+                         InterpolationMode mode = InterpolationMode::Cubic);
+
+    /**
+     * @brief Add a Gaussian smoothing of a node.
+     *
+     * @throws std::invalid_argument if the input is not a resampling or smoothing node, the kernel
+     * size is even or not positive, or the mode is the recursive filter, whose response is not
+     * bounded by the kernel.
+     */
+    NodeId addSmoothing(NodeId input,
+                        int kernel_size,
+                        double sigma,
+                        SmoothingMode mode = SmoothingMode::Fir);
+
+    /**
+     * @brief Add the velocity and acceleration of a node, defined at its interior samples.
+     *
+     * @throws std::invalid_argument if the input is not a resampling or smoothing node.
+     */
+    NodeId addDerivatives(NodeId input);
+
+    /**
+     * @brief Evaluate a resampling or smoothing node over [start_time_s, end_time_s], relative
+     * to the start time of its sensor.
+     *
+     * @param timestamps_us Output, the grid instants in the window.
+     * @param values Output, the values of the node at those instants.
+     * @throws std::invalid_argument if the node is a derivatives node.
+     * @throws std::out_of_range if the node does not exist.
+     */
+    void evaluate(NodeId node,
+                  double start_time_s,
+                  double end_time_s,
+                  std::vector<uint64_t> &timestamps_us,
+                  std::vector<double> &values);
+
+    /**
+     * @brief Evaluate a derivatives node over [start_time_s, end_time_s], relative to the start
+     * time of its sensor.
+     *
+     * @throws std::invalid_argument if the node is not a derivatives node.
+     * @throws std::out_of_range if the node does not exist.
+     */
+    void evaluate(NodeId node, double start_time_s, double end_time_s, DerivativeSeries &derivatives);
+
+    /**
+     * @brief Drop every cached tile and grid, to be called when a source sensor changed.
+     */
+    void invalidate();
+
+    size_t cachedTiles() const;
+    ProcessingGraphStats stats() const;
+    void resetStats();
+
+private:
+    enum class NodeKind { Resampling, Smoothing, Derivatives };
+
+    struct Node
+    {
+        NodeKind kind;
+        const IWKV *source = nullptr; ///< Sensor, resampling nodes only.
+        NodeId input = 0;             ///< Input node, other nodes.
+        NodeId root = 0;              ///< Resampling node whose grid the node lives on.
+        int target_rate = 0;
+        InterpolationMode interpolation = InterpolationMode::Cubic;
+        int kernel_size = 0;
+        double sigma = 0.0;
+        SmoothingMode smoothing = SmoothingMode::Fir;
+        std::optional<GaussianSmoother> smoother; ///< Smoother of the kernel, smoothing nodes only.
+    };
+
+    /// Resampling grid of a root node: start_us + k * step_us for k in [0, size).
+    struct Grid
+    {
+        uint64_t start_us = 0;
+        uint64_t step_us = 1;
+        size_t size = 0;
+    };
+
+    struct TileKey
+    {
+        NodeId node;
+        size_t index;
+
+        bool operator==(const TileKey &other) const = default;
+    };
+
+    struct TileKeyHash
+    {
+        size_t operator()(const TileKey &key) const;
+    };
+
+    /// Evaluated tile: the columns of the node (one, or velocity then acceleration) back to back.
+    struct Tile
+    {
+        TileKey key;
+        std::vector<double> values;
+    };
+
+    size_t cache_tiles_;                       ///< Maximum number of tiles in tiles_.
+    size_t tile_samples_;                      ///< Grid samples per tile.
+    std::vector<Node> nodes_;                  ///< Nodes, inputs before the nodes using them.
+    std::vector<std::optional<Grid>> grids_;   ///< Grid of every root node, computed on first use.
+    std::list<Tile> tiles_;                    ///< Cached tiles, most recently used first.
+    std::unordered_map<TileKey, std::list<Tile>::iterator, TileKeyHash> index_; ///< Tiles by key.
+    ProcessingGraphStats stats_;               ///< Work done since construction or resetStats().
+
+    const Node &node(NodeId id) const;
+    NodeId addNode(const Node &node);
+    const Grid &grid(NodeId id);
+    std::pair<size_t, size_t> domain(NodeId id);
+    size_t halo(NodeId id) const;
+    size_t columnCount(NodeId id) const;
+    std::pair<size_t, size_t> indexRange(NodeId id, double start_time_s, double end_time_s);
+    const std::vector<double> &tile(NodeId id, size_t index);
+    void read(NodeId id, size_t first, size_t last, std::span<const std::span<double>> columns);
+    std::vector<double> computeTile(NodeId id, size_t first, size_t last);
+};
+
+#endif // PROCESSINGGRAPH_H
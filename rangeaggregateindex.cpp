@@ -0,0 +1,239 @@
+#include "rangeaggregateindex.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+/**
+ * @brief Running totals of a window, turned into its statistics at the end.
+ */
+struct Totals
+{
+    size_t count = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    double sum = 0.0;
+    double squares = 0.0;
+
+    void add(std::span<const double> values)
+    {
+        for (const double value : values) {
+            min = std::min(min, value);
+            max = std::max(max, value);
+            sum += value;
+            squares += value * value;
+        }
+        count += values.size();
+    }
+
+    WindowStatistics statistics() const
+    {
+        if (count == 0) {
+            const double nan = std::numeric_limits<double>::quiet_NaN();
+            return {0, nan, nan, 0.0, nan, nan};
+        }
+        // The difference of prefix sums can be a rounding error below zero
+        return {count, min, max, sum, sum / count, std::sqrt(std::max(squares, 0.0) / count)};
+    }
+};
+
+} // namespace
+
+/**
+ * @brief Add a value, keeping the rounding error of the addition exactly in the compensation.
+ */
+void RangeAggregateIndex::CompensatedSum::add(double value)
+{
+    const double total = sum + value;
+    if (std::abs(sum) >= std::abs(value)) {
+        compensation += (sum - total) + value;
+    } else {
+        compensation += (value - total) + sum;
+    }
+    sum = total;
+}
+
+/**
+ * @brief Get the sum of the values added after other, a prefix of this sum.
+ */
+double RangeAggregateIndex::CompensatedSum::minus(const CompensatedSum &other) const
+{
+    return (sum - other.sum) + (compensation - other.compensation);
+}
+
+RangeAggregateIndex::RangeAggregateIndex()
+    : prefix_sums_(1)
+    , prefix_squares_(1)
+    , levels_(1)
+{}
+
+RangeAggregateIndex::RangeAggregateIndex(std::span<const double> values)
+{
+    assign(values);
+}
+
+/**
+ * @brief Build the index of a whole series, a block at a time.
+ *
+ * The samples are added to the running sums in the order append() uses, so both give the same
+ * index.
+ */
+void RangeAggregateIndex::assign(std::span<const double> values)
+{
+    size_ = values.size();
+    const size_t block_count = (size_ + fan_out - 1) / fan_out;
+    prefix_sums_.assign(1, {});
+    prefix_squares_.assign(1, {});
+    prefix_sums_.reserve(block_count + 1);
+    prefix_squares_.reserve(block_count + 1);
+    levels_.assign(1, {});
+    levels_[0].reserve(block_count);
+    total_sum_ = {};
+    total_squares_ = {};
+
+    for (size_t first = 0; first < size_; first += fan_out) {
+        const std::span<const double> block = values.subspan(first, std::min(fan_out, size_ - first));
+        Extrema extrema{block[0], block[0]};
+        for (const double value : block) {
+            extrema.min = std::min(extrema.min, value);
+            extrema.max = std::max(extrema.max, value);
+            total_sum_.add(value);
+            total_squares_.add(value * value);
+        }
+        prefix_sums_.push_back(total_sum_);
+        prefix_squares_.push_back(total_squares_);
+        levels_[0].push_back(extrema);
+    }
+
+    while (levels_.back().size() > 1) {
+        const std::vector<Extrema> &below = levels_.back();
+        std::vector<Extrema> level;
+        level.reserve((below.size() + fan_out - 1) / fan_out);
+        for (size_t first = 0; first < below.size(); first += fan_out) {
+            const size_t last = std::min(first + fan_out, below.size());
+            Extrema extrema = below[first];
+            for (size_t i = first + 1; i < last; ++i) {
+                extrema.min = std::min(extrema.min, below[i].min);
+                extrema.max = std::max(extrema.max, below[i].max);
+            }
+            level.push_back(extrema);
+        }
+        levels_.push_back(std::move(level));
+    }
+}
+
+/**
+ * @brief Add a sample to the last block and to the pyramid entries covering it.
+ *
+ * A level is added on top when the current top gets its second entry.
+ */
+void RangeAggregateIndex::append(double value)
+{
+    const size_t index = size_++;
+    if (index % fan_out == 0) {
+        prefix_sums_.emplace_back();
+        prefix_squares_.emplace_back();
+    }
+    total_sum_.add(value);
+    total_squares_.add(value * value);
+    prefix_sums_.back() = total_sum_;
+    prefix_squares_.back() = total_squares_;
+
+    size_t entry = index;
+    for (size_t level = 0;; ++level) {
+        entry /= fan_out;
+        if (level == levels_.size()) {
+            levels_.push_back({levels_[level - 1].front()});
+        }
+        std::vector<Extrema> &entries = levels_[level];
+        if (entry == entries.size()) {
+            entries.push_back({value, value});
+        } else {
+            entries[entry].min = std::min(entries[entry].min, value);
+            entries[entry].max = std::max(entries[entry].max, value);
+        }
+        if (entries.size() == 1) {
+            break;
+        }
+    }
+}
+
+void RangeAggregateIndex::append(std::span<const double> values)
+{
+    for (const double value : values) {
+        append(value);
+    }
+}
+
+size_t RangeAggregateIndex::size() const
+{
+    return size_;
+}
+
+/**
+ * @brief Get the statistics of a range from the index, scanning only its partial edge blocks.
+ */
+WindowStatistics RangeAggregateIndex::query(std::span<const double> values, size_t first, size_t last) const
+{
+    if (values.size() != size_) {
+        throw std::invalid_argument("RangeAggregateIndex: the series does not match the index");
+    }
+    if (first > last || last > size_) {
+        throw std::out_of_range("RangeAggregateIndex: range outside of the series");
+    }
+
+    Totals totals;
+    const size_t first_block = (first + fan_out - 1) / fan_out;
+    const size_t last_block = last / fan_out;
+    if (first_block >= last_block) {
+        totals.add(values.subspan(first, last - first));
+        return totals.statistics();
+    }
+
+    totals.add(values.subspan(first, first_block * fan_out - first));
+    totals.add(values.subspan(last_block * fan_out, last - last_block * fan_out));
+    totals.count += (last_block - first_block) * fan_out;
+    totals.sum += prefix_sums_[last_block].minus(prefix_sums_[first_block]);
+    totals.squares += prefix_squares_[last_block].minus(prefix_squares_[first_block]);
+    Extrema blocks{totals.min, totals.max};
+    extrema(0, first_block, last_block, blocks);
+    totals.min = blocks.min;
+    totals.max = blocks.max;
+    return totals.statistics();
+}
+
+WindowStatistics RangeAggregateIndex::scan(std::span<const double> values)
+{
+    Totals totals;
+    totals.add(values);
+    return totals.statistics();
+}
+
+/**
+ * @brief Merge the extrema of the entries [first, last) of a level into result.
+ *
+ * The entries of the level above covered entirely by the range are taken from that level, so
+ * only the edges are scanned here.
+ */
+void RangeAggregateIndex::extrema(size_t level, size_t first, size_t last, Extrema &result) const
+{
+    const std::vector<Extrema> &entries = levels_[level];
+    const size_t inner_first = (first + fan_out - 1) / fan_out;
+    const size_t inner_last = last / fan_out;
+    const auto merge = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            result.min = std::min(result.min, entries[i].min);
+            result.max = std::max(result.max, entries[i].max);
+        }
+    };
+
+    if (inner_first >= inner_last || level + 1 == levels_.size()) {
+        merge(first, last);
+        return;
+    }
+    merge(first, inner_first * fan_out);
+    merge(inner_last * fan_out, last);
+    extrema(level + 1, inner_first, inner_last, result);
+}
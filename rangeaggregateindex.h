@@ -0,0 +1,115 @@
+#ifndef RANGEAGGREGATEINDEX_H
+#define RANGEAGGREGATEINDEX_H
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+/**
+ * @brief Statistics of the samples of a window.
+ *
+ * The extrema, mean and RMS of an empty window are NaN.
+ */
+struct WindowStatistics
+{
+    size_t count = 0;  ///< Number of samples in the window.
+    double min = 0.0;  ///< Smallest value.
+    double max = 0.0;  ///< Largest value.
+    double sum = 0.0;  ///< Sum of the values.
+    double mean = 0.0; ///< Mean of the values.
+    double rms = 0.0;  ///< Root mean square of the values.
+};
+
+/**
+ * @brief The RangeAggregateIndex class answers min/max/sum/mean/RMS queries over any index range
+ * of a series in O(log n), instead of scanning the range.
+ *
+ * The series is cut into blocks of fan_out samples. Sums come from prefix sums of the values and
+ * of their squares at every block boundary, extrema from a pyramid whose level 0 holds the
+ * extrema of every block and level l + 1 those of fan_out consecutive entries of level l. A query
+ * scans the partial blocks at both edges of the range, at most 2 * fan_out samples, then walks up
+ * the pyramid scanning at most 2 * fan_out entries per level.
+ *
+ * The prefix sums are compensated (Neumaier): each keeps the rounding error of its running total
+ * next to it. A range sum is a difference of two prefixes that can be far larger than the range,
+ * e.g. a window late in a long recording with an offset, and plain prefixes would lose the low
+ * digits of the range to the rounding of the prefixes.
+ *
+ * The index does not keep the samples, queries are given the series it was built on. Appending a
+ * sample updates one prefix sum and one entry per level, so the index follows a growing series.
+ * It takes about 0.75 byte per sample.
+ */
+class RangeAggregateIndex
+{
+public:
+    static constexpr size_t fan_out = 64; ///< Samples per block and entries per pyramid entry.
+
+    RangeAggregateIndex();
+
+    /**
+     * @brief Construct the index of a series.
+     */
+    explicit RangeAggregateIndex(std::span<const double> values);
+
+    /**
+     * @brief Rebuild the index for another series.
+     */
+    void assign(std::span<const double> values);
+
+    /**
+     * @brief Update the index with a sample appended to the series.
+     */
+    void append(double value);
+
+    /**
+     * @brief Update the index with samples appended to the series.
+     */
+    void append(std::span<const double> values);
+
+    /**
+     * @brief Get the number of samples indexed.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Get the statistics of the samples [first, last) of the indexed series.
+     *
+     * @param values The series the index was built on.
+     * @throws std::invalid_argument if values does not have the size of the index.
+     * @throws std::out_of_range if the range is not within the series.
+     */
+    WindowStatistics query(std::span<const double> values, size_t first, size_t last) const;
+
+    /**
+     * @brief Get the statistics of values with a linear scan, without an index.
+     */
+    static WindowStatistics scan(std::span<const double> values);
+
+private:
+    struct Extrema
+    {
+        double min;
+        double max;
+    };
+
+    /// Running sum and the rounding error of its additions, the sum being their total.
+    struct CompensatedSum
+    {
+        double sum = 0.0;
+        double compensation = 0.0;
+
+        void add(double value);
+        double minus(const CompensatedSum &other) const;
+    };
+
+    size_t size_ = 0;                          ///< Samples indexed.
+    std::vector<CompensatedSum> prefix_sums_;  ///< Sum of the samples before every block, then the total.
+    std::vector<CompensatedSum> prefix_squares_; ///< Same for the squares of the samples.
+    CompensatedSum total_sum_;                 ///< Sum of every sample indexed.
+    CompensatedSum total_squares_;             ///< Sum of their squares.
+    std::vector<std::vector<Extrema>> levels_; ///< Extrema pyramid, blocks first.
+
+    void extrema(size_t level, size_t first, size_t last, Extrema &result) const;
+};
+
+#endif // RANGEAGGREGATEINDEX_H
@@ -0,0 +1,173 @@
+#include "realfft.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <mutex>
+#include <numbers>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+using Complex = std::complex<double>;
+
+/**
+ * @brief Complex product without the NaN/infinity recovery of operator*, which keeps the
+ * butterflies inlined.
+ */
+Complex multiply(Complex a, Complex b)
+{
+    return {a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real()};
+}
+
+} // namespace
+
+RealFft::RealFft(size_t size)
+    : size_(size)
+{
+    if (size < 2 || !std::has_single_bit(size)) {
+        throw std::invalid_argument("RealFft: the size must be a power of two of at least 2, not "
+                                    + std::to_string(size) + ".");
+    }
+    const size_t half = size / 2;
+    const int bits = std::countr_zero(half);
+    bit_reverse_.resize(half);
+    for (size_t i = 1; i < half; ++i) {
+        bit_reverse_[i] = static_cast<uint32_t>((bit_reverse_[i >> 1] >> 1) | ((i & 1) << (bits - 1)));
+    }
+    twiddles_.resize(half / 2);
+    for (size_t k = 0; k < twiddles_.size(); ++k) {
+        twiddles_[k] = std::polar(1.0, -2.0 * std::numbers::pi * k / half);
+    }
+    split_.resize(half / 2 + 1);
+    for (size_t k = 0; k < split_.size(); ++k) {
+        split_[k] = std::polar(1.0, -2.0 * std::numbers::pi * k / size);
+    }
+}
+
+std::shared_ptr<const RealFft> RealFft::plan(size_t size)
+{
+    static std::mutex mutex;
+    static std::unordered_map<size_t, std::shared_ptr<const RealFft>> plans;
+
+    const std::lock_guard<std::mutex> lock(mutex);
+    const auto found = plans.find(size);
+    if (found != plans.end()) {
+        return found->second;
+    }
+    auto plan = std::make_shared<const RealFft>(size);
+    plans.emplace(size, plan);
+    return plan;
+}
+
+size_t RealFft::paddedSize(size_t size)
+{
+    return std::max<size_t>(std::bit_ceil(size), 2);
+}
+
+size_t RealFft::size() const
+{
+    return size_;
+}
+
+size_t RealFft::scratchSize() const
+{
+    return size_ / 2;
+}
+
+/**
+ * @brief In-place forward FFT of the n / 2 complex samples, radix-2 decimation in time.
+ */
+void RealFft::transform(Complex *data) const
+{
+    const size_t half = size_ / 2;
+    for (size_t i = 0; i < half; ++i) {
+        if (i < bit_reverse_[i]) {
+            std::swap(data[i], data[bit_reverse_[i]]);
+        }
+    }
+    for (size_t length = 2; length <= half; length *= 2) {
+        const size_t stride = half / length;
+        for (size_t start = 0; start < half; start += length) {
+            for (size_t k = 0; k < length / 2; ++k) {
+                Complex &a = data[start + k];
+                Complex &b = data[start + k + length / 2];
+                const Complex t = multiply(twiddles_[k * stride], b);
+                b = a - t;
+                a += t;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Transform the samples as n / 2 complex ones, then separate the transforms of the even
+ * and odd samples to combine them into the spectrum, in place.
+ */
+void RealFft::forward(std::span<const double> input, std::span<Complex> spectrum) const
+{
+    const size_t half = size_ / 2;
+    if (input.size() != size_ || spectrum.size() != half + 1) {
+        throw std::invalid_argument("RealFft: the buffers do not match the plan size "
+                                    + std::to_string(size_) + ".");
+    }
+
+    Complex *z = spectrum.data();
+    for (size_t j = 0; j < half; ++j) {
+        z[j] = {input[2 * j], input[2 * j + 1]};
+    }
+    transform(z);
+
+    const Complex z0 = z[0];
+    z[0] = {z0.real() + z0.imag(), 0.0};
+    z[half] = {z0.real() - z0.imag(), 0.0};
+    // Bins k and n / 2 - k come from the same two complex bins
+    for (size_t k = 1; k <= half / 2; ++k) {
+        const Complex a = z[k];
+        const Complex b = std::conj(z[half - k]);
+        const Complex even = (a + b) * 0.5;
+        const Complex odd = multiply(a - b, Complex(0.0, -0.5));
+        const Complex rotated = multiply(split_[k], odd);
+        z[k] = even + rotated;
+        z[half - k] = std::conj(even - rotated);
+    }
+}
+
+/**
+ * @brief Rebuild the transform of the n / 2 complex samples from the spectrum in the scratch
+ * buffer and invert it there: the complex samples are the interleaved real ones.
+ */
+void RealFft::inverse(std::span<const Complex> spectrum,
+                      std::span<double> output,
+                      std::span<Complex> scratch) const
+{
+    const size_t half = size_ / 2;
+    if (output.size() != size_ || spectrum.size() != half + 1 || scratch.size() != half) {
+        throw std::invalid_argument("RealFft: the buffers do not match the plan size "
+                                    + std::to_string(size_) + ".");
+    }
+
+    Complex *z = scratch.data();
+    const double first = spectrum[0].real(), last = spectrum[half].real();
+    z[0] = {(first + last) * 0.5, (first - last) * 0.5};
+    for (size_t k = 1; k <= half / 2; ++k) {
+        const Complex a = spectrum[k];
+        const Complex b = std::conj(spectrum[half - k]);
+        const Complex even = (a + b) * 0.5;
+        const Complex odd = multiply((a - b) * 0.5, std::conj(split_[k]));
+        z[k] = even + Complex(-odd.imag(), odd.real());
+        z[half - k] = std::conj(even) + Complex(odd.imag(), odd.real());
+    }
+
+    // Inverse transform as the conjugate of the forward transform of the conjugate
+    for (size_t j = 0; j < half; ++j) {
+        z[j] = std::conj(z[j]);
+    }
+    transform(z);
+    const double scale = 1.0 / half;
+    for (size_t j = 0; j < half; ++j) {
+        output[2 * j] = z[j].real() * scale;
+        output[2 * j + 1] = -z[j].imag() * scale;
+    }
+}
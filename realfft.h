@@ -0,0 +1,84 @@
+#ifndef REALFFT_H
+#define REALFFT_H
+
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+/**
+ * @brief The RealFft class is a plan for the discrete Fourier transform of real series of a
+ * given power-of-two size.
+ *
+ * A real series of size n is transformed as a complex series of size n / 2 (even samples as real
+ * parts, odd samples as imaginary parts) by an iterative radix-2 FFT, then split into the
+ * n / 2 + 1 bins of the real spectrum, which halves the work of a complex FFT. The bit-reversal
+ * permutation and the twiddle factors are computed once per plan; plan() keeps the plans of every
+ * size used, so repeated transforms of the same size do not recompute them.
+ *
+ * The transforms do not allocate: forward() works in its output, inverse() in a scratch buffer
+ * of the caller. A plan is immutable and can be shared between threads.
+ */
+class RealFft
+{
+public:
+    /**
+     * @brief Construct the plan of a size.
+     *
+     * @param size Number of real samples, a power of two of at least 2.
+     * @throws std::invalid_argument if size is not such a power of two.
+     */
+    explicit RealFft(size_t size);
+
+    /**
+     * @brief Get the plan of a size, computed on first use and then shared. Thread-safe.
+     *
+     * @throws std::invalid_argument if size is not a power of two of at least 2.
+     */
+    static std::shared_ptr<const RealFft> plan(size_t size);
+
+    /**
+     * @brief Get the smallest power of two of at least 2 that is >= size.
+     */
+    static size_t paddedSize(size_t size);
+
+    size_t size() const;
+
+    /**
+     * @brief Get the spectrum X[k] = sum_j x[j] e^(-2 pi i j k / n) for k in [0, n / 2].
+     *
+     * @param input The n real samples.
+     * @param spectrum Output, n / 2 + 1 bins.
+     * @throws std::invalid_argument if the sizes do not match the plan.
+     */
+    void forward(std::span<const double> input, std::span<std::complex<double>> spectrum) const;
+
+    /**
+     * @brief Get the real series of a spectrum, the inverse of forward() including the 1 / n scale.
+     *
+     * @param spectrum The n / 2 + 1 bins of a real series.
+     * @param output Output, n real samples.
+     * @param scratch Working memory of scratchSize() complex samples, owned by the caller so the
+     * plan stays shareable.
+     * @throws std::invalid_argument if the sizes do not match the plan.
+     */
+    void inverse(std::span<const std::complex<double>> spectrum,
+                 std::span<double> output,
+                 std::span<std::complex<double>> scratch) const;
+
+    /**
+     * @brief Get the number of complex samples of the scratch buffer of inverse(), n / 2.
+     */
+    size_t scratchSize() const;
+
+private:
+    size_t size_;                                 ///< Number of real samples.
+    std::vector<uint32_t> bit_reverse_;           ///< Permutation of the n / 2 complex samples.
+    std::vector<std::complex<double>> twiddles_;  ///< e^(-2 pi i k / (n / 2)) for k < n / 4.
+    std::vector<std::complex<double>> split_;     ///< e^(-2 pi i k / n) for k <= n / 4.
+
+    void transform(std::complex<double> *data) const;
+};
+
+#endif // REALFFT_H
@@ -0,0 +1,191 @@
+#include "ringwkv.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+RingWKV::RingWKV(const std::string &name, const std::string &unit, size_t capacity, uint64_t retention_us)
+    : name_(name)
+    , unit_(unit)
+    , frequency_(0)
+    , start_time_us_(0)
+    , capacity_(std::max<size_t>(capacity, 1))
+    , retention_us_(retention_us)
+    , head_(0)
+    , count_(0)
+{
+    timestamps_us_.reserve(2 * capacity_);
+    data_.reserve(2 * capacity_);
+}
+
+std::unique_ptr<RingWKV> RingWKV::forRetention(const std::string &name,
+                                               const std::string &unit,
+                                               int frequency,
+                                               uint64_t retention_us)
+{
+    const auto capacity = static_cast<size_t>(std::ceil(retention_us / 1e6 * frequency * 1.1)) + 1;
+    auto ring = std::make_unique<RingWKV>(name, unit, capacity, retention_us);
+    ring->setFrequency(frequency);
+    return ring;
+}
+
+void RingWKV::generateData(int frequency,
+                           double jitter,
+                           int duration_seconds,
+                           std::optional<IWKV *> other_sensor_ptr)
+{
+    throw std::logic_error("RingWKV stores captured data and cannot generate it.");
+}
+
+std::string RingWKV::getName() const
+{
+    return name_;
+}
+
+int RingWKV::getFrequency() const
+{
+    return frequency_;
+}
+
+std::string RingWKV::getUnit() const
+{
+    return unit_;
+}
+
+uint64_t RingWKV::getStartTimeUs() const
+{
+    return start_time_us_;
+}
+
+void RingWKV::setName(const std::string &name)
+{
+    name_ = name;
+}
+
+void RingWKV::setUnit(const std::string &unit)
+{
+    unit_ = unit;
+}
+
+void RingWKV::setStartTimeUs(uint64_t start_time_us)
+{
+    start_time_us_ = start_time_us;
+}
+
+void RingWKV::setFrequency(int frequency)
+{
+    frequency_ = frequency;
+}
+
+size_t RingWKV::getCapacity() const
+{
+    return capacity_;
+}
+
+uint64_t RingWKV::getRetentionUs() const
+{
+    return retention_us_;
+}
+
+size_t RingWKV::size() const
+{
+    return count_;
+}
+
+/**
+ * @brief Adds a data point to the ring.
+ * 
+ * The storage only grows up to twice the capacity reserved at construction. The sample is
+ * appended after the newest one, once the samples kept were moved back to the storage start if
+ * its end is reached.
+ */
+void RingWKV::addDataPoint(const uint64_t epoch_us, const double value)
+{
+    if (count_ == capacity_) {
+        dropOldest();
+    }
+    if (timestamps_us_.size() == 2 * capacity_) {
+        compact();
+    }
+    timestamps_us_.push_back(epoch_us);
+    data_.push_back(value);
+    ++count_;
+
+    // Time-based retention, relative to the newest sample
+    while (retention_us_ != 0 && count_ > 1 && timestamps_us_[head_] + retention_us_ < epoch_us) {
+        dropOldest();
+    }
+}
+
+void RingWKV::addDataPoints(std::span<const uint64_t> epochs_us, std::span<const double> values)
+{
+    for (size_t i = 0; i < epochs_us.size(); ++i) {
+        addDataPoint(epochs_us[i], values[i]);
+    }
+    const size_t appended = std::min(epochs_us.size(), count_);
+    emit sensorDataAppended(*this, count_ - appended, appended);
+}
+
+void RingWKV::dropOldest()
+{
+    ++head_;
+    --count_;
+}
+
+/**
+ * @brief Move the samples kept to the start of the storage, which keeps its capacity.
+ */
+void RingWKV::compact()
+{
+    timestamps_us_.erase(timestamps_us_.begin(), timestamps_us_.begin() + head_);
+    data_.erase(data_.begin(), data_.begin() + head_);
+    head_ = 0;
+}
+
+std::array<RingWKV::Segment, 2> RingWKV::segments() const
+{
+    return {Segment{getTimestampsUs(), getData()}, Segment{}};
+}
+
+std::span<const uint64_t> RingWKV::getTimestampsUs() const
+{
+    return std::span<const uint64_t>(timestamps_us_).subspan(head_, count_);
+}
+
+std::span<const double> RingWKV::getData() const
+{
+    return std::span<const double>(data_).subspan(head_, count_);
+}
+
+void RingWKV::setData(const std::vector<double> &data)
+{
+    if (data.size() != count_) {
+        throw std::invalid_argument("RingWKV::setData requires one value per sample in the ring.");
+    }
+    std::copy(data.begin(), data.end(), data_.begin() + head_);
+}
+
+void RingWKV::setData(std::vector<double> &&data)
+{
+    // The ring keeps its own preallocated storage, the values are copied into it
+    setData(static_cast<const std::vector<double> &>(data));
+}
+
+void RingWKV::copyFrom(const IWKV &other)
+{
+    // this->name_ = other.getName(); // do not copy the name as it is constructed with it.
+    this->unit_ = other.getUnit();
+    this->frequency_ = other.getFrequency();
+    this->start_time_us_ = other.getStartTimeUs();
+
+    timestamps_us_.clear();
+    data_.clear();
+    head_ = 0;
+    count_ = 0;
+
+    const std::span<const uint64_t> timestamps = other.getTimestampsUs();
+    const std::span<const double> data = other.getData();
+    for (size_t i = timestamps.size() - std::min(timestamps.size(), capacity_); i < timestamps.size(); ++i) {
+        addDataPoint(timestamps[i], data[i]);
+    }
+    emit sensorDataReady(*this);
+}
@@ -0,0 +1,136 @@
+#ifndef RINGWKV_H
+#define RINGWKV_H
+
+#include "iwkv.h"
+#include <array>
+#include <memory>
+#include <span>
+
+/**
+ * @brief The RingWKV class stores the most recent samples of a sensor in a fixed-capacity ring.
+ *
+ * Both columns are allocated once at construction. When the ring is full, or when a sample is
+ * older than the retention window, the oldest sample is dropped, so a long-running capture keeps
+ * a bounded memory footprint and never reallocates.
+ *
+ * The storage holds twice the capacity: samples are appended after the newest one and, when the
+ * storage end is reached, the samples kept are moved back to its start, at most once every
+ * capacity appends. The contents are therefore always contiguous and oldest first, and only the
+ * write path moves samples: the const accessors read the storage in place, so concurrent readers
+ * are safe and the spans they return stay valid until the next write.
+ */
+class RingWKV : public IWKV
+{
+public:
+    /**
+     * @brief A contiguous part of the ring, in chronological order.
+     */
+    struct Segment
+    {
+        std::span<const uint64_t> timestamps_us; ///< Timestamps in microseconds.
+        std::span<const double> data;            ///< Data values corresponding to the timestamps.
+    };
+
+private:
+    std::string name_;                            ///< Name of the sensor.
+    std::string unit_;                            ///< Unit of measurement for the data.
+    int frequency_;                               ///< Frequency in Hertz
+    uint64_t start_time_us_;                      ///< Start time of the data series in microseconds.
+    size_t capacity_;                             ///< Maximum number of samples kept.
+    uint64_t retention_us_;                       ///< Maximum age of a sample, 0 to only use capacity.
+    std::vector<uint64_t> timestamps_us_;         ///< Storage of the timestamps, 2 x capacity.
+    std::vector<double> data_;                    ///< Storage of the data values, 2 x capacity.
+    size_t head_;                                 ///< Storage index of the oldest sample.
+    size_t count_;                                ///< Number of samples in the ring.
+
+    void dropOldest();
+    void compact();
+
+public:
+    /**
+     * @brief Construct a new RingWKV.
+     *
+     * @param name The name of the sensor.
+     * @param unit The measurement unit of the data.
+     * @param capacity The maximum number of samples kept.
+     * @param retention_us The maximum age of a sample relative to the newest one, in microseconds.
+     * 0 keeps samples until the capacity is reached.
+     */
+    RingWKV(const std::string &name, const std::string &unit, size_t capacity, uint64_t retention_us = 0);
+
+    /**
+     * @brief Create a ring holding the last retention_us of a sensor sampled at frequency.
+     *
+     * The capacity gets 10 % headroom over the nominal sample count to absorb timing jitter.
+     */
+    static std::unique_ptr<RingWKV> forRetention(const std::string &name,
+                                                 const std::string &unit,
+                                                 int frequency,
+                                                 uint64_t retention_us);
+
+    /**
+     * @brief Not supported: a ring stores captured data, it does not generate it.
+     * 
+     * @throws std::logic_error Always.
+     */
+    void generateData(int frequency,
+                      double jitter,
+                      int duration_seconds,
+                      std::optional<IWKV *> other_sensor_ptr = std::nullopt) override;
+
+    std::string getName() const override;
+    int getFrequency() const override;
+    std::string getUnit() const override;
+    uint64_t getStartTimeUs() const override;
+    void setName(const std::string &name) override;
+    void setUnit(const std::string &unit) override;
+    void setStartTimeUs(uint64_t start_time_us) override;
+
+    /**
+     * @brief Set the nominal frequency of the captured sensor.
+     */
+    void setFrequency(int frequency) override;
+
+    size_t getCapacity() const;
+    uint64_t getRetentionUs() const;
+    size_t size() const;
+
+    /**
+     * @brief Add a data point, dropping the oldest ones if the ring is full or they are too old.
+     */
+    void addDataPoint(const uint64_t epoch_us, const double value) override;
+    void addDataPoints(std::span<const uint64_t> epochs_us, std::span<const double> values) override;
+
+    /**
+     * @brief Get the contents of the ring as segments, oldest first, without copying.
+     *
+     * The contents are kept contiguous, so the second segment is always empty; both are returned
+     * so consumers iterating over the segments do not depend on the storage layout.
+     */
+    std::array<Segment, 2> segments() const;
+
+    /**
+     * @brief Get the timestamps, oldest first, without copying.
+     */
+    std::span<const uint64_t> getTimestampsUs() const override;
+
+    /**
+     * @brief Get the data values, oldest first, without copying.
+     */
+    std::span<const double> getData() const override;
+
+    /**
+     * @brief Set the data values, which must have as many values as the ring has samples.
+     * 
+     * @throws std::invalid_argument If the size does not match.
+     */
+    void setData(const std::vector<double> &data) override;
+    void setData(std::vector<double> &&data) override;
+
+    /**
+     * @brief Copy the most recent samples of another sensor, up to the ring capacity.
+     */
+    void copyFrom(const IWKV &other) override;
+};
+
+#endif // RINGWKV_H
@@ -0,0 +1,58 @@
+#ifndef SAMPLECOLUMNS_H
+#define SAMPLECOLUMNS_H
+
+#include <cstdint>
+#include <span>
+#include <type_traits>
+
+/**
+ * @brief Read-only timestamp column, stored as offsets from an origin.
+ *
+ * TimestampColumn<uint64_t> with a zero origin is the absolute column of an IWKV; narrower
+ * offset types hold the relative timestamps of compact storage (see CompactWKV). operator[]
+ * always returns absolute microseconds, so kernels are written once for every offset type.
+ */
+template<typename Offset>
+struct TimestampColumn
+{
+    static_assert(std::is_unsigned_v<Offset>, "timestamp offsets must be unsigned");
+
+    std::span<const Offset> offsets; ///< Offsets from origin_us, in microseconds.
+    uint64_t origin_us = 0;          ///< Absolute time of offset zero.
+
+    size_t size() const { return offsets.size(); }
+    bool empty() const { return offsets.empty(); }
+    uint64_t operator[](size_t i) const { return origin_us + offsets[i]; }
+};
+
+/**
+ * @brief Read-only value column, optionally quantised.
+ *
+ * Floating-point samples are used as they are. Integer samples are quantised values decoded as
+ * offset + scale * sample; scale must be positive so the decoding keeps the order of the samples.
+ */
+template<typename Value>
+struct ValueColumn
+{
+    static_assert(std::is_arithmetic_v<Value>, "values must be arithmetic");
+
+    std::span<const Value> samples; ///< Stored samples.
+    double scale = 1.0;             ///< Quantisation step, integer samples only.
+    double offset = 0.0;            ///< Value of a zero sample, integer samples only.
+
+    size_t size() const { return samples.size(); }
+    bool empty() const { return samples.empty(); }
+
+    double decode(Value sample) const
+    {
+        if constexpr (std::is_floating_point_v<Value>) {
+            return static_cast<double>(sample);
+        } else {
+            return offset + scale * static_cast<double>(sample);
+        }
+    }
+
+    double operator[](size_t i) const { return decode(samples[i]); }
+};
+
+#endif // SAMPLECOLUMNS_H
@@ -1,169 +1,609 @@
-#include "sensordataprocessor.h"
-#include <boost/math/interpolators/cardinal_cubic_b_spline.hpp>
-#include <iostream>
-
-void SensorDataProcessor::resampleData(IWKV *base_sensor,
-                                       IWKV *resampled_sensor,
-                                       int target_rate,
-                                       double start_time_s,
-                                       double end_time_s)
-{
-    if (!base_sensor || !resampled_sensor) {
-        std::cerr << "Invalid sensor pointers provided." << std::endl;
-        return;
-    }
-
-    // Ensure non-null pointers for safety
-    if (end_time_s < start_time_s) {
-        std::cerr << "Invalid start time or end time provided." << std::endl;
-        return; // Optionally, throw an exception or handle error
-    }
-
-    const std::vector<uint64_t> &timestamps = base_sensor->getTimestampsUs();
-    const std::vector<double> &data = base_sensor->getData();
-
-    if (timestamps.empty() || data.empty()) {
-        std::cerr << "Sensor data is empty." << std::endl;
-        return;
-    }
-
-    // Use the actual start time from the sensor data generation
-    uint64_t start_time_us = base_sensor->getStartTimeUs()
-                             + static_cast<uint64_t>(start_time_s * 1e6);
-    uint64_t end_time_us = start_time_us + static_cast<uint64_t>((end_time_s - start_time_s) * 1e6);
-
-    // Initialize the spline using actual microsecond timestamps
-    boost::math::interpolators::cardinal_cubic_b_spline<double>
-        spline(data.begin(),
-               data.end(),
-               timestamps.front(),
-               (timestamps.back() - timestamps.front()) / (timestamps.size() - 1));
-
-    double time_step_s = 1.0 / target_rate;
-
-    for (uint64_t current_time_us = start_time_us; current_time_us <= end_time_us;
-         current_time_us += static_cast<uint64_t>(time_step_s * 1e6)) {
-        if (current_time_us >= timestamps.front() && current_time_us <= timestamps.back()) {
-            double interpolated_value = spline(current_time_us);
-            resampled_sensor->addDataPoint(current_time_us, interpolated_value);
-        }
-    }
-
-    resampled_sensor->setStartTimeUs(base_sensor->getStartTimeUs());
-    emit resampled_sensor->sensorDataReady(*resampled_sensor);
-}
-
-std::vector<uint64_t> SensorDataProcessor::findPeaks(const IWKV *sensor,
-                                                     double start_time_s,
-                                                     double end_time_s)
-{
-    const std::vector<uint64_t> &timestamps = sensor->getTimestampsUs();
-    const std::vector<double> &data = sensor->getData();
-
-    std::vector<uint64_t> peakTimestamps;
-
-    uint64_t start_time_us = static_cast<uint64_t>(start_time_s * 1e6) + sensor->getStartTimeUs();
-    uint64_t end_time_us = static_cast<uint64_t>(end_time_s * 1e6) + sensor->getStartTimeUs();
-
-    // Ensure we have at least three points to compare (previous, current, next)
-    if (data.size() < 3)
-        return peakTimestamps;
-
-    for (size_t i = 1; i < data.size() - 1; ++i) {
-        if (timestamps[i] >= start_time_us && timestamps[i] <= end_time_us) {
-            if (data[i] > data[i - 1] && data[i] > data[i + 1]) {
-                peakTimestamps.push_back(timestamps[i]);
-            }
-        }
-    }
-    emit peaksDataReady(*sensor,
-                        peakTimestamps,
-                        sensor->getName()); // Assuming getName returns QString
-    return peakTimestamps;
-}
-
-void SensorDataProcessor::calculateVelocityAndAcceleration(const IWKV &sensor,
-                                                           double start_time_s,
-                                                           double end_time_s,
-                                                           std::vector<double> &velocities,
-                                                           std::vector<double> &accelerations)
-{
-    const std::vector<uint64_t> &timestamps = sensor.getTimestampsUs();
-    const std::vector<double> &positions = sensor.getData();
-
-    velocities.clear();
-    accelerations.clear();
-
-    // Convert start and end time from seconds to microseconds
-    uint64_t start_time_us = static_cast<uint64_t>(start_time_s * 1e6) + sensor.getStartTimeUs();
-    uint64_t end_time_us = static_cast<uint64_t>(end_time_s * 1e6) + sensor.getStartTimeUs();
-
-    // Initial indices for the start and end times
-    size_t startIndex = 0, endIndex = timestamps.size() - 1;
-    for (size_t i = 0; i < timestamps.size(); ++i) {
-        if (timestamps[i] >= start_time_us) {
-            startIndex = i;
-            break;
-        }
-    }
-    for (size_t i = startIndex; i < timestamps.size(); ++i) {
-        if (timestamps[i] > end_time_us) {
-            endIndex = i - 1;
-            break;
-        }
-    }
-
-    // Calculate velocity
-    for (size_t i = startIndex; i < endIndex; ++i) {
-        double dt = (timestamps[i + 1] - timestamps[i]) / 1e6; // delta time in seconds
-        if (std::abs(dt) > 1e-5) { // Avoid division by zero or near-zero time intervals
-            double dv = (positions[i + 1] - positions[i]) / dt;
-            velocities.push_back(dv);
-        }
-    }
-
-    // Calculate acceleration
-    for (size_t i = 0; i < velocities.size() - 1; ++i) {
-        double dt = (timestamps[startIndex + i + 1] - timestamps[startIndex + i])
-                    / 1e6;         // delta time in seconds
-        if (std::abs(dt) > 1e-5) { // Avoid division by zero or near-zero time intervals
-            double da = (velocities[i + 1] - velocities[i]) / dt;
-            accelerations.push_back(da);
-        }
-    }
-}
-
-void SensorDataProcessor::applyGaussianSmoothing(IWKV &sensor, int kernel_size, double sigma)
-{
-    std::vector<double> kernel(kernel_size);
-    const auto &data = sensor.getData();
-    int half_size = kernel_size / 2;
-    double sum = 0.0;
-
-    for (int i = 0; i < kernel_size; ++i) {
-        int x = i - half_size;
-        kernel[i] = exp(-0.5 * x * x / (sigma * sigma)) / (sqrt(2 * M_PI) * sigma);
-        sum += kernel[i];
-    }
-
-    // Normalize the kernel
-    for (int i = 0; i < kernel_size; ++i) {
-        kernel[i] /= sum;
-    }
-
-    std::vector<double> smoothed(data.size(), 0.0);
-
-    for (size_t i = 0; i < data.size(); ++i) {
-        double sum = 0.0;
-        for (int j = -half_size; j <= half_size; ++j) {
-            int idx = i + j;
-            if (idx >= 0 && idx < data.size()) {
-                sum += data[idx] * kernel[half_size + j];
-            }
-        }
-        smoothed[i] = sum;
-    }
-
-    sensor.setData(smoothed);
-    emit sensor.sensorDataReady(sensor);
-}
+#include "sensordataprocessor.h"
+#include "metrics.h"
+#include "polyphaseresampler.h"
+#include <boost/math/interpolators/cardinal_cubic_b_spline.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+// Samples kept on each side of a resampling window so the spline is not evaluated on its edges.
+constexpr size_t resample_halo_samples = 4;
+
+// Bytes read per sample of a decoded series, a timestamp and a value.
+constexpr size_t sample_bytes = sizeof(uint64_t) + sizeof(double);
+
+/**
+ * @brief Samples of a compact sensor in [start_time_s, end_time_s], as WKVView::window() then
+ * widened() would select them.
+ *
+ * @return The index of the first sample and the number of samples.
+ */
+template<typename Value>
+std::pair<size_t, size_t> compactWindow(const CompactWKV<Value> &sensor,
+                                        double start_time_s,
+                                        double end_time_s,
+                                        size_t before,
+                                        size_t after)
+{
+    const uint64_t start_time_us = sensor.getStartTimeUs() + static_cast<uint64_t>(start_time_s * 1e6);
+    const uint64_t end_time_us = sensor.getStartTimeUs() + static_cast<uint64_t>(end_time_s * 1e6);
+    size_t first = 0, last = 0;
+    if (end_time_us >= start_time_us) {
+        first = sensor.lowerBound(start_time_us);
+        last = end_time_us == UINT64_MAX ? sensor.size() : sensor.lowerBound(end_time_us + 1);
+    }
+    first -= std::min(before, first);
+    last = std::min(last + after, sensor.size());
+    return {first, last - first};
+}
+
+} // namespace
+
+SensorDataProcessor::SensorDataProcessor(std::pmr::memory_resource *resource)
+    : resource_(resource)
+{}
+
+std::pmr::memory_resource *SensorDataProcessor::getMemoryResource() const
+{
+    return resource_;
+}
+
+void SensorDataProcessor::resampleData(IWKV *base_sensor,
+                                       IWKV *resampled_sensor,
+                                       int target_rate,
+                                       double start_time_s,
+                                       double end_time_s,
+                                       InterpolationMode mode)
+{
+    TWIICE_METRICS_SCOPE("SensorDataProcessor::resampleData");
+    if (!base_sensor || !resampled_sensor) {
+        std::cerr << "Invalid sensor pointers provided." << std::endl;
+        return;
+    }
+
+    // The polyphase grid starts at the first sample of the window, which must be in it
+    const size_t halo = mode == InterpolationMode::Polyphase ? 0 : resample_halo_samples;
+    const WKVView window = WKVView::window(*base_sensor, start_time_s, end_time_s).widened(halo, halo);
+    resampleData(window, resampled_sensor, target_rate, start_time_s, end_time_s, mode);
+}
+
+void SensorDataProcessor::resampleData(const WKVView &base_window,
+                                       IWKV *resampled_sensor,
+                                       int target_rate,
+                                       double start_time_s,
+                                       double end_time_s,
+                                       InterpolationMode mode)
+{
+    TWIICE_METRICS_SCOPE("SensorDataProcessor::resampleData");
+    if (!resampled_sensor) {
+        std::cerr << "Invalid sensor pointers provided." << std::endl;
+        return;
+    }
+
+    if (target_rate <= 0) {
+        std::cerr << "Invalid target rate provided." << std::endl;
+        return;
+    }
+
+    // Ensure non-null pointers for safety
+    if (end_time_s < start_time_s) {
+        std::cerr << "Invalid start time or end time provided." << std::endl;
+        return; // Optionally, throw an exception or handle error
+    }
+
+    const std::span<const uint64_t> timestamps = base_window.getTimestampsUs();
+    const std::span<const double> data = base_window.getData();
+
+    if (timestamps.empty()) {
+        std::cerr << "Sensor data is empty." << std::endl;
+        return;
+    }
+    TWIICE_METRICS_SAMPLES(timestamps.size());
+    TWIICE_METRICS_BYTES(timestamps.size() * sample_bytes);
+
+    // Use the actual start time from the sensor data generation
+    uint64_t start_time_us = base_window.getStartTimeUs()
+                             + static_cast<uint64_t>(start_time_s * 1e6);
+    uint64_t end_time_us = start_time_us + static_cast<uint64_t>((end_time_s - start_time_s) * 1e6);
+
+    if (mode == InterpolationMode::Polyphase) {
+        resamplePolyphase(base_window, resampled_sensor, target_rate, start_time_us, end_time_us);
+        return;
+    }
+
+    if (mode != InterpolationMode::CardinalSpline) {
+        const auto step_us = static_cast<uint64_t>(std::llround(1e6 / target_rate));
+        const size_t count = LocalResampler::outputSize(base_window, start_time_us, end_time_us, step_us);
+
+        // Interpolate into a pre-sized block and append it to the output in one go
+        std::pmr::vector<uint64_t> resampled_timestamps(count, resource_);
+        std::pmr::vector<double> resampled_data(count, resource_);
+        LocalResampler(mode).resample(base_window,
+                                      start_time_us,
+                                      end_time_us,
+                                      step_us,
+                                      resampled_timestamps,
+                                      resampled_data);
+        resampled_sensor->addDataPoints(resampled_timestamps, resampled_data);
+
+        resampled_sensor->setStartTimeUs(base_window.getStartTimeUs());
+        resampled_sensor->setFrequency(target_rate);
+        emit resampled_sensor->sensorDataReady(*resampled_sensor);
+        return;
+    }
+
+    // The cubic B-spline needs at least five knots
+    if (timestamps.size() < 5) {
+        std::cerr << "Not enough sensor data in the window." << std::endl;
+        return;
+    }
+
+    // Initialize the spline over the window only, using actual microsecond timestamps
+    boost::math::interpolators::cardinal_cubic_b_spline<double>
+        spline(data.begin(),
+               data.end(),
+               timestamps.front(),
+               (timestamps.back() - timestamps.front()) / (timestamps.size() - 1));
+
+    double time_step_s = 1.0 / target_rate;
+
+    for (uint64_t current_time_us = start_time_us; current_time_us <= end_time_us;
+         current_time_us += static_cast<uint64_t>(time_step_s * 1e6)) {
+        if (current_time_us >= timestamps.front() && current_time_us <= timestamps.back()) {
+            double interpolated_value = spline(current_time_us);
+            resampled_sensor->addDataPoint(current_time_us, interpolated_value);
+        }
+    }
+
+    resampled_sensor->setStartTimeUs(base_window.getStartTimeUs());
+    resampled_sensor->setFrequency(target_rate);
+    emit resampled_sensor->sensorDataReady(*resampled_sensor);
+}
+
+/**
+ * @brief Convert the rate of a view taken as uniform, on a grid starting at its first sample.
+ */
+void SensorDataProcessor::resamplePolyphase(const WKVView &base_window,
+                                            IWKV *resampled_sensor,
+                                            int target_rate,
+                                            uint64_t start_time_us,
+                                            uint64_t end_time_us)
+{
+    const std::span<const uint64_t> timestamps = base_window.getTimestampsUs();
+    const std::span<const double> data = base_window.getData();
+
+    // Nominal rate of the sensor, or the mean rate of the window if the sensor does not know it
+    int input_rate = base_window.getSource().getFrequency();
+    if (input_rate <= 0 && timestamps.back() > timestamps.front()) {
+        input_rate = static_cast<int>(std::lround((timestamps.size() - 1) * 1e6
+                                                  / (timestamps.back() - timestamps.front())));
+    }
+    if (input_rate <= 0) {
+        std::cerr << "Cannot determine the sampling rate of the sensor." << std::endl;
+        return;
+    }
+
+    PolyphaseResampler resampler(input_rate, target_rate);
+    const auto step_us = static_cast<uint64_t>(std::llround(1e6 / target_rate));
+    std::pmr::vector<double> resampled_data(resampler.resampledSize(data.size()), resource_);
+    resampler.resample(data, resampled_data);
+
+    // Keep the instants within the requested window
+    const uint64_t first_us = timestamps.front();
+    size_t first = 0, count = resampled_data.size();
+    if (start_time_us > first_us) {
+        first = std::min<size_t>((start_time_us - first_us + step_us - 1) / step_us, count);
+    }
+    if (end_time_us < first_us) {
+        count = first;
+    } else {
+        count = std::min<size_t>(count, (end_time_us - first_us) / step_us + 1);
+    }
+    count = std::max(count, first);
+    std::pmr::vector<uint64_t> resampled_timestamps(count - first, resource_);
+    for (size_t k = 0; k < resampled_timestamps.size(); ++k) {
+        resampled_timestamps[k] = first_us + (first + k) * step_us;
+    }
+    resampled_sensor->addDataPoints(resampled_timestamps,
+                                    std::span<const double>(resampled_data).subspan(first, count - first));
+
+    resampled_sensor->setStartTimeUs(base_window.getStartTimeUs());
+    resampled_sensor->setFrequency(target_rate);
+    emit resampled_sensor->sensorDataReady(*resampled_sensor);
+}
+
+std::vector<uint64_t> SensorDataProcessor::findPeaks(const IWKV *sensor,
+                                                     double start_time_s,
+                                                     double end_time_s)
+{
+    TWIICE_METRICS_SCOPE("SensorDataProcessor::findPeaks");
+    // Widen by one sample so the samples on the window edges can be compared to their neighbours
+    return findPeaks(WKVView::window(*sensor, start_time_s, end_time_s).widened(1, 1));
+}
+
+std::vector<uint64_t> SensorDataProcessor::findPeaks(const WKVView &window)
+{
+    TWIICE_METRICS_SCOPE("SensorDataProcessor::findPeaks");
+    const std::span<const uint64_t> timestamps = window.getTimestampsUs();
+    const std::span<const double> data = window.getData();
+
+    TWIICE_METRICS_SAMPLES(data.size());
+    TWIICE_METRICS_BYTES(data.size() * sample_bytes);
+
+    std::vector<uint64_t> peakTimestamps;
+
+    // Ensure we have at least three points to compare (previous, current, next)
+    if (data.size() >= 3) {
+        for (size_t i = 1; i < data.size() - 1; ++i) {
+            if (data[i] > data[i - 1] && data[i] > data[i + 1]) {
+                peakTimestamps.push_back(timestamps[i]);
+            }
+        }
+    }
+
+    const IWKV &sensor = window.getSource();
+    emit peaksDataReady(sensor,
+                        peakTimestamps,
+                        sensor.getName()); // Assuming getName returns QString
+    return peakTimestamps;
+}
+
+void SensorDataProcessor::findPeaks(const IWKV *sensor,
+                                    double start_time_s,
+                                    double end_time_s,
+                                    const PeakCriteria &criteria,
+                                    PeakSeries &peaks)
+{
+    TWIICE_METRICS_SCOPE("SensorDataProcessor::findPeaks");
+    findPeaks(WKVView::window(*sensor, start_time_s, end_time_s).widened(1, 1), criteria, peaks);
+}
+
+void SensorDataProcessor::findPeaks(const WKVView &window,
+                                    const PeakCriteria &criteria,
+                                    PeakSeries &peaks)
+{
+    TWIICE_METRICS_SCOPE("SensorDataProcessor::findPeaks");
+    TWIICE_METRICS_SAMPLES(window.size());
+    TWIICE_METRICS_BYTES(window.size() * sample_bytes);
+    PeakDetector(criteria, resource_).detect(window, peaks);
+
+    const IWKV &sensor = window.getSource();
+    emit peaksDataReady(sensor, peaks.timestamps_us, sensor.getName());
+}
+
+void SensorDataProcessor::calculateVelocityAndAcceleration(const IWKV &sensor,
+                                                           double start_time_s,
+                                                           double end_time_s,
+                                                           DerivativeSeries &derivatives)
+{
+    TWIICE_METRICS_SCOPE("SensorDataProcessor::calculateVelocityAndAcceleration");
+    // Widen by one sample so the samples on the window edges have both neighbours
+    calculateVelocityAndAcceleration(WKVView::window(sensor, start_time_s, end_time_s).widened(1, 1),
+                                     derivatives);
+}
+
+void SensorDataProcessor::calculateVelocityAndAcceleration(const WKVView &window,
+                                                           DerivativeSeries &derivatives)
+{
+    TWIICE_METRICS_SCOPE("SensorDataProcessor::calculateVelocityAndAcceleration");
+    TWIICE_METRICS_SAMPLES(window.size());
+    TWIICE_METRICS_BYTES(window.size() * sample_bytes);
+    DerivativeEngine::compute(window, derivatives);
+}
+
+void SensorDataProcessor::applyGaussianSmoothing(IWKV &sensor,
+                                                 int kernel_size,
+                                                 double sigma,
+                                                 SmoothingMode mode)
+{
+    TWIICE_METRICS_SCOPE("SensorDataProcessor::applyGaussianSmoothing");
+    if (kernel_size <= 0 || kernel_size % 2 == 0 || !(sigma > 0.0)) {
+        std::cerr << "Invalid kernel size or sigma provided." << std::endl;
+        return;
+    }
+
+    std::vector<double> smoothed;
+    applyGaussianSmoothing(WKVView::all(sensor), smoothed, kernel_size, sigma, mode);
+
+    sensor.setData(std::move(smoothed));
+    emit sensor.sensorDataReady(sensor);
+}
+
+void SensorDataProcessor::applyGaussianSmoothing(const WKVView &window,
+                                                 std::vector<double> &smoothed,
+                                                 int kernel_size,
+                                                 double sigma,
+                                                 SmoothingMode mode)
+{
+    TWIICE_METRICS_SCOPE("SensorDataProcessor::applyGaussianSmoothing");
+    TWIICE_METRICS_SAMPLES(window.size());
+    TWIICE_METRICS_BYTES(window.getData().size_bytes());
+    smoothed.resize(window.size());
+    GaussianSmoother(kernel_size, sigma, resource_).smooth(window.getData(), smoothed, mode);
+}
+
+void SensorDataProcessor::applyGaussianSmoothing(const WKVView &window,
+                                                 std::span<double> smoothed,
+                                                 int kernel_size,
+                                                 double sigma,
+                                                 SmoothingMode mode)
+{
+    TWIICE_METRICS_SCOPE("SensorDataProcessor::applyGaussianSmoothing");
+    if (smoothed.size() != window.size()) {
+        throw std::invalid_argument("applyGaussianSmoothing: the output does not match the window");
+    }
+    TWIICE_METRICS_SAMPLES(window.size());
+    TWIICE_METRICS_BYTES(window.getData().size_bytes());
+    GaussianSmoother(kernel_size, sigma, resource_).smooth(window.getData(), smoothed, mode);
+}
+
+void SensorDataProcessor::resampleData(const MultiChannelWKV &base_sensor,
+                                       MultiChannelWKV &resampled_sensor,
+                                       int target_rate,
+                                       double start_time_s,
+                                       double end_time_s,
+                                       InterpolationMode mode)
+{
+    TWIICE_METRICS_SCOPE("SensorDataProcessor::resampleData");
+    if (mode == InterpolationMode::CardinalSpline || mode == InterpolationMode::Polyphase) {
+        throw std::invalid_argument("resampleData: the cardinal spline and polyphase modes are not "
+                                    "available on multi-channel series");
+    }
+    if (resampled_sensor.channelCount() != base_sensor.channelCount()) {
+        throw std::invalid_argument("resampleData: the output does not have the channels of the input");
+    }
+    if (target_rate <= 0) {
+        std::cerr << "Invalid target rate provided." << std::endl;
+        return;
+    }
+    if (end_time_s < start_time_s) {
+        std::cerr << "Invalid start time or end time provided." << std::endl;
+        return;
+    }
+
+    const auto [first, count] = base_sensor.window(start_time_s,
+                                                   end_time_s,
+                                                   resample_halo_samples,
+                                                   resample_halo_samples);
+    if (count == 0) {
+        std::cerr << "Sensor data is empty." << std::endl;
+        return;
+    }
+    const size_t channel_count = base_sensor.channelCount();
+    TWIICE_METRICS_SAMPLES(count * channel_count);
+    TWIICE_METRICS_BYTES(count * (sizeof(uint64_t) + channel_count * sizeof(double)));
+    std::pmr::vector<std::span<const double>> channels(channel_count, resource_);
+    for (size_t c = 0; c < channel_count; ++c) {
+        channels[c] = base_sensor.getChannel(c).subspan(first, count);
+    }
+    const std::span<const uint64_t> timestamps = base_sensor.getTimestampsUs().subspan(first, count);
+
+    const uint64_t start_time_us = base_sensor.getStartTimeUs()
+                                   + static_cast<uint64_t>(start_time_s * 1e6);
+    const uint64_t end_time_us = start_time_us
+                                 + static_cast<uint64_t>((end_time_s - start_time_s) * 1e6);
+    const auto step_us = static_cast<uint64_t>(std::llround(1e6 / target_rate));
+    const size_t output_count = LocalResampler::outputSize(timestamps, start_time_us, end_time_us, step_us);
+
+    // Every output channel is a slice of a single block
+    std::pmr::vector<uint64_t> resampled_timestamps(output_count, resource_);
+    std::pmr::vector<double> resampled_data(output_count * channel_count, resource_);
+    std::pmr::vector<std::span<double>> resampled_channels(channel_count, resource_);
+    for (size_t c = 0; c < channel_count; ++c) {
+        resampled_channels[c] = std::span<double>(resampled_data).subspan(c * output_count, output_count);
+    }
+    LocalResampler(mode).resample(timestamps,
+                                  channels,
+                                  start_time_us,
+                                  end_time_us,
+                                  step_us,
+                                  resampled_timestamps,
+                                  resampled_channels);
+
+    std::pmr::vector<std::span<const double>> appended(resampled_channels.begin(),
+                                                       resampled_channels.end(),
+                                                       resource_);
+    resampled_sensor.addDataPoints(resampled_timestamps, appended);
+    resampled_sensor.setStartTimeUs(base_sensor.getStartTimeUs());
+}
+
+void SensorDataProcessor::findPeaks(const MultiChannelWKV &sensor,
+                                    double start_time_s,
+                                    double end_time_s,
+                                    const PeakCriteria &criteria,
+                                    std::vector<PeakSeries> &peaks)
+{
+    TWIICE_METRICS_SCOPE("SensorDataProcessor::findPeaks");
+    const auto [first, count] = sensor.window(start_time_s, end_time_s, 1, 1);
+    TWIICE_METRICS_SAMPLES(count * sensor.channelCount());
+    TWIICE_METRICS_BYTES(count * (sizeof(uint64_t) + sensor.channelCount() * sizeof(double)));
+    std::pmr::vector<std::span<const double>> channels(sensor.channelCount(), resource_);
+    for (size_t c = 0; c < channels.size(); ++c) {
+        channels[c] = sensor.getChannel(c).subspan(first, count);
+    }
+    PeakDetector(criteria, resource_).detect(sensor.getTimestampsUs().subspan(first, count), channels, peaks);
+}
+
+void SensorDataProcessor::calculateVelocityAndAcceleration(const MultiChannelWKV &sensor,
+                                                           double start_time_s,
+                                                           double end_time_s,
+                                                           MultiChannelDerivatives &derivatives)
+{
+    TWIICE_METRICS_SCOPE("SensorDataProcessor::calculateVelocityAndAcceleration");
+    const auto [first, count] = sensor.window(start_time_s, end_time_s, 1, 1);
+    TWIICE_METRICS_SAMPLES(count * sensor.channelCount());
+    TWIICE_METRICS_BYTES(count * (sizeof(uint64_t) + sensor.channelCount() * sizeof(double)));
+    std::pmr::vector<std::span<const double>> channels(sensor.channelCount(), resource_);
+    for (size_t c = 0; c < channels.size(); ++c) {
+        channels[c] = sensor.getChannel(c).subspan(first, count);
+    }
+    DerivativeEngine::compute(sensor.getTimestampsUs().subspan(first, count), channels, derivatives);
+}
+
+void SensorDataProcessor::applyGaussianSmoothing(MultiChannelWKV &sensor,
+                                                 int kernel_size,
+                                                 double sigma,
+                                                 SmoothingMode mode)
+{
+    TWIICE_METRICS_SCOPE("SensorDataProcessor::applyGaussianSmoothing");
+    TWIICE_METRICS_SAMPLES(sensor.size() * sensor.channelCount());
+    TWIICE_METRICS_BYTES(sensor.size() * sensor.channelCount() * sizeof(double));
+    const size_t channel_count = sensor.channelCount();
+    std::pmr::vector<std::span<const double>> channels(channel_count, resource_);
+    std::vector<std::vector<double>> smoothed(channel_count, std::vector<double>(sensor.size()));
+    std::pmr::vector<std::span<double>> outputs(channel_count, resource_);
+    for (size_t c = 0; c < channel_count; ++c) {
+        channels[c] = sensor.getChannel(c);
+        outputs[c] = smoothed[c];
+    }
+    GaussianSmoother(kernel_size, sigma, resource_).smooth(channels, outputs, mode);
+    for (size_t c = 0; c < channel_count; ++c) {
+        sensor.setChannel(c, std::move(smoothed[c]));
+    }
+}
+
+template<typename Value>
+void SensorDataProcessor::resampleData(const CompactWKV<Value> &base_sensor,
+                                       IWKV *resampled_sensor,
+                                       int target_rate,
+                                       double start_time_s,
+                                       double end_time_s,
+                                       InterpolationMode mode)
+{
+    TWIICE_METRICS_SCOPE("SensorDataProcessor::resampleData");
+    if (mode == InterpolationMode::CardinalSpline || mode == InterpolationMode::Polyphase) {
+        const size_t halo = mode == InterpolationMode::Polyphase ? 0 : resample_halo_samples;
+        resampleData(WKVView::window(base_sensor, start_time_s, end_time_s).widened(halo, halo),
+                     resampled_sensor,
+                     target_rate,
+                     start_time_s,
+                     end_time_s,
+                     mode);
+        return;
+    }
+    if (!resampled_sensor) {
+        std::cerr << "Invalid sensor pointers provided." << std::endl;
+        return;
+    }
+    if (target_rate <= 0) {
+        std::cerr << "Invalid target rate provided." << std::endl;
+        return;
+    }
+    if (end_time_s < start_time_s) {
+        std::cerr << "Invalid start time or end time provided." << std::endl;
+        return;
+    }
+
+    const auto [first, count] = compactWindow(base_sensor,
+                                              start_time_s,
+                                              end_time_s,
+                                              resample_halo_samples,
+                                              resample_halo_samples);
+    if (count == 0) {
+        std::cerr << "Sensor data is empty." << std::endl;
+        return;
+    }
+    TWIICE_METRICS_SAMPLES(count);
+    TWIICE_METRICS_BYTES(count * (sizeof(uint32_t) + sizeof(Value)));
+    const TimestampColumn<uint32_t> timestamps = base_sensor.timestampColumn(first, count);
+    const ValueColumn<Value> data = base_sensor.valueColumn(first, count);
+
+    const uint64_t start_time_us = base_sensor.getStartTimeUs()
+                                   + static_cast<uint64_t>(start_time_s * 1e6);
+    const uint64_t end_time_us = start_time_us
+                                 + static_cast<uint64_t>((end_time_s - start_time_s) * 1e6);
+    const auto step_us = static_cast<uint64_t>(std::llround(1e6 / target_rate));
+    const size_t output_count = LocalResampler::outputSize(timestamps, start_time_us, end_time_us, step_us);
+
+    std::pmr::vector<uint64_t> resampled_timestamps(output_count, resource_);
+    std::pmr::vector<double> resampled_data(output_count, resource_);
+    LocalResampler(mode).resample(timestamps,
+                                  data,
+                                  start_time_us,
+                                  end_time_us,
+                                  step_us,
+                                  resampled_timestamps,
+                                  resampled_data);
+    resampled_sensor->addDataPoints(resampled_timestamps, resampled_data);
+
+    resampled_sensor->setStartTimeUs(base_sensor.getStartTimeUs());
+    resampled_sensor->setFrequency(target_rate);
+    emit resampled_sensor->sensorDataReady(*resampled_sensor);
+}
+
+template<typename Value>
+void SensorDataProcessor::findPeaks(const CompactWKV<Value> &sensor,
+                                    double start_time_s,
+                                    double end_time_s,
+                                    const PeakCriteria &criteria,
+                                    PeakSeries &peaks)
+{
+    TWIICE_METRICS_SCOPE("SensorDataProcessor::findPeaks");
+    const auto [first, count] = compactWindow(sensor, start_time_s, end_time_s, 1, 1);
+    TWIICE_METRICS_SAMPLES(count);
+    TWIICE_METRICS_BYTES(count * (sizeof(uint32_t) + sizeof(Value)));
+    PeakDetector(criteria, resource_).detect(sensor.timestampColumn(first, count),
+                                             sensor.valueColumn(first, count),
+                                             peaks);
+    emit peaksDataReady(sensor, peaks.timestamps_us, sensor.getName());
+}
+
+template<typename Value>
+void SensorDataProcessor::calculateVelocityAndAcceleration(const CompactWKV<Value> &sensor,
+                                                           double start_time_s,
+                                                           double end_time_s,
+                                                           DerivativeSeries &derivatives)
+{
+    TWIICE_METRICS_SCOPE("SensorDataProcessor::calculateVelocityAndAcceleration");
+    const auto [first, count] = compactWindow(sensor, start_time_s, end_time_s, 1, 1);
+    TWIICE_METRICS_SAMPLES(count);
+    TWIICE_METRICS_BYTES(count * (sizeof(uint32_t) + sizeof(Value)));
+    DerivativeEngine::compute(sensor.timestampColumn(first, count),
+                              sensor.valueColumn(first, count),
+                              derivatives);
+}
+
+template<typename Value>
+void SensorDataProcessor::applyGaussianSmoothing(const CompactWKV<Value> &sensor,
+                                                 std::vector<double> &smoothed,
+                                                 int kernel_size,
+                                                 double sigma,
+                                                 SmoothingMode mode)
+{
+    TWIICE_METRICS_SCOPE("SensorDataProcessor::applyGaussianSmoothing");
+    TWIICE_METRICS_SAMPLES(sensor.size());
+    TWIICE_METRICS_BYTES(sensor.size() * sizeof(Value));
+    smoothed.resize(sensor.size());
+    GaussianSmoother(kernel_size, sigma, resource_).smooth(sensor.valueColumn(), smoothed, mode);
+}
+
+#define TWIICE_COMPACT_PROCESSING(Value) \
+    template void SensorDataProcessor::resampleData(const CompactWKV<Value> &, \
+                                                    IWKV *, \
+                                                    int, \
+                                                    double, \
+                                                    double, \
+                                                    InterpolationMode); \
+    template void SensorDataProcessor::findPeaks(const CompactWKV<Value> &, \
+                                                 double, \
+                                                 double, \
+                                                 const PeakCriteria &, \
+                                                 PeakSeries &); \
+    template void SensorDataProcessor::calculateVelocityAndAcceleration(const CompactWKV<Value> &, \
+                                                                        double, \
+                                                                        double, \
+                                                                        DerivativeSeries &); \
+    template void SensorDataProcessor::applyGaussianSmoothing(const CompactWKV<Value> &, \
+                                                              std::vector<double> &, \
+                                                              int, \
+                                                              double, \
+                                                              SmoothingMode);
+
+TWIICE_COMPACT_PROCESSING(float)
+TWIICE_COMPACT_PROCESSING(double)
+TWIICE_COMPACT_PROCESSING(int16_t)
+
+#undef TWIICE_COMPACT_PROCESSING
@@ -1,32 +1,260 @@
-#ifndef SENSORDATAPROCESSOR_H
-#define SENSORDATAPROCESSOR_H
-
-#include <QObject>
-#include "iwkv.h"
-
-class SensorDataProcessor : public QObject
-{
-    Q_OBJECT
-
-public:
-    void resampleData(IWKV *base_sensor,
-                      IWKV *resampled_sensor,
-                      int target_rate,
-                      double start_time_s,
-                      double end_time_s);
-
-    std::vector<uint64_t> findPeaks(const IWKV *sensor, double start_time_s, double end_time_s);
-    void calculateVelocityAndAcceleration(const IWKV &sensor,
-                                          double start_time_s,
-                                          double end_time_s,
-                                          std::vector<double> &velocities,
-                                          std::vector<double> &accelerations);
-    void applyGaussianSmoothing(IWKV &sensor, int kernel_size, double sigma);
-
-signals:
-    void peaksDataReady(const IWKV &sensor,
-                        const std::vector<uint64_t> &peaks,
-                        const std::string &sensorId);
-};
-
-#endif // SENSORDATAPROCESSOR_H
+#ifndef SENSORDATAPROCESSOR_H
+#define SENSORDATAPROCESSOR_H
+
+#include <QObject>
+#include "compactwkv.h"
+#include "derivativeengine.h"
+#include "gaussiansmoother.h"
+#include "iwkv.h"
+#include "localresampler.h"
+#include "multichannelwkv.h"
+#include "peakdetector.h"
+#include "wkvview.h"
+
+/**
+ * @brief The SensorDataProcessor class implements the processing stages of the sensor pipeline.
+ *
+ * Every stage has two entry points: one taking a sensor and a time window in seconds, and one
+ * taking a WKVView. The sensor overloads resolve the window once with a binary search and forward
+ * to the view overloads, so the work of every stage scales with the window, not the recording.
+ *
+ * The CompactWKV overloads run the same kernels on the compact columns in place, decoding the
+ * samples on the fly instead of going through the decoded IWKV accessors. The MultiChannelWKV
+ * overloads process every channel of a series against its shared timestamps.
+ *
+ * The temporaries of the stages are allocated from a memory resource, typically a PipelineArena
+ * reset between runs, so a pipeline processing many short windows does not go through the heap.
+ * Outputs owned by the caller (DerivativeSeries, PeakSeries, smoothed vectors) are reused with
+ * their capacity.
+ *
+ * The stages keep no state between calls, so a processor can run stages on several threads at
+ * once as long as its memory resource is thread safe, as the default resource is.
+ */
+class SensorDataProcessor : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Construct a new SensorDataProcessor.
+     *
+     * @param resource Resource of the temporaries of the stages, which must outlive the processor.
+     */
+    explicit SensorDataProcessor(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+    std::pmr::memory_resource *getMemoryResource() const;
+
+    void resampleData(IWKV *base_sensor,
+                      IWKV *resampled_sensor,
+                      int target_rate,
+                      double start_time_s,
+                      double end_time_s,
+                      InterpolationMode mode = InterpolationMode::Cubic);
+
+    /**
+     * @brief Resample the samples of a view at target_rate over [start_time_s, end_time_s].
+     *
+     * The interpolator is only built over the view, which should cover the requested window.
+     * The local modes use the real sample timestamps and write the output in a single block.
+     *
+     * The Polyphase mode takes the view as uniform at the frequency of its sensor and low-pass
+     * filters it before changing its rate (see PolyphaseResampler), with a cost proportional to
+     * the output samples. Its grid starts at the first sample of the view, and the samples around
+     * the view are not used: the sensor overload does not widen the window. Sample times are
+     * derived from their indices, so on a jittered sensor the grid drifts from the real
+     * timestamps; use a local mode there.
+     */
+    void resampleData(const WKVView &base_window,
+                      IWKV *resampled_sensor,
+                      int target_rate,
+                      double start_time_s,
+                      double end_time_s,
+                      InterpolationMode mode = InterpolationMode::Cubic);
+
+    std::vector<uint64_t> findPeaks(const IWKV *sensor, double start_time_s, double end_time_s);
+
+    /**
+     * @brief Find the local maxima of a view.
+     *
+     * The first and last samples of the view are only used as neighbours, so callers that want
+     * peaks on the edges of a window should widen the view by one sample on each side.
+     */
+    std::vector<uint64_t> findPeaks(const WKVView &window);
+
+    /**
+     * @brief Find the peaks of [start_time_s, end_time_s] matching criteria, with their properties.
+     *
+     * Indices in peaks are relative to the window widened by one sample on each side.
+     */
+    void findPeaks(const IWKV *sensor,
+                   double start_time_s,
+                   double end_time_s,
+                   const PeakCriteria &criteria,
+                   PeakSeries &peaks);
+
+    /**
+     * @brief Find the peaks of a view matching criteria, with their properties.
+     *
+     * Prominences and widths only see the samples of the view. Emits peaksDataReady with the
+     * timestamps of the peaks.
+     */
+    void findPeaks(const WKVView &window, const PeakCriteria &criteria, PeakSeries &peaks);
+
+    /**
+     * @brief Compute the velocity and acceleration at every sample of [start_time_s, end_time_s].
+     */
+    void calculateVelocityAndAcceleration(const IWKV &sensor,
+                                          double start_time_s,
+                                          double end_time_s,
+                                          DerivativeSeries &derivatives);
+
+    /**
+     * @brief Compute the velocity and acceleration at the interior samples of a view.
+     *
+     * See DerivativeEngine: the edges of the view are only used as neighbours.
+     */
+    void calculateVelocityAndAcceleration(const WKVView &window, DerivativeSeries &derivatives);
+
+    /**
+     * @brief Smooth the data of a sensor in place.
+     *
+     * The kernel size must be odd and positive, and sigma positive.
+     */
+    void applyGaussianSmoothing(IWKV &sensor,
+                                int kernel_size,
+                                double sigma,
+                                SmoothingMode mode = SmoothingMode::Direct);
+
+    /**
+     * @brief Smooth the data of a view into smoothed, which is resized to the view size.
+     *
+     * @throws std::invalid_argument if the kernel size or sigma is invalid, see GaussianSmoother.
+     */
+    void applyGaussianSmoothing(const WKVView &window,
+                                std::vector<double> &smoothed,
+                                int kernel_size,
+                                double sigma,
+                                SmoothingMode mode = SmoothingMode::Direct);
+
+    /**
+     * @brief Smooth the data of a view into smoothed, which must hold as many samples as the view.
+     *
+     * @throws std::invalid_argument if the sizes differ, or if the kernel size or sigma is invalid.
+     */
+    void applyGaussianSmoothing(const WKVView &window,
+                                std::span<double> smoothed,
+                                int kernel_size,
+                                double sigma,
+                                SmoothingMode mode = SmoothingMode::Direct);
+
+    /**
+     * @brief Resample [start_time_s, end_time_s] of a compact sensor with a local interpolation.
+     *
+     * CardinalSpline is not a local mode and goes through the decoded columns of the sensor.
+     */
+    template<typename Value>
+    void resampleData(const CompactWKV<Value> &base_sensor,
+                      IWKV *resampled_sensor,
+                      int target_rate,
+                      double start_time_s,
+                      double end_time_s,
+                      InterpolationMode mode = InterpolationMode::Cubic);
+
+    /**
+     * @brief Find the peaks of [start_time_s, end_time_s] of a compact sensor matching criteria.
+     *
+     * Indices in peaks are relative to the window widened by one sample on each side. Emits
+     * peaksDataReady with the timestamps of the peaks.
+     */
+    template<typename Value>
+    void findPeaks(const CompactWKV<Value> &sensor,
+                   double start_time_s,
+                   double end_time_s,
+                   const PeakCriteria &criteria,
+                   PeakSeries &peaks);
+
+    /**
+     * @brief Compute the velocity and acceleration at every sample of [start_time_s, end_time_s]
+     * of a compact sensor.
+     */
+    template<typename Value>
+    void calculateVelocityAndAcceleration(const CompactWKV<Value> &sensor,
+                                          double start_time_s,
+                                          double end_time_s,
+                                          DerivativeSeries &derivatives);
+
+    /**
+     * @brief Smooth the data of a compact sensor into smoothed, which is resized to its size.
+     *
+     * @throws std::invalid_argument if the kernel size or sigma is invalid, see GaussianSmoother.
+     */
+    template<typename Value>
+    void applyGaussianSmoothing(const CompactWKV<Value> &sensor,
+                                std::vector<double> &smoothed,
+                                int kernel_size,
+                                double sigma,
+                                SmoothingMode mode = SmoothingMode::Direct);
+
+    /**
+     * @brief Resample every channel of [start_time_s, end_time_s] at target_rate in one pass.
+     *
+     * The samples are appended to resampled_sensor, like resampleData() on an IWKV.
+     *
+     * @throws std::invalid_argument if the channel counts differ or the mode is the cardinal
+     * spline or the polyphase filter, which are only available on single-channel series.
+     */
+    void resampleData(const MultiChannelWKV &base_sensor,
+                      MultiChannelWKV &resampled_sensor,
+                      int target_rate,
+                      double start_time_s,
+                      double end_time_s,
+                      InterpolationMode mode = InterpolationMode::Cubic);
+
+    /**
+     * @brief Find the peaks of every channel of [start_time_s, end_time_s] matching criteria,
+     * scanning the channels together (see PeakDetector).
+     *
+     * @param peaks Output, resized to one series per channel. Indices are relative to the window
+     * widened by one sample on each side.
+     */
+    void findPeaks(const MultiChannelWKV &sensor,
+                   double start_time_s,
+                   double end_time_s,
+                   const PeakCriteria &criteria,
+                   std::vector<PeakSeries> &peaks);
+
+    /**
+     * @brief Compute the velocity and acceleration of every channel at every sample of
+     * [start_time_s, end_time_s].
+     */
+    void calculateVelocityAndAcceleration(const MultiChannelWKV &sensor,
+                                          double start_time_s,
+                                          double end_time_s,
+                                          MultiChannelDerivatives &derivatives);
+
+    /**
+     * @brief Smooth every channel of a series in one pass over the samples (see GaussianSmoother).
+     *
+     * @throws std::invalid_argument if the kernel size or sigma is invalid, see GaussianSmoother.
+     */
+    void applyGaussianSmoothing(MultiChannelWKV &sensor,
+                                int kernel_size,
+                                double sigma,
+                                SmoothingMode mode = SmoothingMode::Direct);
+
+private:
+    std::pmr::memory_resource *resource_;      ///< Resource of the temporaries.
+
+    void resamplePolyphase(const WKVView &base_window,
+                           IWKV *resampled_sensor,
+                           int target_rate,
+                           uint64_t start_time_us,
+                           uint64_t end_time_us);
+
+signals:
+    void peaksDataReady(const IWKV &sensor,
+                        const std::vector<uint64_t> &peaks,
+                        const std::string &sensorId);
+};
+
+#endif // SENSORDATAPROCESSOR_H
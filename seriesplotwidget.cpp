@@ -0,0 +1,465 @@
+#include "seriesplotwidget.h"
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPolygonF>
+#include <QWheelEvent>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr size_t pyramid_base = 64;          ///< Samples per block on the first pyramid level.
+constexpr int axis_tick_count = 10;
+constexpr double zoom_step = 1.25;           ///< Zoom factor per wheel notch.
+
+/**
+ * @brief Merge an envelope into another one.
+ */
+template<typename Envelope>
+void merge(Envelope &into, const Envelope &other)
+{
+    if (other.min < into.min) {
+        into.min = other.min;
+        into.min_index = other.min_index;
+    }
+    if (other.max > into.max) {
+        into.max = other.max;
+        into.max_index = other.max_index;
+    }
+}
+
+} // namespace
+
+SeriesPlotWidget::SeriesPlotWidget(QWidget *parent)
+    : QWidget(parent)
+    , origin_us_(0)
+    , decimation_(Decimation::MinMax)
+    , x_title_("Time (s)")
+    , y_title_("Value")
+    , view_start_s_(0.0)
+    , view_end_s_(0.0)
+    , view_set_(false)
+{
+    setMinimumSize(200, 150);
+    setBackgroundRole(QPalette::Base);
+    setAutoFillBackground(true);
+}
+
+void SeriesPlotWidget::setSeries(std::span<const uint64_t> timestamps_us,
+                                 std::span<const double> values,
+                                 uint64_t origin_us)
+{
+    if (timestamps_us.data() != owned_timestamps_.data()) {
+        owned_timestamps_.clear();
+        owned_timestamps_.shrink_to_fit();
+    }
+    if (values.data() != owned_values_.data()) {
+        owned_values_.clear();
+        owned_values_.shrink_to_fit();
+    }
+    const size_t size = std::min(timestamps_us.size(), values.size());
+    timestamps_us_ = timestamps_us.first(size);
+    values_ = values.first(size);
+    origin_us_ = origin_us;
+    rebuildPyramid();
+    update();
+}
+
+void SeriesPlotWidget::setSeries(std::span<const uint64_t> timestamps_us,
+                                 std::vector<double> &&values,
+                                 uint64_t origin_us)
+{
+    owned_values_ = std::move(values);
+    setSeries(timestamps_us, std::span<const double>(owned_values_), origin_us);
+}
+
+void SeriesPlotWidget::setSeries(std::vector<uint64_t> &&timestamps_us,
+                                 std::vector<double> &&values,
+                                 uint64_t origin_us)
+{
+    owned_timestamps_ = std::move(timestamps_us);
+    owned_values_ = std::move(values);
+    setSeries(std::span<const uint64_t>(owned_timestamps_),
+              std::span<const double>(owned_values_),
+              origin_us);
+}
+
+void SeriesPlotWidget::appendSamples(std::span<const uint64_t> timestamps_us,
+                                     std::span<const double> values,
+                                     size_t dropped)
+{
+    // The widget owns the series it appends to, without the samples past the plotted ones
+    if (owned_timestamps_.data() != timestamps_us_.data())
+        owned_timestamps_.assign(timestamps_us_.begin(), timestamps_us_.end());
+    if (owned_values_.data() != values_.data())
+        owned_values_.assign(values_.begin(), values_.end());
+    owned_timestamps_.resize(timestamps_us_.size());
+    owned_values_.resize(values_.size());
+
+    const size_t size = std::min(timestamps_us.size(), values.size());
+    owned_timestamps_.insert(owned_timestamps_.end(), timestamps_us.begin(), timestamps_us.begin() + size);
+    owned_values_.insert(owned_values_.end(), values.begin(), values.begin() + size);
+    dropped = std::min(dropped, owned_values_.size());
+    owned_timestamps_.erase(owned_timestamps_.begin(), owned_timestamps_.begin() + dropped);
+    owned_values_.erase(owned_values_.begin(), owned_values_.begin() + dropped);
+
+    timestamps_us_ = owned_timestamps_;
+    values_ = owned_values_;
+    if (dropped > 0)
+        rebuildPyramid();
+    else
+        extendPyramid();
+    update();
+}
+
+size_t SeriesPlotWidget::sampleCount() const
+{
+    return values_.size();
+}
+
+void SeriesPlotWidget::setMarkers(std::vector<double> times_s)
+{
+    markers_s_ = std::move(times_s);
+    update();
+}
+
+void SeriesPlotWidget::setDecimation(Decimation decimation)
+{
+    decimation_ = decimation;
+    update();
+}
+
+void SeriesPlotWidget::setTitle(const QString &title)
+{
+    title_ = title;
+    update();
+}
+
+void SeriesPlotWidget::setAxisTitles(const QString &x_title, const QString &y_title)
+{
+    x_title_ = x_title;
+    y_title_ = y_title;
+    update();
+}
+
+void SeriesPlotWidget::resetView()
+{
+    view_set_ = false;
+    update();
+}
+
+void SeriesPlotWidget::rebuildPyramid()
+{
+    levels_.clear();
+    extendPyramid();
+}
+
+/**
+ * @brief Reduce the samples not yet in the pyramid.
+ *
+ * Level 0 reduces blocks of pyramid_base samples, each next level merges pairs of blocks. A block
+ * is only reduced once it is complete, so the blocks already in the pyramid stay valid when
+ * samples are appended and only the new ones are computed.
+ */
+void SeriesPlotWidget::extendPyramid()
+{
+    const size_t blocks = values_.size() / pyramid_base;
+    if (blocks == 0)
+        return;
+    if (levels_.empty())
+        levels_.emplace_back();
+
+    std::vector<Envelope> &base = levels_.front();
+    base.reserve(blocks);
+    for (size_t b = base.size(); b < blocks; ++b) {
+        const size_t first = b * pyramid_base;
+        Envelope e{values_[first], values_[first], first, first};
+        for (size_t i = first + 1; i < first + pyramid_base; ++i)
+            merge(e, Envelope{values_[i], values_[i], i, i});
+        base.push_back(e);
+    }
+
+    for (size_t l = 1; levels_[l - 1].size() >= 2; ++l) {
+        if (l == levels_.size())
+            levels_.emplace_back();
+        const std::vector<Envelope> &below = levels_[l - 1];
+        std::vector<Envelope> &level = levels_[l];
+        for (size_t b = level.size(); b < below.size() / 2; ++b) {
+            Envelope e = below[2 * b];
+            merge(e, below[2 * b + 1]);
+            level.push_back(e);
+        }
+    }
+}
+
+SeriesPlotWidget::Envelope SeriesPlotWidget::envelope(size_t first, size_t last) const
+{
+    Envelope result{std::numeric_limits<double>::infinity(),
+                    -std::numeric_limits<double>::infinity(),
+                    first,
+                    first};
+
+    // Walk from first to last taking the largest aligned block that fits: at most
+    // 2 * pyramid_base raw samples plus two blocks per level are visited.
+    while (first < last) {
+        if (first % pyramid_base != 0 || first + pyramid_base > last || levels_.empty()) {
+            merge(result, Envelope{values_[first], values_[first], first, first});
+            ++first;
+            continue;
+        }
+
+        size_t level = 0;
+        while (level + 1 < levels_.size()) {
+            const size_t block = pyramid_base << (level + 1);
+            if (first % block != 0 || first + block > last)
+                break;
+            ++level;
+        }
+
+        const size_t block = pyramid_base << level;
+        merge(result, levels_[level][first / block]);
+        first += block;
+    }
+    return result;
+}
+
+double SeriesPlotWidget::timeAt(size_t index) const
+{
+    return (static_cast<double>(timestamps_us_[index]) - static_cast<double>(origin_us_)) / 1e6;
+}
+
+void SeriesPlotWidget::viewRange(double &start_s, double &end_s) const
+{
+    if (view_set_) {
+        start_s = view_start_s_;
+        end_s = view_end_s_;
+    } else if (!timestamps_us_.empty()) {
+        start_s = timeAt(0);
+        end_s = timeAt(timestamps_us_.size() - 1);
+    } else {
+        start_s = 0.0;
+        end_s = 1.0;
+    }
+    if (end_s <= start_s)
+        end_s = start_s + 1e-6;
+}
+
+QRectF SeriesPlotWidget::plotArea() const
+{
+    const QFontMetrics metrics = fontMetrics();
+    const double left = metrics.horizontalAdvance("-0.000e+00") + 2 * metrics.height();
+    const double top = 2 * metrics.height();
+    const double bottom = 3 * metrics.height();
+    const double right = metrics.horizontalAdvance("0000.0");
+    return QRectF(left, top, std::max(1.0, width() - left - right),
+                  std::max(1.0, height() - top - bottom));
+}
+
+void SeriesPlotWidget::paintEvent(QPaintEvent *)
+{
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    const QRectF area = plotArea();
+    const QFontMetrics metrics = fontMetrics();
+    double start_s, end_s;
+    viewRange(start_s, end_s);
+
+    // Visible samples, with one neighbour on each side so the line reaches the borders
+    size_t first = 0, last = 0;
+    if (!timestamps_us_.empty()) {
+        const double origin = static_cast<double>(origin_us_);
+        const auto lower = static_cast<uint64_t>(std::max(0.0, origin + start_s * 1e6));
+        const auto upper = static_cast<uint64_t>(std::max(0.0, origin + end_s * 1e6));
+        first = std::lower_bound(timestamps_us_.begin(), timestamps_us_.end(), lower)
+                - timestamps_us_.begin();
+        last = std::upper_bound(timestamps_us_.begin(), timestamps_us_.end(), upper)
+               - timestamps_us_.begin();
+        first = first > 0 ? first - 1 : 0;
+        last = std::min(last + 1, timestamps_us_.size());
+    }
+
+    // Reduce the visible samples to at most two points per pixel column
+    const int columns = std::max(1, static_cast<int>(area.width()));
+    std::vector<Envelope> envelopes;
+    if (last > first) {
+        if (last - first <= 2 * static_cast<size_t>(columns)) {
+            envelopes.reserve(last - first);
+            for (size_t i = first; i < last; ++i)
+                envelopes.push_back(Envelope{values_[i], values_[i], i, i});
+        } else {
+            envelopes.reserve(columns);
+            const double seconds_per_column = (end_s - start_s) / columns;
+            size_t begin = first;
+            for (int c = 0; c < columns && begin < last; ++c) {
+                const double column_end_s = start_s + (c + 1) * seconds_per_column;
+                const auto column_end_us = static_cast<uint64_t>(
+                    std::max(0.0, static_cast<double>(origin_us_) + column_end_s * 1e6));
+                size_t end = c + 1 == columns
+                                 ? last
+                                 : std::upper_bound(timestamps_us_.begin() + begin,
+                                                    timestamps_us_.begin() + last,
+                                                    column_end_us)
+                                       - timestamps_us_.begin();
+                if (end > begin)
+                    envelopes.push_back(envelope(begin, end));
+                begin = end;
+            }
+        }
+    }
+
+    double y_min = std::numeric_limits<double>::infinity();
+    double y_max = -std::numeric_limits<double>::infinity();
+    for (const Envelope &e : envelopes) {
+        y_min = std::min(y_min, e.min);
+        y_max = std::max(y_max, e.max);
+    }
+    if (!std::isfinite(y_min) || !std::isfinite(y_max)) {
+        y_min = 0.0;
+        y_max = 1.0;
+    }
+    const double y_margin = y_max > y_min ? 0.05 * (y_max - y_min) : 0.5;
+    y_min -= y_margin;
+    y_max += y_margin;
+
+    auto toX = [&](double t) { return area.left() + (t - start_s) / (end_s - start_s) * area.width(); };
+    auto toY = [&](double v) { return area.bottom() - (v - y_min) / (y_max - y_min) * area.height(); };
+
+    // Axes, grid and labels
+    painter.setPen(QPen(palette().mid().color(), 0, Qt::DotLine));
+    for (int i = 0; i <= axis_tick_count; ++i) {
+        const double fx = static_cast<double>(i) / axis_tick_count;
+        const double x = area.left() + fx * area.width();
+        const double y = area.bottom() - fx * area.height();
+        painter.drawLine(QPointF(x, area.top()), QPointF(x, area.bottom()));
+        painter.drawLine(QPointF(area.left(), y), QPointF(area.right(), y));
+    }
+    painter.setPen(palette().text().color());
+    painter.drawRect(area);
+    for (int i = 0; i <= axis_tick_count; ++i) {
+        const double fx = static_cast<double>(i) / axis_tick_count;
+        const QString x_label = QString::number(start_s + fx * (end_s - start_s), 'g', 4);
+        const QString y_label = QString::number(y_min + fx * (y_max - y_min), 'g', 4);
+        const double x = area.left() + fx * area.width();
+        const double y = area.bottom() - fx * area.height();
+        painter.drawText(QPointF(x - metrics.horizontalAdvance(x_label) / 2.0,
+                                 area.bottom() + metrics.height()),
+                         x_label);
+        painter.drawText(QPointF(area.left() - metrics.horizontalAdvance(y_label) - 4,
+                                 y + metrics.ascent() / 2.0),
+                         y_label);
+    }
+    painter.drawText(QPointF(area.center().x() - metrics.horizontalAdvance(x_title_) / 2.0,
+                             area.bottom() + 2.5 * metrics.height()),
+                     x_title_);
+    painter.save();
+    painter.translate(metrics.height(), area.center().y() + metrics.horizontalAdvance(y_title_) / 2.0);
+    painter.rotate(-90);
+    painter.drawText(QPointF(0, 0), y_title_);
+    painter.restore();
+    painter.drawText(QPointF(area.center().x() - metrics.horizontalAdvance(title_) / 2.0,
+                             1.5 * metrics.height()),
+                     title_);
+
+    // Series
+    QPolygonF line;
+    if (decimation_ == Decimation::Lttb && envelopes.size() > 2) {
+        // Largest-Triangle-Three-Buckets, one bucket per column: keep the column extremum that
+        // forms the largest triangle with the previously kept point and the next column's mean.
+        line.reserve(static_cast<int>(envelopes.size()));
+        size_t kept = envelopes.front().min_index;
+        line.append(QPointF(toX(timeAt(kept)), toY(values_[kept])));
+        for (size_t c = 1; c + 1 < envelopes.size(); ++c) {
+            const Envelope &next = envelopes[c + 1];
+            const double next_t = (timeAt(next.min_index) + timeAt(next.max_index)) / 2.0;
+            const double next_v = (next.min + next.max) / 2.0;
+            const double kept_t = timeAt(kept), kept_v = values_[kept];
+            auto area2 = [&](size_t i) {
+                return std::abs((kept_t - next_t) * (values_[i] - kept_v)
+                                - (kept_t - timeAt(i)) * (next_v - kept_v));
+            };
+            const Envelope &e = envelopes[c];
+            kept = area2(e.min_index) >= area2(e.max_index) ? e.min_index : e.max_index;
+            line.append(QPointF(toX(timeAt(kept)), toY(values_[kept])));
+        }
+        kept = envelopes.back().max_index;
+        line.append(QPointF(toX(timeAt(kept)), toY(values_[kept])));
+    } else {
+        // Min and max of each column, in time order so consecutive columns join up
+        line.reserve(static_cast<int>(2 * envelopes.size()));
+        for (const Envelope &e : envelopes) {
+            const size_t a = std::min(e.min_index, e.max_index);
+            const size_t b = std::max(e.min_index, e.max_index);
+            line.append(QPointF(toX(timeAt(a)), toY(values_[a])));
+            if (b != a)
+                line.append(QPointF(toX(timeAt(b)), toY(values_[b])));
+        }
+    }
+
+    painter.setClipRect(area);
+    painter.setPen(QPen(palette().highlight().color(), 1.0));
+    painter.drawPolyline(line);
+
+    painter.setPen(QPen(Qt::red, 1.0, Qt::DashLine));
+    for (double t : markers_s_) {
+        if (t < start_s || t > end_s)
+            continue;
+        const double x = toX(t);
+        painter.drawLine(QPointF(x, area.top()), QPointF(x, area.bottom()));
+    }
+}
+
+void SeriesPlotWidget::wheelEvent(QWheelEvent *event)
+{
+    double start_s, end_s;
+    viewRange(start_s, end_s);
+
+    // Zoom around the time under the cursor
+    const QRectF area = plotArea();
+    const double fx = std::clamp((event->position().x() - area.left()) / area.width(), 0.0, 1.0);
+    const double pivot_s = start_s + fx * (end_s - start_s);
+    const double notches = event->angleDelta().y() / 120.0;
+    const double factor = std::pow(zoom_step, -notches);
+
+    view_start_s_ = pivot_s - (pivot_s - start_s) * factor;
+    view_end_s_ = pivot_s + (end_s - pivot_s) * factor;
+    view_set_ = true;
+    update();
+    event->accept();
+}
+
+void SeriesPlotWidget::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton) {
+        drag_origin_ = event->position();
+        event->accept();
+    } else {
+        QWidget::mousePressEvent(event);
+    }
+}
+
+void SeriesPlotWidget::mouseMoveEvent(QMouseEvent *event)
+{
+    if (!(event->buttons() & Qt::LeftButton)) {
+        QWidget::mouseMoveEvent(event);
+        return;
+    }
+
+    double start_s, end_s;
+    viewRange(start_s, end_s);
+    const double shift_s = (drag_origin_.x() - event->position().x()) / plotArea().width()
+                           * (end_s - start_s);
+    view_start_s_ = start_s + shift_s;
+    view_end_s_ = end_s + shift_s;
+    view_set_ = true;
+    drag_origin_ = event->position();
+    update();
+    event->accept();
+}
+
+void SeriesPlotWidget::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    resetView();
+    event->accept();
+}
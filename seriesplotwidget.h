@@ -0,0 +1,138 @@
+#ifndef SERIESPLOTWIDGET_H
+#define SERIESPLOTWIDGET_H
+
+#include <QPointF>
+#include <QString>
+#include <QWidget>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @brief The SeriesPlotWidget class draws a time series straight from its timestamp/data spans.
+ *
+ * Instead of copying every sample into a chart series, the widget builds a min/max pyramid once
+ * per series and, on every repaint, asks it for the envelope of the samples falling in each pixel
+ * column. A repaint therefore costs O(width * log n) whatever the number of samples, which keeps
+ * zooming (mouse wheel) and panning (drag, double-click to reset) interactive on 100M samples.
+ *
+ * The widget does not own the series unless it is given the values by rvalue or samples are
+ * appended to it: the spans must stay valid until the next call to setSeries() or appendSamples().
+ */
+class SeriesPlotWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief How the samples of a pixel column are reduced.
+     */
+    enum class Decimation {
+        /// Draw the min and max of every column, which never hides a spike.
+        MinMax,
+        /// Largest-Triangle-Three-Buckets over the column envelopes: one point per column,
+        /// picked to preserve the visual shape. Lighter, but may drop isolated spikes.
+        Lttb,
+    };
+
+    explicit SeriesPlotWidget(QWidget *parent = nullptr);
+
+    /**
+     * @brief Plot a series without copying it.
+     *
+     * @param timestamps_us Sorted timestamps in microseconds.
+     * @param values Values corresponding to the timestamps.
+     * @param origin_us Timestamp shown as 0 s on the time axis.
+     */
+    void setSeries(std::span<const uint64_t> timestamps_us,
+                   std::span<const double> values,
+                   uint64_t origin_us);
+
+    /**
+     * @brief Plot a series whose values are owned by the widget, e.g. derived velocities.
+     */
+    void setSeries(std::span<const uint64_t> timestamps_us,
+                   std::vector<double> &&values,
+                   uint64_t origin_us);
+
+    /**
+     * @brief Plot a series entirely owned by the widget.
+     */
+    void setSeries(std::vector<uint64_t> &&timestamps_us,
+                   std::vector<double> &&values,
+                   uint64_t origin_us);
+
+    /**
+     * @brief Append samples to the series, e.g. a copy of a block appended to a sensor.
+     *
+     * The widget copies the samples, so the caller may reuse them. Only the appended samples are
+     * reduced into the min/max pyramid, so the cost is proportional to them, unless samples are
+     * dropped, which rebuilds it. A series read in place is copied on the first append. The origin
+     * is kept.
+     *
+     * @param dropped Number of the oldest samples removed after appending, e.g. by a ring buffer.
+     */
+    void appendSamples(std::span<const uint64_t> timestamps_us,
+                       std::span<const double> values,
+                       size_t dropped = 0);
+
+    /**
+     * @brief Get the number of samples plotted.
+     */
+    size_t sampleCount() const;
+
+    /**
+     * @brief Draw vertical markers at the given times, in seconds from the origin.
+     */
+    void setMarkers(std::vector<double> times_s);
+
+    void setDecimation(Decimation decimation);
+    void setTitle(const QString &title);
+    void setAxisTitles(const QString &x_title, const QString &y_title);
+
+    /**
+     * @brief Show the whole series again after zooming or panning.
+     */
+    void resetView();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+
+private:
+    /**
+     * @brief Min and max of a range of samples, with the index they were found at.
+     */
+    struct Envelope
+    {
+        double min;
+        double max;
+        size_t min_index;
+        size_t max_index;
+    };
+
+    std::span<const uint64_t> timestamps_us_;  ///< Timestamps of the plotted series.
+    std::span<const double> values_;           ///< Values of the plotted series.
+    std::vector<uint64_t> owned_timestamps_;   ///< Storage when the widget owns the timestamps.
+    std::vector<double> owned_values_;         ///< Storage when the widget owns the values.
+    uint64_t origin_us_;                       ///< Timestamp shown as 0 s.
+    std::vector<std::vector<Envelope>> levels_; ///< Envelopes of blocks of 64 << level samples.
+    std::vector<double> markers_s_;            ///< Marker times in seconds.
+    Decimation decimation_;
+    QString title_, x_title_, y_title_;
+    double view_start_s_, view_end_s_;         ///< Visible time range in seconds.
+    bool view_set_;                            ///< Whether the user zoomed or panned.
+    QPointF drag_origin_;                      ///< Mouse position of the last drag event.
+
+    void rebuildPyramid();
+    void extendPyramid();
+    Envelope envelope(size_t first, size_t last) const;
+    double timeAt(size_t index) const;
+    void viewRange(double &start_s, double &end_s) const;
+    QRectF plotArea() const;
+};
+
+#endif // SERIESPLOTWIDGET_H
@@ -0,0 +1,146 @@
+#ifndef SHAREDCOLUMN_H
+#define SHAREDCOLUMN_H
+
+#include <atomic>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/**
+ * @brief Column of samples shared between series, copied on the first write.
+ *
+ * Copying a SharedColumn only takes a reference on its buffer, so a series derived from another
+ * one (a copy, or a copy whose data column is then replaced) costs nothing for the columns it does
+ * not modify. A buffer is never written while it is shared: the first write detaches the column by
+ * copying the buffer, so views taken on the other owners stay valid and unchanged.
+ *
+ * A column adopts std::vector and std::pmr::vector buffers without copying them. The buffers it
+ * allocates itself, and the reference counts, come from its memory resource, which like for a pmr
+ * container is not changed by assignment. Columns only share buffers within one resource.
+ *
+ * Sharing is thread-safe like std::shared_ptr: different columns sharing a buffer can be copied,
+ * read, written and destroyed from different threads.
+ */
+template<typename T>
+class SharedColumn
+{
+public:
+    explicit SharedColumn(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : resource_(resource)
+    {}
+
+    SharedColumn(const SharedColumn &other) = default;
+
+    /**
+     * @brief Share the buffer of another column, keeping the memory resource of this one.
+     *
+     * The buffer is only shared if both columns use the same resource. Otherwise it is copied into
+     * the resource of this column, which must not depend on the lifetime of the other resource,
+     * e.g. an arena that is reset.
+     */
+    SharedColumn &operator=(const SharedColumn &other)
+    {
+        if (this == &other) {
+            return *this;
+        }
+        if (resource_ == other.resource_ || !other.buffer_) {
+            buffer_ = other.buffer_;
+        } else {
+            const std::span<const T> values = other.view();
+            adopt(std::pmr::vector<T>(values.begin(), values.end(), resource_));
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Replace the samples of the column, without copying them.
+     */
+    SharedColumn &operator=(std::vector<T> &&values)
+    {
+        adopt(std::move(values));
+        return *this;
+    }
+
+    /**
+     * @brief Replace the samples of the column, without copying them. The buffer keeps the memory
+     * resource it was allocated from.
+     */
+    SharedColumn &operator=(std::pmr::vector<T> &&values)
+    {
+        adopt(std::move(values));
+        return *this;
+    }
+
+    /**
+     * @brief Get a view on the samples, invalidated by the next write to this column.
+     */
+    std::span<const T> view() const
+    {
+        if (!buffer_) {
+            return {};
+        }
+        return std::visit([](const auto &values) { return std::span<const T>(values); }, *buffer_);
+    }
+
+    operator std::span<const T>() const { return view(); }
+
+    size_t size() const { return view().size(); }
+    bool empty() const { return size() == 0; }
+
+    std::pmr::memory_resource *resource() const { return resource_; }
+
+    void push_back(const T &value)
+    {
+        std::visit([&](auto &values) { values.push_back(value); }, edit());
+    }
+
+    void append(std::span<const T> values)
+    {
+        std::visit([&](auto &column) { column.insert(column.end(), values.begin(), values.end()); },
+                   edit());
+    }
+
+    /**
+     * @brief Check whether both columns use the same buffer.
+     */
+    bool sharesWith(const SharedColumn &other) const
+    {
+        return buffer_ && buffer_ == other.buffer_;
+    }
+
+private:
+    /// Samples, owned by either kind of vector so both can be adopted.
+    using Buffer = std::variant<std::vector<T>, std::pmr::vector<T>>;
+
+    std::shared_ptr<Buffer> buffer_;       ///< Samples, shared by every copy until written.
+    std::pmr::memory_resource *resource_;  ///< Resource of the buffers and counts allocated here.
+
+    template<typename Vector>
+    void adopt(Vector &&values)
+    {
+        buffer_ = std::allocate_shared<Buffer>(std::pmr::polymorphic_allocator<Buffer>(resource_),
+                                               std::move(values));
+    }
+
+    /**
+     * @brief Get the samples for modification, copying them first if the buffer is shared.
+     */
+    Buffer &edit()
+    {
+        if (!buffer_) {
+            adopt(std::pmr::vector<T>(resource_));
+        } else if (buffer_.use_count() > 1) {
+            const std::span<const T> values = view();
+            adopt(std::pmr::vector<T>(values.begin(), values.end(), resource_));
+        } else {
+            // Sole owner: order the reads of owners that just released the buffer before the writes
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        return *buffer_;
+    }
+};
+
+#endif // SHAREDCOLUMN_H
@@ -0,0 +1,220 @@
+#include "spectralanalyzer.h"
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+
+namespace {
+
+// Tasks the segments of a window are split into, whatever the number of workers. A fixed
+// partition keeps the Welch summation order, and therefore its result, independent of the
+// thread count, and gives stealing enough tasks to balance a few tens of workers.
+constexpr size_t segment_task_count = 64;
+
+/**
+ * @brief Sampling rate of a uniformly sampled window, from its first and last timestamps.
+ */
+double sampleRate(const WKVView &window)
+{
+    const std::span<const uint64_t> timestamps = window.getTimestampsUs();
+    const uint64_t span_us = timestamps.back() - timestamps.front();
+    if (span_us == 0) {
+        throw std::invalid_argument("SpectralAnalyzer: the window timestamps do not advance.");
+    }
+    return (timestamps.size() - 1) * 1e6 / span_us;
+}
+
+} // namespace
+
+SpectralAnalyzer::SpectralAnalyzer(const SpectralOptions &options, size_t thread_count)
+    : options_(options)
+    , hop_(0)
+    , window_power_(0.0)
+    , pool_(thread_count)
+{
+    if (options_.segment_samples < 4) {
+        throw std::invalid_argument("SpectralAnalyzer: segments need at least 4 samples.");
+    }
+    if (!(options_.overlap >= 0.0 && options_.overlap < 1.0)) {
+        throw std::invalid_argument("SpectralAnalyzer: the overlap must be in [0, 1).");
+    }
+    if (!(options_.min_cadence_hz >= 0.0)) {
+        throw std::invalid_argument("SpectralAnalyzer: the cadence band must start at a non-negative frequency.");
+    }
+    if (!(options_.max_cadence_hz > options_.min_cadence_hz)) {
+        throw std::invalid_argument("SpectralAnalyzer: the cadence band is empty.");
+    }
+    plan_ = RealFft::plan(options_.segment_samples);
+    const size_t segment = options_.segment_samples;
+    hop_ = std::max<size_t>(std::lround(segment * (1.0 - options_.overlap)), 1);
+
+    // Periodic Hann window, whose 50% overlapped copies sum to a constant
+    window_.resize(segment);
+    for (size_t i = 0; i < segment; ++i) {
+        window_[i] = 0.5 - 0.5 * std::cos(2.0 * std::numbers::pi * i / segment);
+        window_power_ += window_[i] * window_[i];
+    }
+
+    scratch_.resize(pool_.threadCount());
+    for (Scratch &scratch : scratch_) {
+        scratch.frame.resize(segment);
+        scratch.spectrum.resize(binCount());
+        scratch.power.resize(binCount());
+    }
+}
+
+const SpectralOptions &SpectralAnalyzer::getOptions() const
+{
+    return options_;
+}
+
+const std::vector<double> &SpectralAnalyzer::getWindow() const
+{
+    return window_;
+}
+
+size_t SpectralAnalyzer::segmentCount(size_t samples) const
+{
+    if (samples < options_.segment_samples) {
+        return 0;
+    }
+    return (samples - options_.segment_samples) / hop_ + 1;
+}
+
+size_t SpectralAnalyzer::binCount() const
+{
+    return options_.segment_samples / 2 + 1;
+}
+
+/**
+ * @brief Number of tasks the segments are split into, which does not depend on the workers.
+ */
+size_t SpectralAnalyzer::taskCount(size_t segments) const
+{
+    return std::min(segments, segment_task_count);
+}
+
+/**
+ * @brief Compute the power of every bin of a segment into the power buffer of a worker.
+ */
+void SpectralAnalyzer::segmentPower(std::span<const double> values, size_t segment, Scratch &scratch) const
+{
+    const size_t size = options_.segment_samples;
+    const double *samples = values.data() + segment * hop_;
+    double mean = 0.0;
+    for (size_t i = 0; i < size; ++i) {
+        mean += samples[i];
+    }
+    mean /= size;
+    for (size_t i = 0; i < size; ++i) {
+        scratch.frame[i] = (samples[i] - mean) * window_[i];
+    }
+    plan_->forward(scratch.frame, scratch.spectrum);
+    for (size_t k = 0; k < scratch.power.size(); ++k) {
+        scratch.power[k] = std::norm(scratch.spectrum[k]);
+    }
+}
+
+/**
+ * @brief Split the segments into contiguous ranges, one task each, and run them on the pool.
+ */
+void SpectralAnalyzer::forEachSegmentRange(size_t segments, const SegmentRange &process)
+{
+    const size_t tasks = taskCount(segments);
+    std::vector<WorkStealingPool::Task> work;
+    work.reserve(tasks);
+    for (size_t task = 0; task < tasks; ++task) {
+        const size_t first = segments * task / tasks;
+        const size_t last = segments * (task + 1) / tasks;
+        work.push_back([&, task, first, last](size_t worker) { process(task, first, last, scratch_[worker]); });
+    }
+    pool_.run(std::move(work));
+}
+
+void SpectralAnalyzer::welch(const WKVView &window, PowerSpectrum &spectrum)
+{
+    const size_t segments = segmentCount(window.size());
+    const size_t bins = binCount();
+    spectrum.segment_count = segments;
+    spectrum.resolution_hz = 0.0;
+    spectrum.density.assign(segments > 0 ? bins : 0, 0.0);
+    if (segments == 0) {
+        return;
+    }
+    const double rate = sampleRate(window);
+    spectrum.resolution_hz = rate / options_.segment_samples;
+
+    const std::span<const double> values = window.getData();
+    task_power_.assign(taskCount(segments) * bins, 0.0);
+    forEachSegmentRange(segments, [&](size_t task, size_t first, size_t last, Scratch &scratch) {
+        double *sum = task_power_.data() + task * bins;
+        for (size_t segment = first; segment < last; ++segment) {
+            segmentPower(values, segment, scratch);
+            for (size_t k = 0; k < bins; ++k) {
+                sum[k] += scratch.power[k];
+            }
+        }
+    });
+
+    // Tasks are added in order, whichever worker ran them
+    for (size_t offset = 0; offset < task_power_.size(); offset += bins) {
+        for (size_t k = 0; k < bins; ++k) {
+            spectrum.density[k] += task_power_[offset + k];
+        }
+    }
+    // One-sided density: every bin but DC and Nyquist also holds the negative frequencies
+    const double scale = 1.0 / (rate * window_power_ * segments);
+    for (size_t k = 0; k < bins; ++k) {
+        spectrum.density[k] *= (k == 0 || k == bins - 1) ? scale : 2.0 * scale;
+    }
+}
+
+void SpectralAnalyzer::cadence(const WKVView &window, CadenceSeries &cadence)
+{
+    const size_t segments = segmentCount(window.size());
+    cadence.timestamps_us.resize(segments);
+    cadence.cadence_hz.resize(segments);
+    cadence.band_fraction.resize(segments);
+    if (segments == 0) {
+        return;
+    }
+    const double resolution_hz = sampleRate(window) / options_.segment_samples;
+    const size_t last_bin = binCount() - 1;
+    const size_t band_first = std::max<size_t>(std::ceil(options_.min_cadence_hz / resolution_hz), 1);
+    const size_t band_last = std::min<size_t>(std::floor(options_.max_cadence_hz / resolution_hz), last_bin);
+    if (band_first > band_last) {
+        throw std::invalid_argument("SpectralAnalyzer: the cadence band holds no frequency bin, use "
+                                    "longer segments.");
+    }
+
+    const std::span<const uint64_t> timestamps = window.getTimestampsUs();
+    const std::span<const double> values = window.getData();
+    forEachSegmentRange(segments, [&](size_t, size_t first, size_t last, Scratch &scratch) {
+        const double *power = scratch.power.data();
+        for (size_t segment = first; segment < last; ++segment) {
+            segmentPower(values, segment, scratch);
+            size_t peak = band_first;
+            double band_power = 0.0;
+            for (size_t k = band_first; k <= band_last; ++k) {
+                band_power += power[k];
+                if (power[k] > power[peak]) {
+                    peak = k;
+                }
+            }
+
+            // A Hann-windowed tone is close to a Gaussian, i.e. a parabola in log power
+            double offset = 0.0;
+            if (peak > 0 && peak < last_bin && power[peak - 1] > 0.0 && power[peak + 1] > 0.0) {
+                const double before = std::log(power[peak - 1]), centre = std::log(power[peak]),
+                             after = std::log(power[peak + 1]);
+                const double curvature = before - 2.0 * centre + after;
+                if (curvature < 0.0) {
+                    offset = 0.5 * (before - after) / curvature;
+                }
+            }
+            cadence.timestamps_us[segment] = timestamps[segment * hop_ + options_.segment_samples / 2];
+            cadence.cadence_hz[segment] = (peak + offset) * resolution_hz;
+            cadence.band_fraction[segment] = band_power > 0.0 ? power[peak] / band_power : 0.0;
+        }
+    });
+}
@@ -0,0 +1,163 @@
+#ifndef SPECTRALANALYZER_H
+#define SPECTRALANALYZER_H
+
+#include "realfft.h"
+#include "workstealingpool.h"
+#include "wkvview.h"
+#include <complex>
+#include <functional>
+#include <memory>
+#include <new>
+#include <vector>
+
+/**
+ * @brief Allocator of buffers starting on a cache line, so the frames streamed through the FFT
+ * do not straddle lines and two workers never share one.
+ */
+template<typename T>
+struct CacheAlignedAllocator
+{
+    using value_type = T;
+    static constexpr std::align_val_t alignment{64};
+
+    CacheAlignedAllocator() = default;
+    template<typename U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U> &)
+    {}
+
+    T *allocate(size_t count) { return static_cast<T *>(::operator new(count * sizeof(T), alignment)); }
+    void deallocate(T *pointer, size_t) { ::operator delete(pointer, alignment); }
+
+    template<typename U>
+    bool operator==(const CacheAlignedAllocator<U> &) const
+    {
+        return true;
+    }
+};
+
+template<typename T>
+using AlignedVector = std::vector<T, CacheAlignedAllocator<T>>;
+
+/**
+ * @brief Parameters of a SpectralAnalyzer.
+ */
+struct SpectralOptions
+{
+    size_t segment_samples = 1024; ///< Samples per segment (FFT frame), a power of two.
+    double overlap = 0.5;          ///< Fraction of a segment shared with the next one, in [0, 1).
+    double min_cadence_hz = 0.3;   ///< Lowest frequency searched for the cadence.
+    double max_cadence_hz = 3.0;   ///< Highest frequency searched for the cadence.
+};
+
+/**
+ * @brief One-sided power spectral density of a window.
+ */
+struct PowerSpectrum
+{
+    double resolution_hz = 0.0;  ///< Spacing of the bins; bin k is at k * resolution_hz.
+    size_t segment_count = 0;    ///< Segments averaged.
+    std::vector<double> density; ///< Power spectral density, in units^2 / Hz.
+};
+
+/**
+ * @brief Dominant frequency of every frame of a sliding STFT.
+ */
+struct CadenceSeries
+{
+    std::vector<uint64_t> timestamps_us; ///< Timestamp of the centre sample of every frame.
+    std::vector<double> cadence_hz;      ///< Dominant frequency in the cadence band (x 60 for per minute).
+    std::vector<double> band_fraction;   ///< Share of the band power in the peak bin, low without a clear rhythm.
+
+    size_t size() const { return timestamps_us.size(); }
+    bool empty() const { return timestamps_us.empty(); }
+};
+
+/**
+ * @brief The SpectralAnalyzer class estimates the spectrum of a series and tracks its dominant
+ * frequency, e.g. the gait cadence and its drift over a session.
+ *
+ * Both analyses cut the window into segments of segment_samples, hop apart, remove the mean of
+ * every segment, apply a Hann window and take its real FFT:
+ * - welch() averages the power of the segments into a power spectral density;
+ * - cadence() is a sliding STFT keeping, per frame, the frequency of the strongest bin within
+ *   [min_cadence_hz, max_cadence_hz], refined between bins with a parabola on the log power.
+ *
+ * The windows should be uniformly sampled, e.g. resampled; the sampling rate is taken from their
+ * timestamps. The FFT plan (shared through RealFft::plan()) and the window table are computed at
+ * construction. Segments are processed in parallel on a WorkStealingPool, with per-worker frame
+ * and spectrum buffers aligned on cache lines. All buffers are kept across calls and outputs
+ * reuse their capacity, so analysing multi-hour sessions does not allocate per frame. The
+ * segments are split into a fixed number of tasks whatever the number of workers, and Welch sums
+ * are accumulated per task and added in task order, so results depend on neither the scheduling
+ * nor the thread count.
+ *
+ * An analyzer is not thread-safe.
+ */
+class SpectralAnalyzer
+{
+public:
+    /**
+     * @brief Construct a new SpectralAnalyzer.
+     *
+     * @param thread_count Number of workers, the number of hardware threads when 0.
+     * @throws std::invalid_argument if the segment size is not a power of two of at least 4, the
+     * overlap is outside [0, 1), the cadence band starts below 0 Hz or is empty.
+     */
+    explicit SpectralAnalyzer(const SpectralOptions &options = {}, size_t thread_count = 0);
+
+    const SpectralOptions &getOptions() const;
+
+    /**
+     * @brief Get the Hann window applied to every segment.
+     */
+    const std::vector<double> &getWindow() const;
+
+    /**
+     * @brief Get the number of segments of a window of the given size.
+     */
+    size_t segmentCount(size_t samples) const;
+
+    /**
+     * @brief Estimate the power spectral density of a window with Welch's method.
+     *
+     * @param spectrum Output, with no bins if the window is shorter than a segment.
+     */
+    void welch(const WKVView &window, PowerSpectrum &spectrum);
+
+    /**
+     * @brief Track the dominant frequency of a window, one value per segment.
+     *
+     * @param cadence Output, empty if the window is shorter than a segment.
+     * @throws std::invalid_argument if the cadence band does not contain a frequency bin at the
+     * sampling rate of the window.
+     */
+    void cadence(const WKVView &window, CadenceSeries &cadence);
+
+private:
+    /// Buffers of a worker.
+    struct Scratch
+    {
+        AlignedVector<double> frame;                  ///< Windowed segment.
+        AlignedVector<std::complex<double>> spectrum; ///< Its transform.
+        AlignedVector<double> power;                  ///< Squared magnitude of every bin.
+    };
+
+    /// Processes the segments [first, last) as task number task.
+    using SegmentRange = std::function<void(size_t task, size_t first, size_t last, Scratch &scratch)>;
+
+    SpectralOptions options_;             ///< Segment and band parameters.
+    size_t hop_;                          ///< Samples between the starts of two segments.
+    std::shared_ptr<const RealFft> plan_; ///< FFT of a segment.
+    std::vector<double> window_;          ///< Hann window, one weight per segment sample.
+    double window_power_;                 ///< Sum of the squared weights.
+    WorkStealingPool pool_;               ///< Workers processing the segments.
+    std::vector<Scratch> scratch_;        ///< Buffers of every worker.
+    AlignedVector<double> task_power_;    ///< Power summed by every Welch task.
+
+    size_t binCount() const;
+    size_t taskCount(size_t segments) const;
+    void segmentPower(std::span<const double> values, size_t segment, Scratch &scratch) const;
+    void forEachSegmentRange(size_t segments, const SegmentRange &process);
+};
+
+#endif // SPECTRALANALYZER_H
@@ -0,0 +1,260 @@
+#include "streamaligner.h"
+#include "realfft.h"
+#include "wkvview.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+
+namespace {
+
+// Samples kept on each side of a stream window so the cubic stencils are not shifted inwards.
+constexpr size_t align_halo_samples = 2;
+
+// Largest lag accepted by align(), about 30 000 years, so a lag in microseconds added to a
+// timestamp stays within int64_t.
+constexpr double max_align_lag_s = 1e12;
+
+/**
+ * @brief Get the signal of a stream that is cross-correlated, on its uniform grid.
+ */
+void lagSignal(std::span<const double> values, LagSignal kind, double sample_rate, std::vector<double> &signal)
+{
+    signal.assign(values.begin(), values.end());
+    const size_t size = values.size();
+    if (kind == LagSignal::Value || size < 3) {
+        return;
+    }
+    // Central differences, one-sided on the edges
+    signal[0] = (values[1] - values[0]) * sample_rate;
+    for (size_t i = 1; i + 1 < size; ++i) {
+        signal[i] = (values[i + 1] - values[i - 1]) * 0.5 * sample_rate;
+    }
+    signal[size - 1] = (values[size - 1] - values[size - 2]) * sample_rate;
+}
+
+/**
+ * @brief Cross-correlates signals against one reference, whose spectrum is computed once.
+ *
+ * The signals are zero-padded to a power of two of at least n + max_lag samples, so the circular
+ * correlation of the FFT equals the linear one for every lag searched.
+ */
+class LagCorrelator
+{
+public:
+    LagCorrelator(std::span<const double> reference, double sample_rate, double max_lag_s)
+        : size_(reference.size())
+        , sample_rate_(sample_rate)
+        , max_lag_(std::min<long>(std::max(std::lround(max_lag_s * sample_rate), 0L),
+                                  static_cast<long>(size_) - 1))
+        , plan_(RealFft::plan(RealFft::paddedSize(size_ + max_lag_)))
+        , padded_(plan_->size())
+        , reference_spectrum_(plan_->size() / 2 + 1)
+        , spectrum_(plan_->size() / 2 + 1)
+        , scratch_(plan_->scratchSize())
+    {
+        reference_norm_ = centre(reference);
+        plan_->forward(padded_, reference_spectrum_);
+    }
+
+    LagEstimate estimate(std::span<const double> signal)
+    {
+        if (signal.size() != size_) {
+            throw std::invalid_argument("StreamAligner: the signals to correlate differ in size.");
+        }
+        const double norm = reference_norm_ * centre(signal);
+        plan_->forward(padded_, spectrum_);
+        for (size_t k = 0; k < spectrum_.size(); ++k) {
+            spectrum_[k] *= std::conj(reference_spectrum_[k]);
+        }
+        plan_->inverse(spectrum_, padded_, scratch_);
+
+        // padded_[lag] holds the correlation at lag >= 0, padded_[n - lag] the one at -lag
+        const long padded_size = static_cast<long>(padded_.size());
+        auto at = [&](long lag) { return padded_[lag >= 0 ? lag : padded_size + lag]; };
+        long best = 0;
+        for (long lag = -max_lag_; lag <= max_lag_; ++lag) {
+            if (at(lag) > at(best)) {
+                best = lag;
+            }
+        }
+
+        // Vertex of the parabola through the peak and its neighbours
+        double offset = 0.0;
+        if (best > -max_lag_ && best < max_lag_) {
+            const double before = at(best - 1), peak = at(best), after = at(best + 1);
+            const double curvature = before - 2.0 * peak + after;
+            if (curvature < 0.0) {
+                offset = 0.5 * (before - after) / curvature;
+            }
+        }
+        return {(best + offset) / sample_rate_, norm > 0.0 ? at(best) / norm : 0.0};
+    }
+
+private:
+    size_t size_;                                          ///< Samples of every signal.
+    double sample_rate_;                                   ///< Rate of the signals, in Hertz.
+    long max_lag_;                                         ///< Largest lag searched, in samples.
+    std::shared_ptr<const RealFft> plan_;                  ///< Plan of the padded size.
+    std::vector<double> padded_;                           ///< Zero-padded signal, then correlation.
+    std::vector<std::complex<double>> reference_spectrum_; ///< Spectrum of the centred reference.
+    std::vector<std::complex<double>> spectrum_;           ///< Spectrum of the current signal.
+    std::vector<std::complex<double>> scratch_;            ///< Working memory of the inverse FFT.
+    double reference_norm_ = 0.0;                          ///< Norm of the centred reference.
+
+    /**
+     * @brief Copy the values minus their mean into padded_, zero-padded.
+     *
+     * @return double The norm of the centred values.
+     */
+    double centre(std::span<const double> values)
+    {
+        double mean = 0.0;
+        for (const double value : values) {
+            mean += value;
+        }
+        mean /= std::max<size_t>(values.size(), 1);
+
+        double energy = 0.0;
+        for (size_t i = 0; i < values.size(); ++i) {
+            padded_[i] = values[i] - mean;
+            energy += padded_[i] * padded_[i];
+        }
+        std::fill(padded_.begin() + values.size(), padded_.end(), 0.0);
+        return std::sqrt(energy);
+    }
+};
+
+} // namespace
+
+StreamAligner::StreamAligner(int target_rate, InterpolationMode mode)
+    : target_rate_(target_rate)
+    , mode_(mode)
+{
+    if (target_rate_ <= 0) {
+        throw std::invalid_argument("StreamAligner: the target rate must be positive.");
+    }
+    if (mode_ == InterpolationMode::CardinalSpline || mode_ == InterpolationMode::Polyphase) {
+        throw std::invalid_argument("StreamAligner: the cardinal spline and polyphase modes assume "
+                                    "uniform samples, use a local interpolation.");
+    }
+}
+
+size_t StreamAligner::addStream(const IWKV &sensor, LagSignal lag_signal)
+{
+    streams_.push_back({&sensor, lag_signal});
+    return streams_.size() - 1;
+}
+
+size_t StreamAligner::streamCount() const
+{
+    return streams_.size();
+}
+
+MultiChannelWKV StreamAligner::align(std::span<const double> lags_s,
+                                     std::pmr::memory_resource *resource) const
+{
+    if (streams_.empty()) {
+        throw std::invalid_argument("StreamAligner: there is no stream to align.");
+    }
+    if (!lags_s.empty() && lags_s.size() != streams_.size()) {
+        throw std::invalid_argument("StreamAligner: expected one lag per stream.");
+    }
+
+    std::vector<std::string> names;
+    std::string unit = streams_.front().sensor->getUnit();
+    for (const Stream &stream : streams_) {
+        names.push_back(stream.sensor->getName());
+        if (stream.sensor->getUnit() != unit) {
+            unit.clear();
+        }
+    }
+    MultiChannelWKV aligned("aligned", unit, names, resource);
+    aligned.setStartTimeUs(streams_.front().sensor->getStartTimeUs());
+
+    // Span every stream covers once shifted back by its lag
+    std::vector<int64_t> lags_us(streams_.size(), 0);
+    int64_t first_us = 0, last_us = INT64_MAX;
+    for (size_t k = 0; k < streams_.size(); ++k) {
+        const std::span<const uint64_t> timestamps = streams_[k].sensor->getTimestampsUs();
+        if (timestamps.empty()) {
+            return aligned;
+        }
+        if (!lags_s.empty() && !(std::abs(lags_s[k]) < max_align_lag_s)) {
+            throw std::invalid_argument("StreamAligner: the lags must be finite and shorter than 1e12 s.");
+        }
+        lags_us[k] = lags_s.empty() ? 0 : std::llround(lags_s[k] * 1e6);
+        first_us = std::max(first_us, static_cast<int64_t>(timestamps.front()) - lags_us[k]);
+        last_us = std::min(last_us, static_cast<int64_t>(timestamps.back()) - lags_us[k]);
+    }
+    if (first_us > last_us) {
+        return aligned;
+    }
+    const auto step_us = static_cast<uint64_t>(std::llround(1e6 / target_rate_));
+    const size_t count = static_cast<size_t>(last_us - first_us) / step_us + 1;
+
+    std::pmr::vector<uint64_t> timestamps(count, resource);
+    for (size_t i = 0; i < count; ++i) {
+        timestamps[i] = static_cast<uint64_t>(first_us) + i * step_us;
+    }
+
+    // Every stream is read once, by the cursor of the resampler, on the shifted grid
+    const LocalResampler resampler(mode_);
+    std::pmr::vector<uint64_t> stream_timestamps(count, resource);
+    for (size_t k = 0; k < streams_.size(); ++k) {
+        // A stream shifted to before time 0 has no unsigned timestamp to read it from
+        if (first_us + lags_us[k] < 0) {
+            throw std::invalid_argument("StreamAligner: a lag shifts the common grid of a stream "
+                                        "before time 0.");
+        }
+        const uint64_t start_us = static_cast<uint64_t>(first_us + lags_us[k]);
+        const uint64_t end_us = start_us + (count - 1) * step_us;
+        const WKVView window = WKVView::windowUs(*streams_[k].sensor, start_us, end_us)
+                                   .widened(align_halo_samples, align_halo_samples);
+        std::pmr::vector<double> values(count, resource);
+        resampler.resample(window, start_us, end_us, step_us, stream_timestamps, values);
+        aligned.setChannel(k, std::move(values));
+    }
+    aligned.setTimestampsUs(std::move(timestamps));
+    return aligned;
+}
+
+/**
+ * @brief Estimate the lags on the common grid, against the spectrum of the reference computed once.
+ */
+std::vector<LagEstimate> StreamAligner::estimateLags(double max_lag_s, size_t reference) const
+{
+    if (reference >= streams_.size()) {
+        throw std::out_of_range("StreamAligner: no stream " + std::to_string(reference) + ".");
+    }
+    const MultiChannelWKV aligned = align();
+    if (aligned.size() < 3) {
+        throw std::runtime_error("StreamAligner: the streams share less than three samples.");
+    }
+
+    std::vector<double> signal;
+    lagSignal(aligned.getChannel(reference), streams_[reference].lag_signal, target_rate_, signal);
+    LagCorrelator correlator(signal, target_rate_, max_lag_s);
+
+    std::vector<LagEstimate> lags(streams_.size());
+    for (size_t k = 0; k < streams_.size(); ++k) {
+        if (k == reference) {
+            lags[k] = {0.0, 1.0};
+            continue;
+        }
+        lagSignal(aligned.getChannel(k), streams_[k].lag_signal, target_rate_, signal);
+        lags[k] = correlator.estimate(signal);
+    }
+    return lags;
+}
+
+LagEstimate StreamAligner::crossCorrelate(std::span<const double> reference,
+                                          std::span<const double> signal,
+                                          double sample_rate,
+                                          double max_lag_s)
+{
+    if (reference.empty()) {
+        return {};
+    }
+    return LagCorrelator(reference, sample_rate, max_lag_s).estimate(signal);
+}
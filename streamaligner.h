@@ -0,0 +1,118 @@
+#ifndef STREAMALIGNER_H
+#define STREAMALIGNER_H
+
+#include "iwkv.h"
+#include "localresampler.h"
+#include "multichannelwkv.h"
+#include <span>
+#include <vector>
+
+/**
+ * @brief Selects the signal of a stream that is cross-correlated to estimate its lag.
+ */
+enum class LagSignal {
+    /// The values of the stream.
+    Value,
+    /// The first derivative of the values, e.g. to match a hip angle against an angular velocity.
+    Derivative,
+};
+
+/**
+ * @brief Estimated delay of a stream behind a reference stream.
+ */
+struct LagEstimate
+{
+    double lag_s = 0.0;       ///< Delay in seconds: an event of the reference at t is at t + lag_s in the stream.
+    double correlation = 0.0; ///< Normalised cross-correlation at that delay, in [-1, 1].
+};
+
+/**
+ * @brief The StreamAligner class brings K sensors sampled at different rates, with independent
+ * jitter and clock offsets, onto a common time base.
+ *
+ * align() merge-joins the streams onto a uniform grid at the target rate covering the time span
+ * they share: the grid is computed once, then every stream is read once, in order, with the
+ * cursor of a LocalResampler. The result is a MultiChannelWKV with one channel per stream.
+ *
+ * estimateLags() measures the clock offset of every stream against a reference by
+ * cross-correlating them on the common grid. The correlation is computed with real FFTs in
+ * O(n log n) per stream instead of O(n * lags) for a direct search; the spectrum of the
+ * reference is computed once for all streams and the FFT plans are cached (see RealFft), so a
+ * session with many sensors is synchronised in a few transforms per sensor. The lags found are
+ * then given to align() to correct the offsets.
+ */
+class StreamAligner
+{
+public:
+    /**
+     * @brief Construct an aligner without streams.
+     *
+     * @param target_rate Rate of the common time base, in Hertz.
+     * @param mode Interpolation of the streams, a local mode.
+     * @throws std::invalid_argument if the rate is not positive or the mode is not local.
+     */
+    explicit StreamAligner(int target_rate, InterpolationMode mode = InterpolationMode::Cubic);
+
+    /**
+     * @brief Add a stream, which must outlive the aligner.
+     *
+     * @param lag_signal Signal of the stream used by estimateLags().
+     * @return size_t The index of the stream, which is its channel in align().
+     */
+    size_t addStream(const IWKV &sensor, LagSignal lag_signal = LagSignal::Value);
+
+    size_t streamCount() const;
+
+    /**
+     * @brief Resample every stream onto the common time base, correcting their lags.
+     *
+     * The grid covers the span where every stream, shifted back by its lag, has samples. Stream k
+     * is read at t + lags_s[k] for the grid instant t, so the timestamps are those of a stream
+     * with no lag. The series is empty if the streams do not overlap.
+     *
+     * @param lags_s The lag of every stream, or empty for none.
+     * @param resource Memory resource of the columns of the result.
+     * @throws std::invalid_argument if there are no streams, lags_s is neither empty nor one
+     * lag per stream, a lag is not finite, or a lag moves the grid of a stream before time 0.
+     */
+    MultiChannelWKV align(std::span<const double> lags_s = {},
+                          std::pmr::memory_resource *resource = std::pmr::get_default_resource()) const;
+
+    /**
+     * @brief Estimate the lag of every stream behind a reference stream.
+     *
+     * @param max_lag_s Largest lag searched, in either direction.
+     * @param reference Index of the reference stream, whose lag is 0.
+     * @return std::vector<LagEstimate> One estimate per stream.
+     * @throws std::out_of_range if the reference does not exist.
+     * @throws std::runtime_error if the streams share less than three grid samples.
+     */
+    std::vector<LagEstimate> estimateLags(double max_lag_s, size_t reference = 0) const;
+
+    /**
+     * @brief Estimate the lag of a signal behind a reference sampled on the same grid.
+     *
+     * The signals are centred, the cross-correlation is computed with a zero-padded real FFT and
+     * its peak within +/- max_lag_s is refined to a fraction of sample with a parabola.
+     *
+     * @param sample_rate Sampling rate of both signals, in Hertz.
+     * @throws std::invalid_argument if the signals differ in size.
+     */
+    static LagEstimate crossCorrelate(std::span<const double> reference,
+                                      std::span<const double> signal,
+                                      double sample_rate,
+                                      double max_lag_s);
+
+private:
+    struct Stream
+    {
+        const IWKV *sensor;
+        LagSignal lag_signal;
+    };
+
+    int target_rate_;             ///< Rate of the common time base, in Hertz.
+    InterpolationMode mode_;      ///< Interpolation of the streams.
+    std::vector<Stream> streams_; ///< Streams in the order they were added.
+};
+
+#endif // STREAMALIGNER_H
@@ -0,0 +1,229 @@
+#include "streamingprocessor.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// Samples carried over by the resampler: the whole four-point stencil, so that the last interval
+// is still interpolated with it when the stream is flushed.
+constexpr size_t resampler_history = 4;
+
+// Grid step of a rate, checked before it is divided by.
+uint64_t stepUs(int target_rate)
+{
+    if (target_rate <= 0)
+        throw std::invalid_argument("StreamingResampler: target rate must be positive.");
+    return static_cast<uint64_t>(std::llround(1e6 / target_rate));
+}
+
+} // namespace
+
+StreamingResampler::StreamingResampler(uint64_t start_time_us, int target_rate, InterpolationMode mode)
+    : resampler_(mode)
+    , step_us_(stepUs(target_rate))
+    , next_time_us_(start_time_us)
+{}
+
+void StreamingResampler::push(std::span<const uint64_t> timestamps_us, std::span<const double> values)
+{
+    timestamps_us_.insert(timestamps_us_.end(), timestamps_us.begin(), timestamps_us.end());
+    data_.insert(data_.end(), values.begin(), values.end());
+
+    // An instant is final once the stencil around it is complete, i.e. up to the second to last
+    // sample. Before that, wait for enough samples to use the full stencil.
+    if (timestamps_us_.size() <= resampler_history) {
+        output_.timestamps_us.clear();
+        output_.values.clear();
+        return;
+    }
+    emitUntil(timestamps_us_[timestamps_us_.size() - 2]);
+
+    const size_t drop = timestamps_us_.size() - resampler_history;
+    timestamps_us_.erase(timestamps_us_.begin(), timestamps_us_.begin() + drop);
+    data_.erase(data_.begin(), data_.begin() + drop);
+}
+
+void StreamingResampler::flush()
+{
+    if (timestamps_us_.empty()) {
+        output_.timestamps_us.clear();
+        output_.values.clear();
+        return;
+    }
+    emitUntil(timestamps_us_.back());
+    timestamps_us_.clear();
+    data_.clear();
+}
+
+void StreamingResampler::emitUntil(uint64_t end_time_us)
+{
+    const size_t count = LocalResampler::outputSize(timestamps_us_, next_time_us_, end_time_us, step_us_);
+    output_.timestamps_us.resize(count);
+    output_.values.resize(count);
+    resampler_.resample(timestamps_us_,
+                        data_,
+                        next_time_us_,
+                        end_time_us,
+                        step_us_,
+                        output_.timestamps_us,
+                        output_.values);
+    if (count > 0) {
+        next_time_us_ = output_.timestamps_us.back() + step_us_;
+    }
+}
+
+const SampleBlock &StreamingResampler::output() const
+{
+    return output_;
+}
+
+StreamingGaussianSmoother::StreamingGaussianSmoother(int kernel_size, double sigma)
+    : smoother_(kernel_size, sigma)
+    , half_size_(kernel_size / 2)
+    , data_(kernel_size / 2, 0.0) // Zero padding before the first sample
+{}
+
+void StreamingGaussianSmoother::push(std::span<const uint64_t> timestamps_us,
+                                     std::span<const double> values,
+                                     bool last)
+{
+    timestamps_us_.insert(timestamps_us_.end(), timestamps_us.begin(), timestamps_us.end());
+    data_.insert(data_.end(), values.begin(), values.end());
+    if (last) {
+        data_.insert(data_.end(), half_size_, 0.0); // Zero padding after the last sample
+    }
+
+    // data_ holds half_size_ samples of context followed by the pending samples. A pending sample
+    // can be emitted once the half_size_ samples after it are known.
+    const size_t known_after = data_.size() - half_size_;
+    const size_t count = known_after > half_size_ ? std::min(known_after - half_size_, timestamps_us_.size())
+                                                  : 0;
+
+    smoothed_.resize(data_.size());
+    smoother_.smooth(data_, smoothed_, SmoothingMode::Fir);
+
+    output_.timestamps_us.assign(timestamps_us_.begin(), timestamps_us_.begin() + count);
+    output_.values.assign(smoothed_.begin() + half_size_, smoothed_.begin() + half_size_ + count);
+
+    timestamps_us_.erase(timestamps_us_.begin(), timestamps_us_.begin() + count);
+    data_.erase(data_.begin(), data_.begin() + count);
+    if (last) {
+        timestamps_us_.clear();
+        data_.assign(half_size_, 0.0);
+    }
+}
+
+const SampleBlock &StreamingGaussianSmoother::output() const
+{
+    return output_;
+}
+
+void StreamingDifferentiator::push(std::span<const uint64_t> timestamps_us,
+                                   std::span<const double> values)
+{
+    // Only the samples the engine keeps enter the context, so its last two samples are those the
+    // whole series would use as the neighbours of the next block
+    for (size_t i = 0; i < std::min(timestamps_us.size(), values.size()); ++i) {
+        if (!context_.timestamps_us.empty()) {
+            const uint64_t last_us = context_.timestamps_us.back();
+            if (timestamps_us[i] <= last_us || timestamps_us[i] - last_us <= DerivativeEngine::min_interval_us) {
+                continue;
+            }
+        }
+        context_.timestamps_us.push_back(timestamps_us[i]);
+        context_.values.push_back(values[i]);
+    }
+    DerivativeEngine::compute(context_.timestamps_us, context_.values, output_);
+
+    // Keep the last two samples as the neighbours of the next block
+    const size_t kept = std::min<size_t>(context_.size(), 2);
+    context_.timestamps_us.erase(context_.timestamps_us.begin(), context_.timestamps_us.end() - kept);
+    context_.values.erase(context_.values.begin(), context_.values.end() - kept);
+}
+
+const DerivativeSeries &StreamingDifferentiator::output() const
+{
+    return output_;
+}
+
+StreamingPeakDetector::StreamingPeakDetector()
+    : received_(0)
+    , previous_time_us_(0)
+    , previous_value_(0.0)
+    , before_previous_value_(0.0)
+{}
+
+void StreamingPeakDetector::push(std::span<const uint64_t> timestamps_us, std::span<const double> values)
+{
+    peaks_.clear();
+    for (size_t i = 0; i < timestamps_us.size(); ++i, ++received_) {
+        if (received_ >= 2 && previous_value_ > before_previous_value_ && previous_value_ > values[i]) {
+            peaks_.push_back(previous_time_us_);
+        }
+        before_previous_value_ = previous_value_;
+        previous_value_ = values[i];
+        previous_time_us_ = timestamps_us[i];
+    }
+}
+
+const std::vector<uint64_t> &StreamingPeakDetector::peaks() const
+{
+    return peaks_;
+}
+
+StreamingPipeline::StreamingPipeline(uint64_t start_time_us, int target_rate, int kernel_size, double sigma)
+    : resampler_(start_time_us, target_rate)
+    , smoother_(kernel_size, sigma)
+{}
+
+void StreamingPipeline::attach(IWKV &sensor)
+{
+    connect(&sensor,
+            &IWKV::sensorDataAppended,
+            this,
+            [this](const IWKV &wkv, size_t first_index, size_t count) {
+                push(wkv.getTimestampsUs().subspan(first_index, count),
+                     wkv.getData().subspan(first_index, count));
+            });
+}
+
+void StreamingPipeline::push(std::span<const uint64_t> timestamps_us, std::span<const double> values)
+{
+    resampler_.push(timestamps_us, values);
+    forward(resampler_.output(), false);
+}
+
+void StreamingPipeline::flush()
+{
+    resampler_.flush();
+    forward(resampler_.output(), true);
+}
+
+void StreamingPipeline::forward(const SampleBlock &resampled, bool last)
+{
+    peak_detector_.push(resampled.timestamps_us, resampled.values);
+    smoother_.push(resampled.timestamps_us, resampled.values, last);
+    differentiator_.push(smoother_.output().timestamps_us, smoother_.output().values);
+    emit blockProcessed(*this);
+}
+
+const SampleBlock &StreamingPipeline::resampled() const
+{
+    return resampler_.output();
+}
+
+const SampleBlock &StreamingPipeline::smoothed() const
+{
+    return smoother_.output();
+}
+
+const DerivativeSeries &StreamingPipeline::derivatives() const
+{
+    return differentiator_.output();
+}
+
+const std::vector<uint64_t> &StreamingPipeline::peaks() const
+{
+    return peak_detector_.peaks();
+}
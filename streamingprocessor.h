@@ -0,0 +1,187 @@
+#ifndef STREAMINGPROCESSOR_H
+#define STREAMINGPROCESSOR_H
+
+#include <QObject>
+#include "derivativeengine.h"
+#include "gaussiansmoother.h"
+#include "iwkv.h"
+#include "localresampler.h"
+#include <span>
+#include <vector>
+
+/**
+ * @brief A block of samples emitted by a streaming stage.
+ *
+ * The vectors are reused from one block to the next, so a stage stops allocating once its
+ * blocks have reached their steady-state size.
+ */
+struct SampleBlock
+{
+    std::vector<uint64_t> timestamps_us; ///< Timestamps of the block in microseconds.
+    std::vector<double> values;          ///< Values corresponding to the timestamps.
+
+    size_t size() const { return timestamps_us.size(); }
+    bool empty() const { return timestamps_us.empty(); }
+};
+
+/**
+ * @brief Streaming counterpart of SensorDataProcessor::resampleData.
+ *
+ * Keeps the last four input samples between blocks, which is the widest interpolation stencil,
+ * and emits every grid instant as soon as the samples on both sides of it have arrived. The
+ * output is the same as the batch resampler on the whole series.
+ */
+class StreamingResampler
+{
+private:
+    LocalResampler resampler_;             ///< Interpolation kernel.
+    uint64_t step_us_;                     ///< Output sampling period in microseconds.
+    uint64_t next_time_us_;                ///< Next grid instant to emit.
+    std::vector<uint64_t> timestamps_us_;  ///< Carried-over samples followed by the current block.
+    std::vector<double> data_;             ///< Values matching timestamps_us_.
+    SampleBlock output_;                   ///< Last emitted block.
+
+    void emitUntil(uint64_t end_time_us);
+
+public:
+    /**
+     * @brief Construct a new StreamingResampler.
+     *
+     * @param start_time_us First instant of the output grid.
+     * @param target_rate Output rate in Hertz.
+     * @param mode Local interpolation, one of Linear, CatmullRom or Cubic.
+     * @throws std::invalid_argument if target_rate is not positive.
+     */
+    StreamingResampler(uint64_t start_time_us,
+                       int target_rate,
+                       InterpolationMode mode = InterpolationMode::Cubic);
+
+    /**
+     * @brief Feed a block of input samples, emitting the resampled block into output().
+     */
+    void push(std::span<const uint64_t> timestamps_us, std::span<const double> values);
+
+    /**
+     * @brief Emit the instants up to the last received sample, once the input is over.
+     */
+    void flush();
+
+    const SampleBlock &output() const;
+};
+
+/**
+ * @brief Streaming counterpart of SensorDataProcessor::applyGaussianSmoothing in Fir mode.
+ *
+ * Keeps the last kernel_size - 1 input values between blocks, so output lags the input by
+ * kernel_size / 2 samples. The stream starts and ends with zero padding like the batch filter,
+ * whose output it reproduces exactly.
+ */
+class StreamingGaussianSmoother
+{
+private:
+    GaussianSmoother smoother_;           ///< Kernel shared with the batch implementation.
+    size_t half_size_;                    ///< Number of samples of context on each side.
+    std::vector<double> data_;            ///< Context followed by the pending input values.
+    std::vector<uint64_t> timestamps_us_; ///< Timestamps of the samples not yet emitted.
+    std::vector<double> smoothed_;        ///< Scratch output of the convolution.
+    SampleBlock output_;                  ///< Last emitted block.
+
+public:
+    StreamingGaussianSmoother(int kernel_size, double sigma);
+
+    /**
+     * @brief Feed a block of input samples, emitting the smoothed block into output().
+     *
+     * @param last True for the final block: the stream is zero-padded and fully drained.
+     */
+    void push(std::span<const uint64_t> timestamps_us,
+              std::span<const double> values,
+              bool last = false);
+
+    const SampleBlock &output() const;
+};
+
+/**
+ * @brief Streaming counterpart of SensorDataProcessor::calculateVelocityAndAcceleration.
+ *
+ * Only keeps the last two samples between blocks: the derivatives of a sample are output once
+ * its next neighbour has been received. Samples are skipped as by DerivativeEngine, so the blocks
+ * concatenate to the derivatives of the whole series.
+ */
+class StreamingDifferentiator
+{
+private:
+    SampleBlock context_;          ///< Last two samples followed by the current block.
+    DerivativeSeries output_;
+
+public:
+    void push(std::span<const uint64_t> timestamps_us, std::span<const double> values);
+    const DerivativeSeries &output() const;
+};
+
+/**
+ * @brief Streaming counterpart of SensorDataProcessor::findPeaks.
+ *
+ * Only keeps the previous two samples between blocks.
+ */
+class StreamingPeakDetector
+{
+private:
+    size_t received_;
+    uint64_t previous_time_us_;
+    double previous_value_;
+    double before_previous_value_;
+    std::vector<uint64_t> peaks_;
+
+public:
+    StreamingPeakDetector();
+
+    void push(std::span<const uint64_t> timestamps_us, std::span<const double> values);
+    const std::vector<uint64_t> &peaks() const;
+};
+
+/**
+ * @brief The StreamingPipeline class chains the streaming stages for a live sensor.
+ *
+ * Blocks go through resample -> smooth -> velocity/acceleration, and the peaks are detected on
+ * the resampled stream. Memory and latency are bounded by the block size and the stage overlaps,
+ * not by the length of the recording. Attached to a sensor, the pipeline processes every block
+ * appended with IWKV::addDataPoints and emits blockProcessed() afterwards.
+ */
+class StreamingPipeline : public QObject
+{
+    Q_OBJECT
+
+private:
+    StreamingResampler resampler_;
+    StreamingGaussianSmoother smoother_;
+    StreamingDifferentiator differentiator_;
+    StreamingPeakDetector peak_detector_;
+
+    void forward(const SampleBlock &resampled, bool last);
+
+public:
+    StreamingPipeline(uint64_t start_time_us, int target_rate, int kernel_size, double sigma);
+
+    /**
+     * @brief Process every block appended to a sensor from now on.
+     */
+    void attach(IWKV &sensor);
+
+    void push(std::span<const uint64_t> timestamps_us, std::span<const double> values);
+
+    /**
+     * @brief Drain the stages once the input is over.
+     */
+    void flush();
+
+    const SampleBlock &resampled() const;
+    const SampleBlock &smoothed() const;
+    const DerivativeSeries &derivatives() const;
+    const std::vector<uint64_t> &peaks() const;
+
+signals:
+    void blockProcessed(const StreamingPipeline &pipeline);
+};
+
+#endif // STREAMINGPROCESSOR_H
@@ -0,0 +1,336 @@
+#include "syntheticgenerator.h"
+#include "workstealingpool.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// Samples generated per block inside a chunk, small enough for the block buffers to stay in L1.
+constexpr size_t block_size = 1024;
+
+// Philox streams, so the hip and IMU clocks of a seed draw independent numbers
+constexpr uint32_t hip_stream = 0;
+constexpr uint32_t imu_stream = 1;
+
+// Hip angle-specific parameters
+constexpr double hip_amplitude = 60.0;     // Amplitude in degrees
+constexpr double hip_base_frequency = 1.0; // Base frequency for hip movements
+constexpr double noise_stddev = 0.001;     // Gaussian noise
+
+constexpr double two_pi = 6.283185307179586;
+
+/**
+ * @brief Philox4x32-10: four random words for a 128-bit counter and a 64-bit key.
+ *
+ * The counter is (index, stream), so every sample of every stream has its own numbers.
+ */
+inline void philox(uint64_t key, uint32_t stream, uint64_t index, uint32_t &out0, uint32_t &out1)
+{
+    uint32_t c0 = static_cast<uint32_t>(index), c1 = static_cast<uint32_t>(index >> 32);
+    uint32_t c2 = stream, c3 = 0;
+    uint32_t k0 = static_cast<uint32_t>(key), k1 = static_cast<uint32_t>(key >> 32);
+    for (int round = 0; round < 10; ++round) {
+        const uint64_t p0 = uint64_t(0xD2511F53) * c0;
+        const uint64_t p1 = uint64_t(0xCD9E8D57) * c2;
+        const uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+        const uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+        c1 = static_cast<uint32_t>(p1);
+        c3 = static_cast<uint32_t>(p0);
+        c0 = n0;
+        c2 = n2;
+        k0 += 0x9E3779B9;
+        k1 += 0xBB67AE85;
+    }
+    out0 = c0;
+    out1 = c1;
+}
+
+/**
+ * @brief Round to the nearest integer without a call, for |x| < 2^51.
+ */
+inline double roundNearest(double x)
+{
+    constexpr double shift = 6755399441055744.0; // 1.5 * 2^52
+    return (x + shift) - shift;
+}
+
+/**
+ * @brief sin(2 * pi * turns), by reduction to a quarter turn and a degree 17 Taylor polynomial.
+ */
+inline double sinTurns(double turns)
+{
+    double p = turns - roundNearest(turns); // [-0.5, 0.5]
+    // sin(pi - x) = sin(x) folds p into [-0.25, 0.25], written without a select so the callers
+    // vectorise
+    const double magnitude = std::fabs(p);
+    p = std::copysign(std::min(magnitude, 0.5 - magnitude), p);
+    const double x = two_pi * p, x2 = x * x;
+    double sum = 1.0 / 355687428096000.0;
+    sum = sum * x2 - 1.0 / 1307674368000.0;
+    sum = sum * x2 + 1.0 / 6227020800.0;
+    sum = sum * x2 - 1.0 / 39916800.0;
+    sum = sum * x2 + 1.0 / 362880.0;
+    sum = sum * x2 - 1.0 / 5040.0;
+    sum = sum * x2 + 1.0 / 120.0;
+    sum = sum * x2 - 1.0 / 6.0;
+    return x + x * x2 * sum;
+}
+
+/**
+ * @brief Natural logarithm of a positive normal number, from its exponent and the atanh series
+ * of its mantissa.
+ */
+inline double logPositive(double x)
+{
+    // Split x into 2^exponent * mantissa with the mantissa in [sqrt(2) / 2, sqrt(2)), so the
+    // series converges fast, with integer operations only (as musl does)
+    constexpr uint64_t half_sqrt2 = 0x3FE6A09E667F3BCD;
+    const uint64_t bits = std::bit_cast<uint64_t>(x) + (0x3FF0000000000000 - half_sqrt2);
+    const double exponent = std::bit_cast<double>((bits >> 52) | 0x4330000000000000)
+                            - 4503599627370496.0 - 1023.0; // 2^52 trick
+    const double mantissa = std::bit_cast<double>((bits & 0x000FFFFFFFFFFFFF) + half_sqrt2);
+
+    const double s = (mantissa - 1.0) / (mantissa + 1.0), s2 = s * s;
+    double sum = 1.0 / 19.0;
+    sum = sum * s2 + 1.0 / 17.0;
+    sum = sum * s2 + 1.0 / 15.0;
+    sum = sum * s2 + 1.0 / 13.0;
+    sum = sum * s2 + 1.0 / 11.0;
+    sum = sum * s2 + 1.0 / 9.0;
+    sum = sum * s2 + 1.0 / 7.0;
+    sum = sum * s2 + 1.0 / 5.0;
+    sum = sum * s2 + 1.0 / 3.0;
+    sum = sum * s2 + 1.0;
+    return exponent * 0.6931471805599453 + 2.0 * s * sum;
+}
+
+/**
+ * @brief Square root of a positive normal number without the errno path of std::sqrt, which
+ * keeps the Box-Muller loop from being vectorised: a bit-trick estimate of 1 / sqrt(x) refined
+ * by four Newton steps, each doubling the number of correct bits.
+ */
+inline double sqrtPositive(double x)
+{
+    const double half = 0.5 * x;
+    double inverse = std::bit_cast<double>(0x5FE6EB50C7B537A9 - (std::bit_cast<uint64_t>(x) >> 1));
+    inverse *= 1.5 - half * inverse * inverse;
+    inverse *= 1.5 - half * inverse * inverse;
+    inverse *= 1.5 - half * inverse * inverse;
+    inverse *= 1.5 - half * inverse * inverse;
+    return x * inverse;
+}
+
+/**
+ * @brief Two independent standard normal numbers for each sample of [first, first + count),
+ * with the Box-Muller transform.
+ *
+ * @param noise Output of the second numbers, nullptr to only compute the first ones.
+ */
+void normals(uint64_t seed, uint32_t stream, uint64_t first, size_t count, double *jitter, double *noise)
+{
+    uint32_t words0[block_size], words1[block_size];
+    for (size_t i = 0; i < count; ++i) {
+        philox(seed, stream, first + i, words0[i], words1[i]);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const double u1 = (words0[i] + 0.5) * 0x1p-32; // (0, 1), never 0
+        const double u2 = words1[i] * 0x1p-32;
+        const double radius = sqrtPositive(-2.0 * logPositive(u1));
+        jitter[i] = radius * sinTurns(u2 + 0.25);
+        if (noise) {
+            noise[i] = radius * sinTurns(u2);
+        }
+    }
+}
+
+/**
+ * @brief Jittered sampling intervals of a block, period * N(1, jitter) truncated to at least 1 us.
+ */
+void intervals(double period_us, double jitter, size_t count, const double *normal, int32_t *interval_us)
+{
+    for (size_t i = 0; i < count; ++i) {
+        const double interval = period_us * (1.0 + jitter * normal[i]);
+        interval_us[i] = static_cast<int32_t>(std::clamp(interval, 1.0, 2147483647.0));
+    }
+}
+
+} // namespace
+
+SyntheticGenerator::SyntheticGenerator(uint64_t seed, size_t thread_count)
+    : seed_(seed)
+    , thread_count_(thread_count)
+{}
+
+uint64_t SyntheticGenerator::getSeed() const
+{
+    return seed_;
+}
+
+template<typename Fill>
+void SyntheticGenerator::generateClock(uint32_t stream,
+                                       const SyntheticTiming &timing,
+                                       uint64_t end_time_us,
+                                       std::vector<uint64_t> &timestamps_us,
+                                       std::vector<double> &values,
+                                       const Fill &fill) const
+{
+    if (timing.frequency <= 0) {
+        throw std::invalid_argument("SyntheticGenerator: the frequency must be positive.");
+    }
+    const double period_us = 1e6 / timing.frequency;
+    const uint64_t span_us = end_time_us - timing.start_time_us;
+    WorkStealingPool pool(thread_count_);
+
+    // Sum of the intervals following the samples of a chunk
+    auto chunkSpan = [&](size_t chunk) {
+        double jitter[block_size];
+        int32_t interval_us[block_size];
+        uint64_t sum = 0;
+        for (size_t block = 0; block < chunk_samples; block += block_size) {
+            const uint64_t first = chunk * chunk_samples + block;
+            normals(seed_, stream, first, block_size, jitter, nullptr);
+            intervals(period_us, timing.jitter, block_size, jitter, interval_us);
+            for (size_t i = 0; i < block_size; ++i) {
+                sum += static_cast<uint64_t>(interval_us[i]);
+            }
+        }
+        return sum;
+    };
+
+    // First pass: chunk spans until the clock passes the end, in rounds sized from the expected
+    // sample count. chunk_starts[c] is the offset of the first sample of chunk c.
+    std::vector<uint64_t> chunk_starts{0};
+    while (chunk_starts.back() <= span_us) {
+        const double remaining = static_cast<double>(span_us - chunk_starts.back()) / period_us;
+        const size_t round = static_cast<size_t>(remaining / chunk_samples) + 1;
+        const size_t first_chunk = chunk_starts.size() - 1;
+        std::vector<uint64_t> spans(round);
+        std::vector<WorkStealingPool::Task> tasks;
+        for (size_t c = 0; c < round; ++c) {
+            tasks.push_back([&, c](size_t) { spans[c] = chunkSpan(first_chunk + c); });
+        }
+        pool.run(std::move(tasks));
+        for (const uint64_t span : spans) {
+            chunk_starts.push_back(chunk_starts.back() + span);
+        }
+    }
+
+    // Last chunk with samples within the span, then its samples up to the end
+    const size_t last_chunk = std::upper_bound(chunk_starts.begin(), chunk_starts.end(), span_us)
+                              - chunk_starts.begin() - 1;
+    size_t count = last_chunk * chunk_samples;
+    {
+        double jitter[block_size];
+        int32_t interval_us[block_size];
+        uint64_t offset_us = chunk_starts[last_chunk];
+        while (offset_us <= span_us) {
+            normals(seed_, stream, count, block_size, jitter, nullptr);
+            intervals(period_us, timing.jitter, block_size, jitter, interval_us);
+            for (size_t i = 0; i < block_size && offset_us <= span_us; ++i) {
+                ++count;
+                offset_us += static_cast<uint64_t>(interval_us[i]);
+            }
+        }
+    }
+
+    // Second pass: every chunk writes its timestamps and values in place
+    timestamps_us.resize(count);
+    values.resize(count);
+    std::vector<WorkStealingPool::Task> tasks;
+    for (size_t chunk = 0; chunk * chunk_samples < count; ++chunk) {
+        tasks.push_back([&, chunk](size_t) {
+            double jitter[block_size], noise[block_size];
+            int32_t interval_us[block_size];
+            const size_t chunk_begin = chunk * chunk_samples;
+            const size_t chunk_end = std::min(count, chunk_begin + chunk_samples);
+            uint64_t time_us = timing.start_time_us + chunk_starts[chunk];
+
+            // The sample before the chunk belongs to another task, recompute its timestamp
+            uint64_t previous_time_us = time_us;
+            if (chunk_begin > 0) {
+                normals(seed_, stream, chunk_begin - 1, 1, jitter, nullptr);
+                intervals(period_us, timing.jitter, 1, jitter, interval_us);
+                previous_time_us = time_us - static_cast<uint64_t>(interval_us[0]);
+            }
+
+            for (size_t first = chunk_begin; first < chunk_end; first += block_size) {
+                const size_t block_count = std::min(block_size, chunk_end - first);
+                normals(seed_, stream, first, block_count, jitter, noise);
+                intervals(period_us, timing.jitter, block_count, jitter, interval_us);
+                for (size_t i = 0; i < block_count; ++i) {
+                    timestamps_us[first + i] = time_us;
+                    time_us += static_cast<uint64_t>(interval_us[i]);
+                }
+                fill(first, block_count, previous_time_us, noise);
+                previous_time_us = timestamps_us[first + block_count - 1];
+            }
+        });
+    }
+    pool.run(std::move(tasks));
+}
+
+void SyntheticGenerator::generateHip(const SyntheticTiming &timing,
+                                     std::vector<uint64_t> &timestamps_us,
+                                     std::vector<double> &values) const
+{
+    const uint64_t end_time_us = timing.start_time_us
+                                 + static_cast<uint64_t>(timing.duration_seconds) * 1000000;
+    auto fill = [&](size_t first, size_t count, uint64_t, const double *noise) {
+        const uint64_t *time_us = timestamps_us.data() + first;
+        double *value = values.data() + first;
+        for (size_t i = 0; i < count; ++i) {
+            const double time_in_seconds = static_cast<double>(time_us[i] - timing.start_time_us) / 1e6;
+            // Periodic component simulating regular movements, plus noise
+            value[i] = hip_amplitude * sinTurns(hip_base_frequency * time_in_seconds)
+                       + noise_stddev * noise[i];
+        }
+    };
+    generateClock(hip_stream, timing, end_time_us, timestamps_us, values, fill);
+}
+
+void SyntheticGenerator::generateImu(const SyntheticTiming &timing,
+                                     std::span<const uint64_t> hip_timestamps_us,
+                                     std::span<const double> hip_values,
+                                     std::vector<uint64_t> &timestamps_us,
+                                     std::vector<double> &values) const
+{
+    // The IMU stops at the last hip sample of the duration
+    const uint64_t end_time_us = timing.start_time_us
+                                 + static_cast<uint64_t>(timing.duration_seconds) * 1000000;
+    const size_t hip_count = std::upper_bound(hip_timestamps_us.begin(),
+                                              hip_timestamps_us.end(),
+                                              end_time_us)
+                             - hip_timestamps_us.begin();
+    if (hip_count == 0 || hip_timestamps_us[hip_count - 1] < timing.start_time_us) {
+        timestamps_us.clear();
+        values.clear();
+        return;
+    }
+    const std::span<const uint64_t> hip_timestamps = hip_timestamps_us.first(hip_count);
+
+    auto fill = [&](size_t first, size_t count, uint64_t previous_time_us, const double *noise) {
+        const uint64_t *time_us = timestamps_us.data() + first;
+        double *value = values.data() + first;
+        // First hip sample at or after each IMU sample, found by a merge walk
+        size_t hip = std::lower_bound(hip_timestamps.begin(), hip_timestamps.end(), previous_time_us)
+                     - hip_timestamps.begin();
+        double previous_hip_angle = first > 0 ? hip_values[hip] : 0.0;
+        for (size_t i = 0; i < count; ++i) {
+            while (hip_timestamps[hip] < time_us[i]) {
+                ++hip;
+            }
+            // Angular velocity as the derivative of the hip angle
+            value[i] = (hip_values[hip] - previous_hip_angle) * timing.frequency
+                       + noise_stddev * noise[i];
+            previous_hip_angle = hip_values[hip];
+        }
+    };
+    generateClock(imu_stream,
+                  timing,
+                  hip_timestamps[hip_count - 1],
+                  timestamps_us,
+                  values,
+                  fill);
+}
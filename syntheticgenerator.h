@@ -0,0 +1,110 @@
+#ifndef SYNTHETICGENERATOR_H
+#define SYNTHETICGENERATOR_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @brief Sampling of a synthetic series: a jittered clock running from start_time_us for
+ * duration_seconds.
+ */
+struct SyntheticTiming
+{
+    uint64_t start_time_us = 0; ///< Timestamp of the first sample.
+    int frequency = 1000;       ///< Nominal sampling rate in Hertz.
+    double jitter = 0.0;        ///< Standard deviation of the sampling interval, relative to the period.
+    int duration_seconds = 60;  ///< Length of the series.
+};
+
+/**
+ * @brief The SyntheticGenerator class generates the hip and IMU recordings of the sensors,
+ * reproducibly and in parallel.
+ *
+ * Random numbers come from Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as
+ * 1, 2, 3", SC 2011), a counter-based generator: the numbers of sample k are a pure function of
+ * the seed, the stream and k, so any sample can be generated without the ones before it. The
+ * series is cut in fixed chunks generated on a WorkStealingPool, and the output is bit-identical
+ * for a given seed whatever the number of threads.
+ *
+ * Timestamps are a running sum of jittered intervals. A first pass sums the intervals of every
+ * chunk, which gives the exact sample count and the first timestamp of each chunk, so the output
+ * is allocated once and the chunks are then filled in place. Within a chunk the samples are
+ * generated in blocks by branch-free loops (random numbers, Box-Muller, sine) that the compiler
+ * vectorises; the transcendental functions are polynomial approximations accurate to about
+ * 1e-12, far below the simulated sensor noise.
+ */
+class SyntheticGenerator
+{
+public:
+    /// Samples per task, fixed so the output does not depend on the thread count.
+    static constexpr size_t chunk_samples = size_t(1) << 16;
+
+    /**
+     * @brief Construct a new SyntheticGenerator.
+     *
+     * @param seed Seed of the random numbers, equal seeds give equal series.
+     * @param thread_count Number of threads, the number of hardware threads when 0.
+     */
+    explicit SyntheticGenerator(uint64_t seed, size_t thread_count = 0);
+
+    uint64_t getSeed() const;
+
+    /**
+     * @brief Generate a hip angle recording: a 1 Hz, 60 degrees sine with Gaussian noise.
+     *
+     * Sampling intervals are period * N(1, jitter), truncated to whole microseconds and to at
+     * least one, so timestamps are strictly increasing.
+     *
+     * @param timing Sampling of the series.
+     * @param timestamps_us Output, resized to the number of samples.
+     * @param values Output, resized to the number of samples.
+     * @throws std::invalid_argument if the frequency is not positive.
+     */
+    void generateHip(const SyntheticTiming &timing,
+                     std::vector<uint64_t> &timestamps_us,
+                     std::vector<double> &values) const;
+
+    /**
+     * @brief Generate an IMU angular velocity recording following a hip recording.
+     *
+     * The IMU has its own jittered clock, starting at timing.start_time_us (normally the start
+     * of the hip recording) and stopping at the last hip sample of the duration. Each IMU sample
+     * takes the first hip sample at or after it; its value is the change of hip angle since the
+     * previous IMU sample times the IMU frequency, plus Gaussian noise.
+     *
+     * @param timing Sampling of the IMU.
+     * @param hip_timestamps_us Timestamps of the hip recording.
+     * @param hip_values Values of the hip recording.
+     * @param timestamps_us Output, resized to the number of samples.
+     * @param values Output, resized to the number of samples.
+     * @throws std::invalid_argument if the frequency is not positive.
+     */
+    void generateImu(const SyntheticTiming &timing,
+                     std::span<const uint64_t> hip_timestamps_us,
+                     std::span<const double> hip_values,
+                     std::vector<uint64_t> &timestamps_us,
+                     std::vector<double> &values) const;
+
+private:
+    uint64_t seed_;       ///< Key of the counter-based generator.
+    size_t thread_count_; ///< Threads used by the generation passes.
+
+    /**
+     * @brief Generate the timestamps of a jittered clock up to end_time_us.
+     *
+     * Both outputs are resized to the number of samples. fill(first, count, previous_time_us,
+     * noise) is then called for every block of samples once its timestamps are written, with the
+     * timestamp of the sample before the block and a standard normal number per sample, to
+     * write the values of the block.
+     */
+    template<typename Fill>
+    void generateClock(uint32_t stream,
+                       const SyntheticTiming &timing,
+                       uint64_t end_time_us,
+                       std::vector<uint64_t> &timestamps_us,
+                       std::vector<double> &values,
+                       const Fill &fill) const;
+};
+
+#endif // SYNTHETICGENERATOR_H
@@ -0,0 +1,110 @@
+#include "taskgraph.h"
+#include <QThreadPool>
+#include <iostream>
+#include <stdexcept>
+
+TaskGraph::TaskGraph(QThreadPool *pool)
+    : pool_(pool ? pool : QThreadPool::globalInstance())
+    , started_(false)
+    , finished_count_(0)
+{}
+
+TaskGraph::~TaskGraph()
+{
+    if (!started_)
+        return;
+
+    std::unique_lock lock(mutex_);
+    finished_condition_.wait(lock, [this] { return finished_count_ == tasks_.size(); });
+}
+
+TaskGraph::TaskId TaskGraph::addTask(std::string name,
+                                     std::function<void()> work,
+                                     std::vector<TaskId> dependencies)
+{
+    if (started_)
+        throw std::logic_error("TaskGraph: cannot add a task after start()");
+
+    const TaskId id = tasks_.size();
+    auto task = std::make_unique<Task>();
+    task->name = std::move(name);
+    task->work = std::move(work);
+    for (TaskId dependency : dependencies) {
+        if (dependency >= id)
+            throw std::invalid_argument("TaskGraph: task '" + task->name
+                                        + "' depends on an unknown task");
+        tasks_[dependency]->dependents.push_back(id);
+    }
+    task->dependency_count = dependencies.size();
+    tasks_.push_back(std::move(task));
+    return id;
+}
+
+void TaskGraph::start()
+{
+    if (started_)
+        throw std::logic_error("TaskGraph: already started");
+    started_ = true;
+
+    // Reset every counter before submitting anything, a root may release its dependents at once
+    for (auto &task : tasks_)
+        task->pending = task->dependency_count;
+    for (TaskId id = 0; id < tasks_.size(); ++id) {
+        if (tasks_[id]->dependency_count == 0)
+            submit(id);
+    }
+}
+
+void TaskGraph::wait()
+{
+    std::unique_lock lock(mutex_);
+    finished_condition_.wait(lock, [this] { return !started_ || finished_count_ == tasks_.size(); });
+    if (error_)
+        std::rethrow_exception(error_);
+}
+
+bool TaskGraph::isFinished() const
+{
+    std::lock_guard lock(mutex_);
+    return finished_count_ == tasks_.size();
+}
+
+void TaskGraph::submit(TaskId id)
+{
+    pool_->start([this, id] { run(id); });
+}
+
+void TaskGraph::run(TaskId id)
+{
+    Task &task = *tasks_[id];
+    bool failed = task.skipped;
+    if (!failed) {
+        try {
+            task.work();
+        } catch (...) {
+            failed = true;
+            std::cerr << "Task '" << task.name << "' failed." << std::endl;
+            std::lock_guard lock(mutex_);
+            if (!error_)
+                error_ = std::current_exception();
+        }
+    }
+    release(id, failed);
+}
+
+void TaskGraph::release(TaskId id, bool failed)
+{
+    // Dependents of a failed or skipped task are still released, but only to be skipped: this
+    // keeps the finished count exact without running work on missing inputs.
+    for (TaskId dependent : tasks_[id]->dependents) {
+        Task &next = *tasks_[dependent];
+        if (failed)
+            next.skipped = true;
+        if (next.pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            submit(dependent);
+    }
+
+    std::lock_guard lock(mutex_);
+    if (++finished_count_ == tasks_.size())
+        finished_condition_.notify_all();
+}
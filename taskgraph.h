@@ -0,0 +1,94 @@
+#ifndef TASKGRAPH_H
+#define TASKGRAPH_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class QThreadPool;
+
+/**
+ * @brief The TaskGraph class runs a set of tasks on a thread pool, respecting their dependencies.
+ *
+ * Tasks are added with the ids of the tasks they depend on, then start() submits every task
+ * without dependencies. Whenever a task finishes, the dependents it was the last prerequisite of
+ * are submitted in turn, so independent chains (e.g. one per sensor) run in parallel and the
+ * total wall time drops to the critical path of the graph.
+ *
+ * If a task throws, the tasks depending on it (directly or not) are skipped and wait() rethrows
+ * the first exception. The graph waits for its running tasks when destroyed.
+ */
+class TaskGraph
+{
+public:
+    using TaskId = size_t;
+
+    /**
+     * @brief Construct an empty graph.
+     *
+     * @param pool Pool the tasks run on, QThreadPool::globalInstance() when null.
+     */
+    explicit TaskGraph(QThreadPool *pool = nullptr);
+    ~TaskGraph();
+
+    TaskGraph(const TaskGraph &) = delete;
+    TaskGraph &operator=(const TaskGraph &) = delete;
+
+    /**
+     * @brief Add a task to the graph. Must be called before start().
+     *
+     * @param name Name of the task, used in error messages.
+     * @param work Work to run on the pool.
+     * @param dependencies Tasks that must have completed before this one starts.
+     * @return Id of the task, to be used as a dependency of later tasks.
+     */
+    TaskId addTask(std::string name, std::function<void()> work, std::vector<TaskId> dependencies = {});
+
+    /**
+     * @brief Submit the tasks that have no dependencies and return immediately.
+     */
+    void start();
+
+    /**
+     * @brief Block until every task has completed or been skipped.
+     *
+     * @throws The first exception thrown by a task.
+     */
+    void wait();
+
+    /**
+     * @brief Whether every task has completed or been skipped.
+     */
+    bool isFinished() const;
+
+private:
+    struct Task
+    {
+        std::string name;
+        std::function<void()> work;
+        std::vector<TaskId> dependents;      ///< Tasks waiting on this one.
+        size_t dependency_count = 0;         ///< Number of tasks this one waits on.
+        std::atomic<size_t> pending{0};      ///< Dependencies not completed yet.
+        std::atomic<bool> skipped{false};    ///< Whether a dependency failed.
+    };
+
+    QThreadPool *pool_;
+    std::vector<std::unique_ptr<Task>> tasks_;
+    bool started_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable finished_condition_;
+    size_t finished_count_;                  ///< Tasks completed or skipped, guarded by mutex_.
+    std::exception_ptr error_;               ///< First exception thrown, guarded by mutex_.
+
+    void submit(TaskId id);
+    void run(TaskId id);
+    void release(TaskId id, bool failed);
+};
+
+#endif // TASKGRAPH_H
@@ -1,130 +1,303 @@
-#include "WKV.h"
-
-/**
- * @brief Construct a new WKV object.
- * 
- * Initializes the sensor name and unit of the data series and sets the start time to zero.
- * 
- * @param name The name of the sensor.
- * @param unit The unit of measurement for the data series.
- */
-WKV::WKV(const std::string &name, const std::string &unit)
-    : name_(name)
-    , unit_(unit)
-    , start_time_us_(0)
-{}
-
-/**
- * @brief Get the sensor name.
- * 
- * @return std::string Returns the sensor name.
- */
-std::string WKV::getName() const
-{
-    return name_;
-}
-
-int WKV::getFrequency() const
-{
-    return frequency_;
-}
-
-/**
- * @brief Get the unit of measurement of the data series.
- * 
- * @return std::string Returns the unit of measurement of the data series.
- */
-std::string WKV::getUnit() const
-{
-    return unit_;
-}
-
-/**
- * @brief Get the start time of the data series in microseconds.
- * 
- * @return uint64_t Returns the start time of the data series in microseconds.
- */
-uint64_t WKV::getStartTimeUs() const
-{
-    return start_time_us_;
-}
-
-/**
- * @brief Set the name of the data series.
- * 
- * @param name The new name to set for the data series.
- */
-void WKV::setName(const std::string &name)
-{
-    name_ = name;
-}
-
-/**
- * @brief Set the unit of measurement for the data series.
- * 
- * @param unit The new unit to set for the data series.
- */
-void WKV::setUnit(const std::string &unit)
-{
-    unit_ = unit;
-}
-
-/**
- * @brief Set the start time of the data series in microseconds.
- * 
- * @param start_time_us The new start time to set for the data series.
- */
-void WKV::setStartTimeUs(uint64_t start_time_us)
-{
-    start_time_us_ = start_time_us;
-}
-
-/**
- * @brief Adds a data point to the data series.
- * 
- * This method appends the provided epoch time and value to the timestamps and data vectors, respectively.
- * 
- * @param epoch_us The epoch time of the data point in microseconds.
- * @param value The value of the data point.
- */
-void WKV::addDataPoint(const uint64_t epoch_us, const double value)
-{
-    timestamps_us_.push_back(epoch_us);
-    data_.push_back(value);
-}
-
-/**
- * @brief Get a constant reference to the vector of timestamps.
- * 
- * @return const std::vector<uint64_t>& Returns a constant reference to the vector of timestamps in microseconds.
- */
-const std::vector<uint64_t> &WKV::getTimestampsUs() const
-{
-    return timestamps_us_;
-}
-
-/**
- * @brief Get a constant reference to the vector of data values.
- * 
- * @return const std::vector<double>& Returns a constant reference to the vector of data values.
- */
-const std::vector<double> &WKV::getData() const
-{
-    return data_;
-}
-
-void WKV::setData(const std::vector<double> &data)
-{
-    this->data_ = data;
-}
-
-void WKV::copyFrom(const IWKV &other)
-{
-    // this->name_ = other.getName(); // do not copy the name as it is constructed with it.
-    this->unit_ = other.getUnit();
-    this->frequency_ = other.getFrequency();
-    this->timestamps_us_ = other.getTimestampsUs();
-    this->data_ = other.getData();
-    this->start_time_us_ = other.getStartTimeUs();
-    emit sensorDataReady(*this);
-}
+#include "wkv.h"
+#include "wkvview.h"
+#include <chrono>
+
+/**
+ * @brief Construct a new WKV object.
+ * 
+ * Initializes the sensor name and unit of the data series and sets the start time to zero.
+ * 
+ * @param name The name of the sensor.
+ * @param unit The unit of measurement for the data series.
+ * @param resource The memory resource of the timestamps and data columns.
+ */
+WKV::WKV(const std::string &name, const std::string &unit, std::pmr::memory_resource *resource)
+    : name_(name)
+    , unit_(unit)
+    , frequency_(0)
+    , timestamps_us_(resource)
+    , data_(resource)
+    , start_time_us_(0)
+{}
+
+/**
+ * @brief Get the sensor name.
+ * 
+ * @return std::string Returns the sensor name.
+ */
+std::string WKV::getName() const
+{
+    return name_;
+}
+
+int WKV::getFrequency() const
+{
+    return frequency_;
+}
+
+/**
+ * @brief Get the unit of measurement of the data series.
+ * 
+ * @return std::string Returns the unit of measurement of the data series.
+ */
+std::string WKV::getUnit() const
+{
+    return unit_;
+}
+
+/**
+ * @brief Get the start time of the data series in microseconds.
+ * 
+ * @return uint64_t Returns the start time of the data series in microseconds.
+ */
+uint64_t WKV::getStartTimeUs() const
+{
+    return start_time_us_;
+}
+
+/**
+ * @brief Set the name of the data series.
+ * 
+ * @param name The new name to set for the data series.
+ */
+void WKV::setName(const std::string &name)
+{
+    name_ = name;
+}
+
+/**
+ * @brief Set the unit of measurement for the data series.
+ * 
+ * @param unit The new unit to set for the data series.
+ */
+void WKV::setUnit(const std::string &unit)
+{
+    unit_ = unit;
+}
+
+/**
+ * @brief Set the start time of the data series in microseconds.
+ * 
+ * @param start_time_us The new start time to set for the data series.
+ */
+void WKV::setStartTimeUs(uint64_t start_time_us)
+{
+    start_time_us_ = start_time_us;
+}
+
+/**
+ * @brief Set the nominal frequency of the sensor.
+ * 
+ * @param frequency The new frequency in Hertz.
+ */
+void WKV::setFrequency(int frequency)
+{
+    frequency_ = frequency;
+}
+
+/**
+ * @brief Set the seed used by generateData().
+ * 
+ * @param seed The seed of the synthetic generator.
+ */
+void WKV::setSeed(uint64_t seed)
+{
+    seed_ = seed;
+}
+
+/**
+ * @brief Get the seed for the next generation, the current time when no seed was set.
+ * 
+ * @return uint64_t The seed of the synthetic generator.
+ */
+uint64_t WKV::generationSeed() const
+{
+    if (seed_) {
+        return *seed_;
+    }
+    return static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+}
+
+/**
+ * @brief Adds a data point to the data series.
+ * 
+ * This method appends the provided epoch time and value to the timestamps and data vectors, respectively.
+ * 
+ * @param epoch_us The epoch time of the data point in microseconds.
+ * @param value The value of the data point.
+ */
+void WKV::addDataPoint(const uint64_t epoch_us, const double value)
+{
+    timestamps_us_.push_back(epoch_us);
+    data_.push_back(value);
+    if (aggregate_index_) {
+        aggregate_index_->append(value);
+    }
+}
+
+/**
+ * @brief Appends a block of data points to the data series.
+ * 
+ * Both vectors grow at most once, whatever the size of the block, and are copied first if they
+ * are shared with another sensor. Emits sensorDataAppended so
+ * streaming consumers can process the new block.
+ * 
+ * @param epochs_us The epoch times of the data points in microseconds.
+ * @param values The values of the data points.
+ */
+void WKV::addDataPoints(std::span<const uint64_t> epochs_us, std::span<const double> values)
+{
+    const size_t first_index = timestamps_us_.size();
+    timestamps_us_.append(epochs_us);
+    data_.append(values);
+    if (aggregate_index_) {
+        aggregate_index_->append(values);
+    }
+    emit sensorDataAppended(*this, first_index, epochs_us.size());
+}
+
+/**
+ * @brief Get a view on the vector of timestamps.
+ * 
+ * @return std::span<const uint64_t> Returns a view on the vector of timestamps in microseconds.
+ */
+std::span<const uint64_t> WKV::getTimestampsUs() const
+{
+    return timestamps_us_.view();
+}
+
+/**
+ * @brief Get a view on the vector of data values.
+ * 
+ * @return std::span<const double> Returns a view on the vector of data values.
+ */
+std::span<const double> WKV::getData() const
+{
+    return data_.view();
+}
+
+void WKV::setData(const std::vector<double> &data)
+{
+    this->data_ = std::pmr::vector<double>(data.begin(), data.end(), getMemoryResource());
+    rebuildAggregateIndex();
+}
+
+void WKV::setData(std::vector<double> &&data)
+{
+    this->data_ = std::move(data);
+    rebuildAggregateIndex();
+}
+
+void WKV::setData(std::pmr::vector<double> &&data)
+{
+    this->data_ = std::move(data);
+    rebuildAggregateIndex();
+}
+
+/**
+ * @brief Replace the timestamps of the data series.
+ * 
+ * The data column is left as is, the caller keeps both columns the same size.
+ * 
+ * @param timestamps_us The new timestamps in microseconds.
+ */
+void WKV::setTimestampsUs(std::vector<uint64_t> &&timestamps_us)
+{
+    this->timestamps_us_ = std::move(timestamps_us);
+}
+
+void WKV::setTimestampsUs(std::pmr::vector<uint64_t> &&timestamps_us)
+{
+    this->timestamps_us_ = std::move(timestamps_us);
+}
+
+/**
+ * @brief Get the memory resource given at construction.
+ * 
+ * @return std::pmr::memory_resource* The resource the columns are allocated from.
+ */
+std::pmr::memory_resource *WKV::getMemoryResource() const
+{
+    return timestamps_us_.resource();
+}
+
+void WKV::copyFrom(const IWKV &other)
+{
+    // this->name_ = other.getName(); // do not copy the name as it is constructed with it.
+    this->unit_ = other.getUnit();
+    this->frequency_ = other.getFrequency();
+    if (const WKV *other_wkv = dynamic_cast<const WKV *>(&other)) {
+        // Share the buffers within a resource, the first sensor to modify a column copies it
+        this->timestamps_us_ = other_wkv->timestamps_us_;
+        this->data_ = other_wkv->data_;
+        if (aggregate_index_ && other_wkv->aggregate_index_) {
+            *aggregate_index_ = *other_wkv->aggregate_index_;
+        } else {
+            rebuildAggregateIndex();
+        }
+    } else {
+        const std::span<const uint64_t> timestamps = other.getTimestampsUs();
+        const std::span<const double> data = other.getData();
+        this->timestamps_us_ = std::pmr::vector<uint64_t>(timestamps.begin(),
+                                                          timestamps.end(),
+                                                          getMemoryResource());
+        this->data_ = std::pmr::vector<double>(data.begin(), data.end(), getMemoryResource());
+        rebuildAggregateIndex();
+    }
+    this->start_time_us_ = other.getStartTimeUs();
+    emit sensorDataReady(*this);
+}
+
+/**
+ * @brief Check whether the timestamps and data buffers are shared with another sensor.
+ * 
+ * @param other The sensor to compare with.
+ * @return bool True if neither column was copied since one of the sensors was copied from the other.
+ */
+bool WKV::sharesColumnsWith(const WKV &other) const
+{
+    return timestamps_us_.sharesWith(other.timestamps_us_) && data_.sharesWith(other.data_);
+}
+
+void WKV::rebuildAggregateIndex()
+{
+    if (aggregate_index_) {
+        aggregate_index_->assign(data_.view());
+    }
+}
+
+void WKV::enableAggregateIndex()
+{
+    if (!aggregate_index_) {
+        aggregate_index_ = std::make_unique<RangeAggregateIndex>(data_.view());
+    }
+}
+
+void WKV::disableAggregateIndex()
+{
+    aggregate_index_.reset();
+}
+
+bool WKV::hasAggregateIndex() const
+{
+    return aggregate_index_ != nullptr;
+}
+
+/**
+ * @brief Get the statistics of the data over a time window.
+ * 
+ * The window edges are found with a binary search on the timestamps, then the index answers for
+ * the samples between them.
+ * 
+ * @param start_time_s The start of the window in seconds, relative to the start time.
+ * @param end_time_s The end of the window in seconds, relative to the start time.
+ * @return WindowStatistics The statistics of the samples in the window, NaN extrema when it is empty.
+ */
+WindowStatistics WKV::statistics(double start_time_s, double end_time_s) const
+{
+    const WKVView window = WKVView::window(*this, start_time_s, end_time_s);
+    if (!aggregate_index_) {
+        return RangeAggregateIndex::scan(window.getData());
+    }
+    return aggregate_index_->query(getData(), window.getOffset(), window.getOffset() + window.size());
+}
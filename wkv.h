@@ -1,110 +1,213 @@
-#ifndef WKV_H
-#define WKV_H
-#include "iwkv.h"
-
-/**
- * @brief The WKV class stores sensor data along with their corresponding timestamps.
- */
-class WKV : public IWKV
-{
-protected:
-    std::string name_;                    ///< Name of the sensor.
-    std::string unit_;                    ///< Unit of measurement for the data.
-    int frequency_;                       ///< Frequency in Hertz
-    std::vector<uint64_t> timestamps_us_; ///< List of timestamps in microseconds.
-    std::vector<double> data_;            ///< Data values corresponding to the timestamps.
-    uint64_t start_time_us_;              ///< Start time of the data series in microseconds.
-
-public:
-    /**
-     * @brief Construct a new WKV object.
-     * 
-     * @param name The name of the sensor.
-     * @param unit The measurement unit of the dat  a.
-     */
-    WKV(const std::string &name, const std::string &unit);
-
-    virtual ~WKV() {}
-    /**
-     * @brief Get the Name of the sensor.
-     * 
-     * @return std::string The name of the sensor.
-     */
-    std::string getName() const override;
-
-    /**
-     * @brief Get the frequency of the sensor.
-     * 
-     * @return int the frequency in Hertz.
-     */
-    virtual int getFrequency() const override;
-
-    /**
-     * @brief Get the Unit of measurement.
-     * 
-     * @return std::string The unit of measurement.
-     */
-    std::string getUnit() const override;
-
-    /**
-     * @brief Get the Start Time in microseconds.
-     * 
-     * @return uint64_t The start time in microseconds.
-     */
-    uint64_t getStartTimeUs() const override;
-
-    /**
-     * @brief Set the Name of the sensor.
-     * 
-     * @param name The new name of the sensor.
-     */
-    void setName(const std::string &name) override;
-
-    /**
-     * @brief Set the Unit of measurement.
-     * 
-     * @param unit The new unit of measurement.
-     */
-    void setUnit(const std::string &unit) override;
-
-    /**
-     * @brief Set the Start Time in microseconds.
-     * 
-     * @param start_time_us The new start time in microseconds.
-     */
-    void setStartTimeUs(uint64_t start_time_us) override;
-
-    /**
-     * @brief Add a data point to the series.
-     * 
-     * @param epoch_us The timestamp in microseconds.
-     * @param value The data value.
-     */
-    void addDataPoint(const uint64_t epoch_us, const double value) override;
-
-    /**
-     * @brief Get the Timestamps in microseconds.
-     * 
-     * @return const std::vector<uint64_t>& A constant reference to the timestamps vector.
-     */
-    const std::vector<uint64_t> &getTimestampsUs() const override;
-
-    /**
-     * @brief Get the Data series values.
-     * 
-     * @return const std::vector<double>& A constant reference to the data vector.
-     */
-    const std::vector<double> &getData() const override;
-
-    /**
-     * @brief Set the data series values.
-     */
-    virtual void setData(const std::vector<double> &data) override;
-
-    /**
-     * @brief Copy data from one iwkv instance to another. Was force to do so as copy constructor are deleted in Q_Object classes...
-     */
-    virtual void copyFrom(const IWKV &other) override;
-};
-
-#endif // WKV_H
+#ifndef WKV_H
+#define WKV_H
+#include "iwkv.h"
+#include "rangeaggregateindex.h"
+#include "sharedcolumn.h"
+#include <memory>
+
+/**
+ * @brief The WKV class stores sensor data along with their corresponding timestamps.
+ *
+ * Both columns are copy-on-write: copyFrom() another WKV on the same memory resource shares its
+ * buffers, and a column is only copied when one of the sensors sharing it modifies it. The columns are allocated from a memory
+ * resource given at construction, e.g. the PipelineArena of a processing run.
+ *
+ * Window statistics can be served by an optional RangeAggregateIndex, kept up to date by every
+ * modification of the data column.
+ */
+class WKV : public IWKV
+{
+protected:
+    std::string name_;                     ///< Name of the sensor.
+    std::string unit_;                     ///< Unit of measurement for the data.
+    int frequency_;                        ///< Frequency in Hertz
+    SharedColumn<uint64_t> timestamps_us_; ///< List of timestamps in microseconds.
+    SharedColumn<double> data_;            ///< Data values corresponding to the timestamps.
+    uint64_t start_time_us_;               ///< Start time of the data series in microseconds.
+    std::optional<uint64_t> seed_;         ///< Seed of generateData(), drawn from the clock when unset.
+    std::unique_ptr<RangeAggregateIndex> aggregate_index_; ///< Index of data_, when enabled.
+
+    /**
+     * @brief Get the seed to use for the next generateData().
+     */
+    uint64_t generationSeed() const;
+
+    /**
+     * @brief Rebuild the range-aggregate index, if enabled, after data_ was replaced.
+     */
+    void rebuildAggregateIndex();
+
+public:
+    /**
+     * @brief Construct a new WKV object.
+     * 
+     * @param name The name of the sensor.
+     * @param unit The measurement unit of the dat  a.
+     * @param resource Memory resource of the columns, which must outlive the sensor.
+     */
+    WKV(const std::string &name,
+        const std::string &unit,
+        std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+    virtual ~WKV() {}
+    /**
+     * @brief Get the Name of the sensor.
+     * 
+     * @return std::string The name of the sensor.
+     */
+    std::string getName() const override;
+
+    /**
+     * @brief Get the frequency of the sensor.
+     * 
+     * @return int the frequency in Hertz.
+     */
+    virtual int getFrequency() const override;
+
+    /**
+     * @brief Get the Unit of measurement.
+     * 
+     * @return std::string The unit of measurement.
+     */
+    std::string getUnit() const override;
+
+    /**
+     * @brief Get the Start Time in microseconds.
+     * 
+     * @return uint64_t The start time in microseconds.
+     */
+    uint64_t getStartTimeUs() const override;
+
+    /**
+     * @brief Set the Name of the sensor.
+     * 
+     * @param name The new name of the sensor.
+     */
+    void setName(const std::string &name) override;
+
+    /**
+     * @brief Set the Unit of measurement.
+     * 
+     * @param unit The new unit of measurement.
+     */
+    void setUnit(const std::string &unit) override;
+
+    /**
+     * @brief Set the Start Time in microseconds.
+     * 
+     * @param start_time_us The new start time in microseconds.
+     */
+    void setStartTimeUs(uint64_t start_time_us) override;
+
+    /**
+     * @brief Set the Frequency in Hertz.
+     * 
+     * @param frequency The new frequency in Hertz.
+     */
+    void setFrequency(int frequency) override;
+
+    /**
+     * @brief Set the seed of generateData(), so the generated values and jitter are reproducible.
+     * 
+     * @param seed The seed of the synthetic generator.
+     */
+    void setSeed(uint64_t seed);
+
+    /**
+     * @brief Add a data point to the series.
+     * 
+     * @param epoch_us The timestamp in microseconds.
+     * @param value The data value.
+     */
+    void addDataPoint(const uint64_t epoch_us, const double value) override;
+
+    /**
+     * @brief Append a block of data points to the series.
+     * 
+     * @param epochs_us The timestamps in microseconds.
+     * @param values The data values.
+     */
+    void addDataPoints(std::span<const uint64_t> epochs_us, std::span<const double> values) override;
+
+    /**
+     * @brief Get the Timestamps in microseconds.
+     * 
+     * @return std::span<const uint64_t> A view on the timestamps vector.
+     */
+    std::span<const uint64_t> getTimestampsUs() const override;
+
+    /**
+     * @brief Get the Data series values.
+     * 
+     * @return std::span<const double> A view on the data vector.
+     */
+    std::span<const double> getData() const override;
+
+    /**
+     * @brief Set the data series values.
+     */
+    virtual void setData(const std::vector<double> &data) override;
+
+    /**
+     * @brief Set the data series values, taking ownership of the vector without copying it.
+     */
+    virtual void setData(std::vector<double> &&data) override;
+
+    /**
+     * @brief Set the data series values, taking ownership of the vector and its memory resource
+     * without copying it.
+     */
+    void setData(std::pmr::vector<double> &&data);
+
+    /**
+     * @brief Set the timestamps in microseconds, taking ownership of the vector without copying it.
+     */
+    void setTimestampsUs(std::vector<uint64_t> &&timestamps_us);
+
+    /**
+     * @brief Set the timestamps in microseconds, taking ownership of the vector and its memory
+     * resource without copying it.
+     */
+    void setTimestampsUs(std::pmr::vector<uint64_t> &&timestamps_us);
+
+    /**
+     * @brief Get the memory resource the columns are allocated from.
+     */
+    std::pmr::memory_resource *getMemoryResource() const;
+
+    /**
+     * @brief Copy data from one iwkv instance to another. Was force to do so as copy constructor are deleted in Q_Object classes...
+     *
+     * The columns of another WKV are shared instead of copied if both sensors use the same memory
+     * resource, see SharedColumn. Otherwise they are copied into the resource of this sensor.
+     */
+    virtual void copyFrom(const IWKV &other) override;
+
+    /**
+     * @brief Check whether both columns are shared with another WKV.
+     */
+    bool sharesColumnsWith(const WKV &other) const;
+
+    /**
+     * @brief Build a range-aggregate index of the data, maintained by every later modification,
+     * so statistics() no longer scans the window. Does nothing if the index exists.
+     */
+    void enableAggregateIndex();
+
+    /**
+     * @brief Drop the range-aggregate index.
+     */
+    void disableAggregateIndex();
+
+    bool hasAggregateIndex() const;
+
+    /**
+     * @brief Get the min/max/sum/mean/RMS of the data over [start_time_s, end_time_s], relative to
+     * the start time.
+     *
+     * O(log n) with the range-aggregate index, a scan of the window without it.
+     */
+    WindowStatistics statistics(double start_time_s, double end_time_s) const;
+};
+
+#endif // WKV_H
@@ -0,0 +1,77 @@
+#include "wkvview.h"
+#include <algorithm>
+
+WKVView::WKVView(const IWKV &source, size_t offset, size_t count)
+    : source_(&source)
+    , timestamps_us_(source.getTimestampsUs().subspan(offset, count))
+    , data_(source.getData().subspan(offset, count))
+    , offset_(offset)
+{}
+
+WKVView WKVView::all(const IWKV &source)
+{
+    return WKVView(source, 0, source.getTimestampsUs().size());
+}
+
+WKVView WKVView::windowUs(const IWKV &source, uint64_t start_time_us, uint64_t end_time_us)
+{
+    const std::span<const uint64_t> timestamps = source.getTimestampsUs();
+    if (end_time_us < start_time_us) {
+        return WKVView(source, 0, 0);
+    }
+
+    // Timestamps are sorted, so both window edges are found with a binary search.
+    const auto first = std::lower_bound(timestamps.begin(), timestamps.end(), start_time_us);
+    const auto last = std::upper_bound(first, timestamps.end(), end_time_us);
+    return WKVView(source, first - timestamps.begin(), last - first);
+}
+
+WKVView WKVView::window(const IWKV &source, double start_time_s, double end_time_s)
+{
+    const uint64_t start_time_us = source.getStartTimeUs() + static_cast<uint64_t>(start_time_s * 1e6);
+    const uint64_t end_time_us = source.getStartTimeUs() + static_cast<uint64_t>(end_time_s * 1e6);
+    return windowUs(source, start_time_us, end_time_us);
+}
+
+WKVView WKVView::widened(size_t before, size_t after) const
+{
+    const size_t total = source_->getTimestampsUs().size();
+    const size_t first = offset_ - std::min(before, offset_);
+    const size_t last = std::min(offset_ + size() + after, total);
+    return WKVView(*source_, first, last - first);
+}
+
+const IWKV &WKVView::getSource() const
+{
+    return *source_;
+}
+
+size_t WKVView::getOffset() const
+{
+    return offset_;
+}
+
+std::span<const uint64_t> WKVView::getTimestampsUs() const
+{
+    return timestamps_us_;
+}
+
+std::span<const double> WKVView::getData() const
+{
+    return data_;
+}
+
+uint64_t WKVView::getStartTimeUs() const
+{
+    return source_->getStartTimeUs();
+}
+
+size_t WKVView::size() const
+{
+    return timestamps_us_.size();
+}
+
+bool WKVView::empty() const
+{
+    return timestamps_us_.empty();
+}
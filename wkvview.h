@@ -0,0 +1,96 @@
+#ifndef WKVVIEW_H
+#define WKVVIEW_H
+
+#include "iwkv.h"
+#include <span>
+
+/**
+ * @brief The WKVView class is a non-owning, zero-copy view over a time window of an IWKV.
+ *
+ * It holds a pair of spans on the timestamps and data of its source sensor. Windows are resolved
+ * with a binary search on the sorted timestamps, so selecting a window costs O(log n) and the
+ * processors only touch the samples inside it. A view is invalidated by any modification of the
+ * source sensor.
+ */
+class WKVView
+{
+private:
+    const IWKV *source_;                      ///< Sensor the view points into.
+    std::span<const uint64_t> timestamps_us_; ///< Timestamps of the window in microseconds.
+    std::span<const double> data_;            ///< Data values of the window.
+    size_t offset_;                           ///< Index of the first window sample in the source.
+
+public:
+    /**
+     * @brief Construct a view over the samples [offset, offset + count) of a sensor.
+     *
+     * @param source The sensor to view.
+     * @param offset Index of the first sample of the view.
+     * @param count Number of samples in the view.
+     */
+    WKVView(const IWKV &source, size_t offset, size_t count);
+
+    /**
+     * @brief Create a view over the whole series of a sensor.
+     */
+    static WKVView all(const IWKV &source);
+
+    /**
+     * @brief Create a view over the samples with start_time_us <= timestamp <= end_time_us.
+     *
+     * @param source The sensor to view.
+     * @param start_time_us Absolute start of the window in microseconds.
+     * @param end_time_us Absolute end of the window in microseconds.
+     */
+    static WKVView windowUs(const IWKV &source, uint64_t start_time_us, uint64_t end_time_us);
+
+    /**
+     * @brief Create a view over a window given in seconds relative to the sensor start time.
+     *
+     * @param source The sensor to view.
+     * @param start_time_s Start of the window in seconds.
+     * @param end_time_s End of the window in seconds.
+     */
+    static WKVView window(const IWKV &source, double start_time_s, double end_time_s);
+
+    /**
+     * @brief Extend the view by up to some samples on each side, clamped to the source series.
+     *
+     * Used to give filters and interpolators the neighbours they need around a window.
+     *
+     * @param before Number of samples to add before the view.
+     * @param after Number of samples to add after the view.
+     * @return WKVView The widened view.
+     */
+    WKVView widened(size_t before, size_t after) const;
+
+    /**
+     * @brief Get the sensor the view points into.
+     */
+    const IWKV &getSource() const;
+
+    /**
+     * @brief Get the index of the first sample of the view in the source series.
+     */
+    size_t getOffset() const;
+
+    /**
+     * @brief Get the timestamps of the view in microseconds.
+     */
+    std::span<const uint64_t> getTimestampsUs() const;
+
+    /**
+     * @brief Get the data values of the view.
+     */
+    std::span<const double> getData() const;
+
+    /**
+     * @brief Get the start time of the source data series in microseconds.
+     */
+    uint64_t getStartTimeUs() const;
+
+    size_t size() const;
+    bool empty() const;
+};
+
+#endif // WKVVIEW_H
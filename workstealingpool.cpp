@@ -0,0 +1,106 @@
+#include "workstealingpool.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace {
+
+/**
+ * @brief Queue of task indices owned by one worker.
+ */
+struct WorkerQueue
+{
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+
+    std::optional<size_t> pop()
+    {
+        std::lock_guard lock(mutex);
+        if (tasks.empty())
+            return std::nullopt;
+        const size_t task = tasks.front();
+        tasks.pop_front();
+        return task;
+    }
+
+    std::optional<size_t> steal()
+    {
+        std::lock_guard lock(mutex);
+        if (tasks.empty())
+            return std::nullopt;
+        const size_t task = tasks.back();
+        tasks.pop_back();
+        return task;
+    }
+};
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(size_t thread_count)
+    : thread_count_(thread_count ? thread_count : std::max(1u, std::thread::hardware_concurrency()))
+    , steal_count_(0)
+{}
+
+size_t WorkStealingPool::threadCount() const
+{
+    return thread_count_;
+}
+
+size_t WorkStealingPool::stealCount() const
+{
+    return steal_count_;
+}
+
+void WorkStealingPool::run(std::vector<Task> tasks)
+{
+    const size_t worker_count = std::min(thread_count_, std::max<size_t>(tasks.size(), 1));
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    for (size_t w = 0; w < worker_count; ++w)
+        queues.push_back(std::make_unique<WorkerQueue>());
+    for (size_t t = 0; t < tasks.size(); ++t)
+        queues[t % worker_count]->tasks.push_back(t);
+
+    std::atomic<size_t> steals{0};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    // No task is added once the run has started, so a worker can stop as soon as every queue is
+    // empty: the tasks still running elsewhere are already owned by another worker.
+    auto work = [&](size_t worker) {
+        for (;;) {
+            std::optional<size_t> task = queues[worker]->pop();
+            for (size_t k = 1; !task && k < worker_count; ++k) {
+                task = queues[(worker + k) % worker_count]->steal();
+                if (task)
+                    steals.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (!task)
+                return;
+
+            try {
+                tasks[*task](worker);
+            } catch (...) {
+                std::lock_guard lock(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(worker_count - 1);
+    for (size_t w = 1; w < worker_count; ++w)
+        threads.emplace_back(work, w);
+    work(0);
+    for (std::thread &thread : threads)
+        thread.join();
+
+    steal_count_ = steals;
+    if (error)
+        std::rethrow_exception(error);
+}
@@ -0,0 +1,52 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <functional>
+#include <vector>
+
+/**
+ * @brief The WorkStealingPool class runs a batch of independent tasks on all cores.
+ *
+ * Tasks are dealt round-robin to one queue per worker. A worker processes its own queue from the
+ * front and, once it is empty, steals from the back of the other queues, so workers that drew
+ * cheap tasks keep helping the ones that drew expensive ones instead of idling.
+ */
+class WorkStealingPool
+{
+public:
+    /// A task, given the index of the worker running it (0 to threadCount() - 1).
+    using Task = std::function<void(size_t worker)>;
+
+    /**
+     * @brief Construct a new WorkStealingPool.
+     *
+     * @param thread_count Number of workers, the number of hardware threads when 0.
+     */
+    explicit WorkStealingPool(size_t thread_count = 0);
+
+    /**
+     * @brief Get the number of workers, the calling thread included.
+     */
+    size_t threadCount() const;
+
+    /**
+     * @brief Run every task and block until they have all completed.
+     *
+     * The calling thread is used as worker 0. Tasks are started in the order given within each
+     * worker, so put the most expensive ones first.
+     *
+     * @throws The first exception thrown by a task, once every task has completed.
+     */
+    void run(std::vector<Task> tasks);
+
+    /**
+     * @brief Get the number of tasks that were stolen during the last run().
+     */
+    size_t stealCount() const;
+
+private:
+    size_t thread_count_; ///< Number of workers.
+    size_t steal_count_;  ///< Tasks stolen during the last run.
+};
+
+#endif // WORKSTEALINGPOOL_H